@@ -1,50 +1,511 @@
 /*
  * Assembler main program.
  */
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <vector>
+
+#include <fmt/core.h>
 
 #include "Assembler.h"
+#include "Exceptions.h"
+#include "InputLog.h"
+#include "Listing.h"
+#include "ObjectFile.h"
+#include "ResultCache.h"
+#include "RunSession.h"
+#include "StatsSegment.h"
+#include "TraceFile.h"
+
+/**
+ * @brief Prints the usage message and terminates.
+ */
+void print_usage_and_exit()
+{
+    std::cerr << "Usage: Assem <FileName> [--trace <TraceFile>] "
+                 "[--break <Location>]... [--watch <Address>]... "
+                 "[--record <InputLog> | --replay <InputLog>] "
+                 "[--stats <SegmentName>] [--delta <DumpFile>] "
+                 "[--digest <DigestFile>] [--expect-digest <Digest>] "
+                 "[--cache <Directory>] [--session <SessionFile>] "
+                 "[--extension block] [--passes <1|2>] [--threads <Count>] "
+                 "[--listing <ListingFile>] "
+                 "[--listing-format <table|compact|none>] "
+                 "[--object <ObjectFile>]"
+              << std::endl;
+    exit(1);
+}
 
 /**
- * @brief Checks that there is exactly one run time parameter.
+ * @brief Checks that the run time parameters are the file name followed by
+ * option and value pairs.
  * @param argc
  */
 void check_argument_count(int argc)
 {
-    if (argc != 2)
+    if (argc < 2 || argc % 2 != 0)
+    {
+        print_usage_and_exit();
+    }
+}
+
+/**
+ * @brief Displays the writes to watched cells since the last call.
+ * @param emulator The emulator running the program.
+ */
+void display_watchpoint_hits(Emulator& emulator)
+{
+    for (const auto& [location, address, old_value, new_value] :
+         emulator.take_watchpoint_hits())
+    {
+        std::cout << "Watchpoint at " << address << ": instruction at "
+                  << location << " changed " << old_value << " to "
+                  << new_value << std::endl;
+    }
+}
+
+/**
+ * @brief Displays the breakpoint the program stopped at.
+ * @param emulator The emulator running the program.
+ */
+void display_breakpoint(const Emulator& emulator)
+{
+    std::cout << "Breakpoint at " << emulator.get_location() << " after "
+              << emulator.get_instruction_count() << " instructions"
+              << std::endl;
+}
+
+/**
+ * @brief Runs the program, reporting each breakpoint it stops at.
+ * @param emulator The emulator holding the program.
+ * @throws DivisionByZeroError
+ * @throws BlockRangeError
+ */
+void run_to_halt(Emulator& emulator)
+{
+    StopReason stop_reason {emulator.run_program()};
+    display_watchpoint_hits(emulator);
+    while (stop_reason == StopReason::Breakpoint)
+    {
+        display_breakpoint(emulator);
+        stop_reason = emulator.resume();
+        display_watchpoint_hits(emulator);
+    }
+}
+
+/**
+ * @brief Runs the program, picking up the previous run logged in the session
+ * file from its last checkpoint the edits to the program leave intact.
+ * @details Output written before that checkpoint is taken from the log, and
+ * READ is given the values the previous run read after it before asking
+ * the console. The log of this run then replaces the session file.
+ * @param emulator The emulator holding the program.
+ * @param session_file_path The path to the session file.
+ * @throws DivisionByZeroError
+ * @throws BlockRangeError
+ * @throws SessionError
+ */
+void run_in_session(Emulator& emulator, const std::string& session_file_path)
+{
+    RunSession             session;
+    std::vector<long long> later_input;
+
+    if (auto previous {load_session(session_file_path)})
+    {
+        ResumePlan plan {plan_resume(*previous, emulator.get_image())};
+        session = std::move(plan.session);
+        later_input = std::move(plan.later_input);
+
+        restore_checkpoint(emulator, session.checkpoints.back());
+        std::cout << "Resuming the previous run after "
+                  << emulator.get_instruction_count() << " instructions"
+                  << std::endl;
+
+        ConsoleOutput console_output;
+        for (long long value : session.output)
+        {
+            console_output.write_value(value);
+        }
+    }
+    else
+    {
+        session.image.assign(emulator.get_image().begin(),
+                             emulator.get_image().end());
+        add_checkpoint(session, emulator);
+    }
+
+    SessionRecorder session_recorder {session};
+    ConsoleInput    console_input;
+    PrefixedInput   input {std::move(later_input), console_input};
+    emulator.set_input_source(&input);
+    emulator.set_trace_sink(&session_recorder);
+    emulator.set_instruction_limit(session.checkpoint_interval);
+
+    StopReason stop_reason {emulator.get_instruction_count() == 0
+                                ? emulator.run_program()
+                                : emulator.resume()};
+    while (true)
+    {
+        display_watchpoint_hits(emulator);
+
+        if (stop_reason == StopReason::InstructionLimit)
+            add_checkpoint(session, emulator);
+        else if (stop_reason == StopReason::Breakpoint)
+            display_breakpoint(emulator);
+        else
+            break;
+
+        stop_reason = emulator.resume();
+    }
+
+    emulator.set_input_source(nullptr);
+    emulator.set_trace_sink(nullptr);
+    emulator.set_instruction_limit(0);
+
+    save_session(session, session_file_path);
+}
+
+/**
+ * @brief Runs the program on recorded input, or looks up the result of an
+ * earlier identical run, and prints its output.
+ * @param emulator The emulator holding the program.
+ * @param replay_input The recorded input.
+ * @param cache_directory The result cache directory.
+ * @throws DivisionByZeroError
+ * @throws BlockRangeError
+ * @throws ResultCacheError
+ * @throws ReplayDivergenceError
+ */
+void run_from_cache(Emulator& emulator, ReplayInput& replay_input,
+                    const std::string& cache_directory)
+{
+    ResultCache  cache {cache_directory};
+    CachedResult result {run_cached(emulator, replay_input, cache)};
+
+    ConsoleOutput console_output;
+    for (long long value : result.output)
     {
-        std::cerr << "Usage: Assem <FileName>" << std::endl;
+        console_output.write_value(value);
+    }
+}
+
+/**
+ * @brief Writes the cells the program changed, one per line, as the address,
+ * the loaded value and the value at halt.
+ * @param emulator The emulator that ran the program.
+ * @param delta_file_path The path to the dump file.
+ */
+void write_memory_delta(const Emulator& emulator,
+                        const std::string& delta_file_path)
+{
+    std::ofstream delta_file {delta_file_path};
+    if (!delta_file.is_open())
+    {
+        std::cerr << "Cannot create " << delta_file_path << std::endl;
         exit(1);
     }
+
+    for (const auto& [address, old_value, new_value] :
+         emulator.get_memory_delta())
+    {
+        delta_file << address << ' ' << old_value << ' ' << new_value << '\n';
+    }
+}
+
+/**
+ * @brief Assembles the program and lists its symbol table and translation.
+ * @param assem The assembler holding the source.
+ * @param listing The listing, or nullptr to list nothing.
+ * @param single_pass True to read the source only once.
+ */
+void assemble(Assembler& assem, ListingSink* listing, bool single_pass)
+{
+    // Establish the location of the labels, translating the program along
+    // the way when assembling in one pass:
+    if (single_pass)
+        assem.assemble_single_pass();
+    else
+        assem.pass_1();
+
+    if (listing)
+        listing->add_heading("Symbol Table");
+    assem.display_symbol_table();
+    if (listing)
+        listing->add_rule();
+
+    if (listing)
+        listing->add_heading("Translation of the Assembler Language Program");
+    if (single_pass)
+        assem.display_listing();
+    else
+        assem.pass_2();
+    if (listing)
+    {
+        listing->add_rule();
+        listing->flush();
+    }
+}
+
+/**
+ * @brief Loads an assembled program from an object file and lists its
+ * symbol table.
+ * @param object_file_path The path to the object file.
+ * @param emulator The emulator to load the program into.
+ * @param listing The listing, or nullptr to list nothing.
+ * @throws ObjectFileError
+ */
+void load_object(const std::string& object_file_path, Emulator& emulator,
+                 ListingSink* listing)
+{
+    ObjectFile object_file {object_file_path};
+    object_file.load_into(emulator);
+
+    if (listing)
+    {
+        listing->add_heading("Symbol Table");
+        object_file.display_symbol_table(*listing);
+        listing->add_rule();
+        listing->flush();
+    }
 }
 
 int main(int argc, char* argv[])
 {
     check_argument_count(argc);
 
-    std::string source_file_path = argv[1];
+    std::string      source_file_path = argv[1];
+    std::string      trace_file_path;
+    std::string      record_file_path;
+    std::string      replay_file_path;
+    std::string      stats_segment_name;
+    std::string      delta_file_path;
+    std::string      digest_file_path;
+    std::string      expected_digest;
+    std::string      cache_directory;
+    std::string      session_file_path;
+    std::string      listing_file_path;
+    std::string      listing_format {"table"};
+    std::string      object_file_path;
+    bool             block_instructions {false};
+    bool             single_pass {false};
+    int              thread_count {0};
+    std::vector<int> breakpoints;
+    std::vector<int> watchpoints;
 
-    Assembler assem(source_file_path);
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string option {argv[i]};
 
-    // Establish the location of the labels:
-    assem.pass_1();
+        if (option == "--trace")
+            trace_file_path = argv[i + 1];
+        else if (option == "--break")
+            breakpoints.push_back(std::stoi(argv[i + 1]));
+        else if (option == "--watch")
+            watchpoints.push_back(std::stoi(argv[i + 1]));
+        else if (option == "--record")
+            record_file_path = argv[i + 1];
+        else if (option == "--replay")
+            replay_file_path = argv[i + 1];
+        else if (option == "--stats")
+            stats_segment_name = argv[i + 1];
+        else if (option == "--delta")
+            delta_file_path = argv[i + 1];
+        else if (option == "--digest")
+            digest_file_path = argv[i + 1];
+        else if (option == "--expect-digest")
+            expected_digest = argv[i + 1];
+        else if (option == "--cache")
+            cache_directory = argv[i + 1];
+        else if (option == "--session")
+            session_file_path = argv[i + 1];
+        else if (option == "--extension" &&
+                 std::string(argv[i + 1]) == "block")
+            block_instructions = true;
+        else if (option == "--passes" && std::string(argv[i + 1]) == "1")
+            single_pass = true;
+        else if (option == "--passes" && std::string(argv[i + 1]) == "2")
+            single_pass = false;
+        else if (option == "--threads")
+            thread_count = std::stoi(argv[i + 1]);
+        else if (option == "--listing")
+            listing_file_path = argv[i + 1];
+        else if (option == "--listing-format")
+            listing_format = argv[i + 1];
+        else if (option == "--object")
+            object_file_path = argv[i + 1];
+        else
+            print_usage_and_exit();
+    }
 
-    std::cout << "Symbol Table:\n\n";
-    assem.display_symbol_table();
-    std::cout
-        << "___________________________________________________________\n\n";
+    if (!record_file_path.empty() && !replay_file_path.empty())
+    {
+        print_usage_and_exit();
+    }
 
-    std::cout << "Translation of the Assembler Language Program:\n\n";
-    assem.pass_2();
-    std::cout
-        << "___________________________________________________________\n\n";
+    // A cached run needs its input up front and skips the emulation that
+    // debugging options observe.
+    if (!cache_directory.empty() &&
+        (replay_file_path.empty() || !trace_file_path.empty() ||
+         !breakpoints.empty() || !watchpoints.empty()))
+    {
+        print_usage_and_exit();
+    }
+
+    // A session supplies its own trace and input.
+    if (!session_file_path.empty() &&
+        (!trace_file_path.empty() || !record_file_path.empty() ||
+         !replay_file_path.empty() || !cache_directory.empty()))
+    {
+        print_usage_and_exit();
+    }
+
+    if (listing_format != "table" && listing_format != "compact" &&
+        listing_format != "none")
+    {
+        print_usage_and_exit();
+    }
+
+    // The symbol table and the translation go to the console unless a
+    // listing file is given; batch jobs can skip them altogether.
+    std::unique_ptr<ListingSink> listing;
+    ListingFormat                format {listing_format == "compact"
+                                             ? ListingFormat::Compact
+                                             : ListingFormat::Table};
+    if (listing_format != "none")
+    {
+        if (listing_file_path.empty())
+            listing = std::make_unique<ConsoleListing>(format);
+        else
+            listing = std::make_unique<FileListing>(listing_file_path, format);
+    }
+
+    // An object file is run as it was assembled; a source file is assembled
+    // first, and saved as an object file if asked to.
+    std::unique_ptr<Assembler> assem;
+    std::unique_ptr<Emulator>  loaded_emulator;
+    if (is_object_file(source_file_path))
+    {
+        loaded_emulator = std::make_unique<Emulator>();
+        load_object(source_file_path, *loaded_emulator, listing.get());
+    }
+    else
+    {
+        assem = std::make_unique<Assembler>(source_file_path,
+                                            block_instructions);
+        assem->set_thread_count(thread_count);
+        assem->set_listing_sink(listing.get());
+        assemble(*assem, listing.get(), single_pass);
+
+        if (!object_file_path.empty())
+        {
+            assem->write_object_file(object_file_path);
+        }
+    }
 
     // Run the emulator on the translation of the assembler language program
     // that was generated in Pass II.
-    assem.run_program_in_emulator();
+    Emulator& emulator {assem ? assem->get_emulator() : *loaded_emulator};
+
+    for (int location : breakpoints)
+    {
+        emulator.add_breakpoint(location);
+    }
+
+    for (int address : watchpoints)
+    {
+        emulator.add_watchpoint(address);
+    }
+
+    std::unique_ptr<TraceWriter> trace_writer;
+    if (!trace_file_path.empty())
+    {
+        trace_writer = std::make_unique<TraceWriter>(trace_file_path);
+        emulator.set_trace_sink(trace_writer.get());
+    }
+
+    std::unique_ptr<StatsPublisher> stats_publisher;
+    if (!stats_segment_name.empty())
+    {
+        stats_publisher = std::make_unique<StatsPublisher>(stats_segment_name);
+        emulator.set_stats_publisher(stats_publisher.get());
+    }
+
+    ConsoleInput                    console_input;
+    std::unique_ptr<RecordingInput> recording_input;
+    std::unique_ptr<ReplayInput>    replay_input;
+    if (!record_file_path.empty())
+    {
+        recording_input =
+            std::make_unique<RecordingInput>(record_file_path, console_input);
+        emulator.set_input_source(recording_input.get());
+    }
+    else if (!replay_file_path.empty())
+    {
+        replay_input = std::make_unique<ReplayInput>(replay_file_path);
+        emulator.set_input_source(replay_input.get());
+    }
+
+    try
+    {
+        if (!session_file_path.empty())
+            run_in_session(emulator, session_file_path);
+        else if (cache_directory.empty())
+            run_to_halt(emulator);
+        else
+            run_from_cache(emulator, *replay_input, cache_directory);
+    }
+    catch (const DivisionByZeroError& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    catch (const BlockRangeError& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    if (trace_writer)
+    {
+        trace_writer->close();
+    }
+
+    if (!delta_file_path.empty())
+    {
+        write_memory_delta(emulator, delta_file_path);
+    }
+
+    // The input logs are finished before anything can fail the run, so the
+    // record log is complete and a replay divergence is reported first.
+    if (recording_input)
+    {
+        recording_input->close(emulator.get_instruction_count());
+    }
+
+    if (replay_input && cache_directory.empty())
+    {
+        replay_input->check_finished(emulator.get_instruction_count());
+    }
+
+    std::string digest {fmt::format("{:016x}", emulator.get_memory_digest())};
+
+    if (!digest_file_path.empty())
+    {
+        std::ofstream digest_file {digest_file_path};
+        digest_file << digest << '\n';
+    }
+
+    // Full memory is only worth comparing when the digests differ.
+    if (!expected_digest.empty() && expected_digest != digest)
+    {
+        std::cout << "Memory digest " << digest << " does not match "
+                  << expected_digest << std::endl;
+        return 1;
+    }
 
     // Terminate indicating all is well.  If there is an unrecoverable error,
     // the program will terminate at the point that it occurred with an exit(1)
     // call.
     return 0;
-}
\ No newline at end of file
+}
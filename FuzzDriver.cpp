@@ -0,0 +1,101 @@
+/*
+ * Fuzz driver main program. Assembles a program and searches for READ input
+ * that makes it divide by zero, crash the emulator or run without halting.
+ */
+#include <iostream>
+#include <sstream>
+
+#include <fmt/core.h>
+
+#include "Assembler.h"
+#include "Fuzzer.h"
+
+/**
+ * @brief Prints the usage message and terminates.
+ */
+void print_usage_and_exit()
+{
+    std::cerr << "Usage: FuzzDriver <FileName> [<Executions> [<Threads> "
+                 "[<InstructionLimit>]]]"
+              << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief Formats an input sequence for display.
+ * @param input The input values.
+ * @return The values separated by spaces.
+ */
+std::string format_input(const std::vector<long long>& input)
+{
+    std::ostringstream formatted;
+    for (std::size_t i = 0; i < input.size(); i++)
+    {
+        formatted << (i > 0 ? " " : "") << input[i];
+    }
+    return formatted.str();
+}
+
+/**
+ * @brief Gets the name of a kind of finding.
+ * @param kind The kind.
+ * @return The name of the kind.
+ */
+std::string get_kind_name(FuzzFindingKind kind)
+{
+    switch (kind)
+    {
+    case FuzzFindingKind::DivisionByZero:
+        return "Division by zero";
+    case FuzzFindingKind::Hang:
+        return "Hang";
+    case FuzzFindingKind::Crash:
+        return "Crash";
+    }
+    return "Unknown";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 5)
+        print_usage_and_exit();
+
+    FuzzerOptions options;
+    if (argc > 2)
+        options.execution_count = std::stoll(argv[2]);
+    if (argc > 3)
+        options.thread_count = std::stoi(argv[3]);
+    if (argc > 4)
+        options.instruction_limit = std::stoll(argv[4]);
+
+    Assembler assem(argv[1]);
+
+    // The translation listing is not wanted here; errors still reach cerr.
+    std::streambuf* listing {std::cout.rdbuf(nullptr)};
+    assem.pass_1();
+    assem.pass_2();
+    std::cout.rdbuf(listing);
+
+    Fuzzer     fuzzer {assem.get_emulator().get_image(), options};
+    FuzzReport report {fuzzer.run()};
+
+    std::cout << fmt::format("Executions:    {}\n", report.execution_count);
+    std::cout << fmt::format("Covered edges: {}\n", report.covered_edge_count);
+    std::cout << fmt::format("Corpus size:   {}\n\n", report.corpus.size());
+
+    std::cout << fmt::format("{:<18}{:<10}{}\n", // Set format
+                             "Finding", "Location", "Input");
+    for (const FuzzFinding& finding : report.findings)
+    {
+        std::cout << fmt::format("{:<18}{:<10}{}\n", // Set format
+                                 get_kind_name(finding.kind), finding.location,
+                                 format_input(finding.input));
+
+        if (finding.kind == FuzzFindingKind::Crash)
+        {
+            std::cout << fmt::format("{:<28}{}\n", "", finding.message);
+        }
+    }
+
+    return report.findings.empty() ? 0 : 2;
+}
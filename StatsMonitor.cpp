@@ -0,0 +1,129 @@
+/*
+ * Stats monitor main program. Displays the live counters that a running
+ * emulator publishes into a shared memory segment.
+ */
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#include <fmt/core.h>
+
+#include "Exceptions.h"
+#include "StatsSegment.h"
+
+/**
+ * @brief Prints the usage message and terminates.
+ */
+void print_usage_and_exit()
+{
+    std::cerr << "Usage: StatsMonitor <SegmentName> [<IntervalMs>]"
+              << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief Gets the name of a program state.
+ * @param state The state.
+ * @return The name of the state.
+ */
+std::string get_state_name(StatsState state)
+{
+    switch (state)
+    {
+    case StatsState::Running:
+        return "running";
+    case StatsState::Breakpoint:
+        return "breakpoint";
+    case StatsState::Halted:
+        return "halted";
+    case StatsState::InstructionLimit:
+        return "limit";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Checks if a process has exited.
+ * @param pid The process id.
+ * @return True if there is no such process.
+ */
+bool has_exited(long long pid)
+{
+    return kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+        print_usage_and_exit();
+
+    std::chrono::milliseconds interval {argc == 3 ? std::stoi(argv[2]) : 1000};
+
+    try
+    {
+        StatsReader reader(argv[1]);
+
+        std::optional<StatsSnapshot> snapshot {reader.read()};
+        if (!snapshot)
+        {
+            std::cerr << "The emulator stats are unavailable" << std::endl;
+            return 1;
+        }
+
+        long long pid {snapshot->pid};
+        std::cout << fmt::format("Emulator process {}\n\n", pid);
+        std::cout << fmt::format("{:<12}{:<18}{:<16}{:<10}{:<10}{:<10}\n",
+                                 "State", "Instructions", "Per second",
+                                 "Location", "Reads", "Writes");
+
+        // The emulator removes the segment when it exits, so stop once the
+        // program has halted. An emulator that died without halting never
+        // publishes again, and may have died during an update, so stop when
+        // its process is gone too; one stopped at a breakpoint stays quiet
+        // but alive.
+        while (true)
+        {
+            if (!snapshot)
+            {
+                std::cout << "unavailable" << std::endl;
+            }
+            else
+            {
+                std::cout << fmt::format(
+                                 "{:<12}{:<18}{:<16}{:<10}{:<10}{:<10}",
+                                 get_state_name(snapshot->state),
+                                 snapshot->instruction_count,
+                                 snapshot->instructions_per_second,
+                                 snapshot->location, snapshot->read_count,
+                                 snapshot->write_count)
+                          << std::endl;
+
+                if (snapshot->state == StatsState::Halted)
+                    break;
+            }
+
+            std::this_thread::sleep_for(interval);
+            snapshot = reader.read();
+
+            if ((!snapshot || snapshot->state != StatsState::Halted) &&
+                has_exited(pid))
+            {
+                std::cerr << fmt::format(
+                                 "Emulator process {} exited without halting",
+                                 pid)
+                          << std::endl;
+                return 1;
+            }
+        }
+    }
+    catch (const StatsSegmentError& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
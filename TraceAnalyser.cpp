@@ -0,0 +1,181 @@
+/*
+ * Trace analyser main program. Rebuilds profiles and memory histories from a
+ * trace file written by the emulator.
+ */
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "Exceptions.h"
+#include "InstructionDefinitions.h"
+#include "TraceFile.h"
+
+/**
+ * @brief Prints the usage message and terminates.
+ */
+void print_usage_and_exit()
+{
+    std::cerr << "Usage: TraceAnalyser <TraceFile> profile [<Count>]\n"
+                 "       TraceAnalyser <TraceFile> history <Address>\n"
+                 "       TraceAnalyser <TraceFile> dump <From> <Count>"
+              << std::endl;
+    exit(1);
+}
+
+/**
+ * @brief Gets the symbolic name of an opcode.
+ * @param opcode The numeric opcode.
+ * @return The symbolic opcode, or the number if there is none.
+ */
+std::string get_opcode_name(NumericOpcode opcode)
+{
+    if (const OpcodeDescriptor* descriptor {find_opcode_descriptor(opcode)})
+        return std::string(descriptor->symbolic_opcode);
+
+    return std::to_string(static_cast<int>(opcode));
+}
+
+/**
+ * @brief Checks if an instruction stores a value in its first operand.
+ * @details Block instructions are left out: their traced value is the block
+ * length.
+ * @param opcode The numeric opcode.
+ * @return True if the first operand is written.
+ */
+bool stores_to_operand_1(NumericOpcode opcode)
+{
+    return trace_records_value(opcode) && opcode != NumericOpcode::WRITE &&
+           !is_block_opcode(opcode);
+}
+
+/**
+ * @brief Displays how often each location and opcode was executed.
+ * @param reader The trace.
+ * @param count The number of locations to display.
+ */
+void display_profile(TraceReader& reader, int count)
+{
+    std::unordered_map<int, long long>    location_counts;
+    std::map<NumericOpcode, long long> opcode_counts;
+
+    TraceRecord record;
+    while (reader.next(record))
+    {
+        location_counts[record.location]++;
+        opcode_counts[record.opcode]++;
+    }
+
+    std::vector<std::pair<int, long long>> hottest(location_counts.begin(),
+                                                   location_counts.end());
+    std::ranges::sort(hottest,
+                      [](const auto& a, const auto& b)
+                      {
+                          return a.second != b.second ? a.second > b.second
+                                                      : a.first < b.first;
+                      });
+    if (static_cast<int>(hottest.size()) > count)
+        hottest.resize(count);
+
+    std::cout << fmt::format("Instructions executed: {}\n\n", reader.size());
+
+    std::cout << fmt::format("{:<10}{:<15}{:<10}\n", // Set format
+                             "Location", "Executions", "Percent");
+    for (const auto& [location, executions] : hottest)
+    {
+        std::cout << fmt::format("{:<10}{:<15}{:<10.2f}\n", // Set format
+                                 location, executions,
+                                 100.0 * static_cast<double>(executions) /
+                                     static_cast<double>(reader.size()));
+    }
+
+    std::cout << fmt::format("\n{:<10}{:<15}\n", // Set format
+                             "Opcode", "Executions");
+    for (const auto& [opcode, executions] : opcode_counts)
+    {
+        std::cout << fmt::format("{:<10}{:<15}\n", // Set format
+                                 get_opcode_name(opcode), executions);
+    }
+}
+
+/**
+ * @brief Displays every value stored at a memory address.
+ * @param reader The trace.
+ * @param address The memory address.
+ */
+void display_history(TraceReader& reader, int address)
+{
+    std::cout << fmt::format("{:<15}{:<10}{:<10}{:<20}\n", // Set format
+                             "Instruction", "Location", "Opcode", "Value");
+
+    TraceRecord record;
+    while (reader.next(record))
+    {
+        if (stores_to_operand_1(record.opcode) && record.operand1 == address)
+        {
+            std::cout << fmt::format("{:<15}{:<10}{:<10}{:<20}\n", // Set format
+                                     record.index, record.location,
+                                     get_opcode_name(record.opcode),
+                                     record.value);
+        }
+    }
+}
+
+/**
+ * @brief Displays a range of records.
+ * @param reader The trace.
+ * @param from The instruction count of the first record.
+ * @param count The number of records.
+ */
+void display_records(TraceReader& reader, long long from, long long count)
+{
+    reader.seek(from);
+
+    std::cout << fmt::format("{:<15}{:<10}{:<10}{:<10}{:<10}{:<20}\n",
+                             "Instruction", "Location", "Opcode", "Operand 1",
+                             "Operand 2", "Value");
+
+    TraceRecord record;
+    for (long long i = 0; i < count && reader.next(record); i++)
+    {
+        std::cout << fmt::format("{:<15}{:<10}{:<10}{:<10}{:<10}{:<20}\n",
+                                 record.index, record.location,
+                                 get_opcode_name(record.opcode),
+                                 record.operand1, record.operand2,
+                                 trace_records_value(record.opcode)
+                                     ? std::to_string(record.value)
+                                     : "");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+        print_usage_and_exit();
+
+    std::string command {argv[2]};
+
+    try
+    {
+        TraceReader reader(argv[1]);
+
+        if (command == "profile" && argc <= 4)
+            display_profile(reader, argc == 4 ? std::stoi(argv[3]) : 20);
+        else if (command == "history" && argc == 4)
+            display_history(reader, std::stoi(argv[3]));
+        else if (command == "dump" && argc == 5)
+            display_records(reader, std::stoll(argv[3]), std::stoll(argv[4]));
+        else
+            print_usage_and_exit();
+    }
+    catch (const TraceFileError& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
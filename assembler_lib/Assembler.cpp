@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 
 #include "Assembler.h"
 #include "Errors.h"
@@ -8,39 +11,96 @@
 #include "HelperFunctions.h"
 #include "InstructionDefinitions.h"
 #include "NumericInstruction.h"
+#include "ObjectFile.h"
+#include "TraceFile.h"
 
-Assembler::Assembler(const std::string& source_file_path)
-    : _instructions_file(source_file_path)
+Assembler::Assembler(const std::string& source_file_path,
+                     bool               block_instructions)
+    : _instructions_file(source_file_path),
+      _block_instructions(block_instructions)
 {
 }
 
+namespace
+{
+// Fewer lines are not worth a thread of their own.
+const std::size_t MIN_LINES_PER_CHUNK {16 * 1024};
+
+// The pipeline of assemble_single_pass passes lines on in batches this
+// large, and lets each stage run this many batches ahead of the next.
+const std::size_t LINES_PER_BATCH {4096};
+const std::size_t BATCHES_IN_FLIGHT {4};
+
+/**
+ * @brief Waits on a pipeline queue, counting the time as stalled.
+ * @param stalled The stalled time of the waiting stage.
+ * @param wait The push or pop to wait for.
+ * @return What the push or pop returned.
+ */
+template <typename Wait>
+auto wait_stalled(std::chrono::nanoseconds& stalled, Wait wait)
+{
+    auto start {std::chrono::steady_clock::now()};
+    auto result {wait()};
+
+    stalled += std::chrono::steady_clock::now() - start;
+    return result;
+}
+} // namespace
+
 void Assembler::pass_1()
 {
+    _lines.clear();
+    while (!_instructions_file.end_of_file())
+    {
+        _lines.push_back(_instructions_file.get_next_line());
+    }
+
+    std::size_t chunk_count {std::clamp<std::size_t>(
+        _lines.size() / MIN_LINES_PER_CHUNK, 1, _get_thread_count())};
+    std::vector<Pass1Chunk> chunks(chunk_count);
+
+    _for_each_chunk(chunk_count,
+                    [&](std::size_t i)
+                    { chunks[i] = _scan_chunk(_get_chunk(i, chunk_count)); });
+
+    // Stitch the chunks together in source order, so the first error in the
+    // source is thrown, with the labels before it already defined.
     int current_instruction_location = 0;
+    _chunks.clear();
 
-    while (!_instructions_file.end_of_file())
+    for (std::size_t i = 0; i < chunk_count; i++)
     {
-        std::string         line {_instructions_file.get_next_line()};
-        SymbolicInstruction current_instruction(line);
+        const Pass1Chunk& chunk {chunks[i]};
+        _chunks.push_back(
+            {_get_chunk(i, chunk_count), current_instruction_location});
+
+        for (const auto& [label, location, absolute] : chunk.labels)
+        {
+            _symbol_table.add_symbol(
+                label,
+                absolute ? location : current_instruction_location + location);
+        }
+
+        current_instruction_location =
+            chunk.absolute ? chunk.location
+                           : current_instruction_location + chunk.location;
 
-        switch (current_instruction.get_type())
+        if (chunk.found_end)
         {
-        case InstructionType::End:
+            // The rest of the source follows the END statement.
+            std::size_t end_line {static_cast<std::size_t>(
+                _chunks.back().lines.data() - _lines.data() + chunk.end_line)};
+
             _check_memory_sufficiency(current_instruction_location);
-            _check_if_end_is_valid();
+            _check_if_end_is_valid(std::span {_lines}.subspan(end_line + 1));
 
             return;
-        case InstructionType::Comment:
-            continue;
+        }
 
-        default:
-            if (current_instruction.contains_label())
-            {
-                _symbol_table.add_symbol(current_instruction.get_label(),
-                                         current_instruction_location);
-            }
-            current_instruction_location = get_location_of_next_instruction(
-                current_instruction, current_instruction_location);
+        if (chunk.error)
+        {
+            std::rethrow_exception(chunk.error);
         }
     }
 
@@ -48,19 +108,116 @@ void Assembler::pass_1()
     throw MissingEndStatementError();
 }
 
-void Assembler::_check_if_end_is_valid()
+std::span<const std::string_view>
+Assembler::_get_chunk(std::size_t chunk_index, std::size_t chunk_count) const
 {
-    std::string statements_after_end;
-    while (!_instructions_file.end_of_file())
+    std::size_t first {_lines.size() * chunk_index / chunk_count};
+    std::size_t last {_lines.size() * (chunk_index + 1) / chunk_count};
+
+    return std::span {_lines}.subspan(first, last - first);
+}
+
+void Assembler::_for_each_chunk(
+    std::size_t chunk_count, const std::function<void(std::size_t)>& task)
+{
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < chunk_count; i++)
+    {
+        workers.emplace_back(task, i);
+    }
+
+    task(0);
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+Assembler::Pass1Chunk
+Assembler::_scan_chunk(std::span<const std::string_view> lines) const
+{
+    Pass1Chunk chunk;
+
+    try
+    {
+        for (std::size_t i = 0; i < lines.size(); i++)
+        {
+            SymbolicInstruction current_instruction(lines[i]);
+
+            switch (current_instruction.get_type())
+            {
+            case InstructionType::End:
+                chunk.found_end = true;
+                chunk.end_line = i;
+
+                return chunk;
+            case InstructionType::Comment:
+                continue;
+
+            default:
+                _check_opcode_enabled(current_instruction);
+
+                if (current_instruction.contains_label())
+                {
+                    chunk.labels.push_back({current_instruction.get_label(),
+                                            chunk.location, chunk.absolute});
+                }
+
+                // ORG fixes the location; everything else moves it on.
+                if (current_instruction.get_numeric_opcode() ==
+                    NumericOpcode::ORG)
+                {
+                    chunk.absolute = true;
+                }
+                chunk.location = get_location_of_next_instruction(
+                    current_instruction, chunk.location);
+            }
+        }
+    }
+    catch (...)
     {
-        statements_after_end += _instructions_file.get_next_line();
+        chunk.error = std::current_exception();
     }
 
-    trim(statements_after_end);
+    return chunk;
+}
 
-    if (!statements_after_end.empty())
+int Assembler::_get_thread_count() const
+{
+    if (_thread_count > 0)
     {
-        throw StatementAfterEndError(statements_after_end);
+        return _thread_count;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void Assembler::_check_if_end_is_valid(
+    std::span<const std::string_view> statements_after_end)
+{
+    // Usually there is nothing after the END statement but blank lines.
+    auto is_blank {[](std::string_view statement)
+                   {
+                       return std::ranges::all_of(
+                           statement, [](unsigned char c)
+                           { return std::isspace(c); });
+                   }};
+    if (std::ranges::all_of(statements_after_end, is_blank))
+    {
+        return;
+    }
+
+    std::string statements;
+    for (std::string_view statement : statements_after_end)
+    {
+        statements += statement;
+    }
+
+    trim(statements);
+
+    if (!statements.empty())
+    {
+        throw StatementAfterEndError(statements);
     }
 }
 
@@ -73,55 +230,524 @@ void Assembler::_check_memory_sufficiency(int last_instruction_location) const
     }
 }
 
+void Assembler::_check_opcode_enabled(
+    const SymbolicInstruction& instruction) const
+{
+    if (!_block_instructions &&
+        is_block_opcode(instruction.get_numeric_opcode()))
+    {
+        throw InvalidOpcodeError {instruction.get_opcode()};
+    }
+}
+
 void Assembler::pass_2()
 {
-    _instructions_file.rewind();
+    // Without the chunks of pass_1, the source is translated in one chunk.
+    if (_chunks.empty())
+    {
+        _instructions_file.rewind();
+
+        _lines.clear();
+        while (!_instructions_file.end_of_file())
+        {
+            _lines.push_back(_instructions_file.get_next_line());
+        }
+        _chunks.push_back({_lines, 0});
+    }
+
+    if (_listing != nullptr)
+    {
+        _listing->add_translation_header();
+    }
+
+    // The chunks are the ones pass_1 placed, so each starts at the location
+    // pass_1 found for its first line.
+    std::size_t             chunk_count {_chunks.size()};
+    std::vector<Pass2Chunk> chunks(chunk_count);
 
-    std::cout << fmt::format("{:<10}{:<15}{:<30}\n", // Set format
-                             "Location", "Contents", "Original Statement");
+    _for_each_chunk(chunk_count,
+                    [&](std::size_t i)
+                    {
+                        chunks[i] = _translate_chunk(_chunks[i].lines,
+                                                     _chunks[i].location);
+                    });
+
+    // Take the chunks in source order, up to the first error or the END
+    // statement, as if the lines had been translated one by one.
+    for (const Pass2Chunk& chunk : chunks)
+    {
+        if (_listing != nullptr)
+        {
+            _listing->add_text(chunk.listing->get_text());
+        }
+
+        for (auto [location, contents] : chunk.words)
+        {
+            _emulator.insert(location, contents);
+        }
+
+        if (chunk.error)
+        {
+            _flush_listing();
+            std::rethrow_exception(chunk.error);
+        }
+
+        if (chunk.found_end)
+        {
+            // Later resets restore memory to the assembled program.
+            _emulator.save_image();
+            break;
+        }
+    }
+
+    _flush_listing();
+}
+
+void Assembler::display_symbol_table() const
+{
+    if (_listing != nullptr)
+    {
+        _symbol_table.display_symbol_table(*_listing);
+        _listing->flush();
+    }
+}
+
+void Assembler::write_object_file(const std::string& object_file_path) const
+{
+    save_object_file(_emulator.get_image(), _symbol_table.get_symbols(),
+                     object_file_path);
+}
+
+void Assembler::_flush_listing() const
+{
+    if (_listing != nullptr)
+    {
+        _listing->flush();
+    }
+}
+
+Assembler::Pass2Chunk
+Assembler::_translate_chunk(std::span<const std::string_view> lines,
+                            int                               location) const
+{
+    Pass2Chunk chunk;
+    if (_listing != nullptr)
+    {
+        chunk.listing = std::make_unique<MemoryListing>(_listing->get_format());
+    }
+
+    int current_instruction_location = location;
+
+    try
+    {
+        for (std::string_view line : lines)
+        {
+            SymbolicInstruction current_symbolic_instruction(line);
+
+            switch (current_symbolic_instruction.get_type())
+            {
+            case InstructionType::End:
+                if (chunk.listing)
+                {
+                    chunk.listing->add_statement(line);
+                }
+
+                chunk.found_end = true;
+                return chunk;
+            case InstructionType::Comment:
+                if (chunk.listing)
+                {
+                    chunk.listing->add_statement(line);
+                }
+                continue;
+
+            default:
+                NumericInstruction current_numeric_instruction(
+                    current_symbolic_instruction, _symbol_table);
+
+                if (chunk.listing)
+                {
+                    chunk.listing->add_instruction(current_instruction_location,
+                                                   current_numeric_instruction,
+                                                   line);
+                }
+
+                chunk.words.emplace_back(
+                    current_instruction_location,
+                    current_numeric_instruction.get_numeric_representation());
+
+                if (current_numeric_instruction.has_extension_word())
+                {
+                    chunk.words.emplace_back(
+                        current_instruction_location + 1,
+                        current_numeric_instruction.get_operand_3());
+                }
+            }
+
+            current_instruction_location = get_location_of_next_instruction(
+                current_symbolic_instruction, current_instruction_location);
+        }
+    }
+    catch (...)
+    {
+        chunk.error = std::current_exception();
+    }
+
+    return chunk;
+}
+
+void Assembler::assemble_single_pass()
+{
+    if (_get_thread_count() > 1)
+    {
+        _assemble_pipelined();
+        return;
+    }
 
     int current_instruction_location = 0;
 
     while (!_instructions_file.end_of_file())
     {
-        std::string         line {_instructions_file.get_next_line()};
+        std::string_view    line {_instructions_file.get_next_line()};
         SymbolicInstruction current_symbolic_instruction(line);
+        _check_opcode_enabled(current_symbolic_instruction);
 
-        switch (current_symbolic_instruction.get_type())
+        if (current_symbolic_instruction.get_type() == InstructionType::End)
         {
-        case InstructionType::End:
-            std::cout << fmt::format(
-                "{:<10}{:<15}{:<30}\n", // Set format
-                "",                     // No location
-                "",                     // No contents
-                current_symbolic_instruction.get_original_instruction());
+            std::vector<std::string_view> statements_after_end;
+            while (!_instructions_file.end_of_file())
+            {
+                statements_after_end.push_back(
+                    _instructions_file.get_next_line());
+            }
+
+            _finish_single_pass(current_symbolic_instruction,
+                                current_instruction_location,
+                                statements_after_end);
             return;
-        case InstructionType::Comment:
-            std::cout << fmt::format(
-                "{:<10}{:<15}{:<30}\n", // Set format
-                "",                     // No location
-                "",                     // No contents
-                current_symbolic_instruction.get_original_instruction());
+        }
+
+        _translate_statement(current_symbolic_instruction,
+                             current_instruction_location);
+    }
+
+    _check_memory_sufficiency(current_instruction_location);
+    throw MissingEndStatementError();
+}
+
+void Assembler::_translate_statement(const SymbolicInstruction& statement,
+                                     int&                       location)
+{
+    if (statement.get_type() == InstructionType::Comment)
+    {
+        _statements.push_back({.symbolic = statement,
+                               .numeric = std::nullopt,
+                               .location = 0,
+                               .undefined_operands = 0});
+        return;
+    }
+
+    if (statement.contains_label())
+    {
+        _symbol_table.add_symbol(statement.get_label(), location);
+        _backpatch(statement.get_label(), location);
+    }
+
+    std::vector<int>   undefined_operands;
+    NumericInstruction numeric_instruction(statement, _symbol_table,
+                                           undefined_operands);
+
+    TranslatedStatement translated {.symbolic = statement,
+                                    .numeric = numeric_instruction,
+                                    .location = location,
+                                    .undefined_operands = 0};
+    for (int operand_number : undefined_operands)
+    {
+        std::string_view label {operand_number == 1
+                                    ? statement.get_operand_1()
+                                    : statement.get_operand_2()};
+
+        _fixups[label].emplace_back(_statements.size(), operand_number);
+        translated.undefined_operands |= 1 << operand_number;
+    }
+    _statements.push_back(std::move(translated));
+
+    location = get_location_of_next_instruction(statement, location);
+}
+
+void Assembler::_finish_single_pass(
+    const SymbolicInstruction&        end,
+    int                               location,
+    std::span<const std::string_view> statements_after_end)
+{
+    _check_memory_sufficiency(location);
+    _check_if_end_is_valid(statements_after_end);
+
+    _statements.push_back({.symbolic = end,
+                           .numeric = std::nullopt,
+                           .location = 0,
+                           .undefined_operands = 0});
+    _write_translated_statements();
+}
+
+void Assembler::_assemble_pipelined()
+{
+    SpscQueue<LineBatch> read_lines {BATCHES_IN_FLIGHT};
+    SpscQueue<LineBatch> parsed_lines {BATCHES_IN_FLIGHT};
+    _pipeline_stats = {};
+    auto start {std::chrono::steady_clock::now()};
+
+    std::thread reader {[&] { _read_batches(read_lines); }};
+    std::thread parser {[&] { _parse_batches(read_lines, parsed_lines); }};
+
+    // Closing the queues stops the other stages early after an error.
+    auto stop_stages {[&]
+                      {
+                          read_lines.close();
+                          parsed_lines.close();
+                          reader.join();
+                          parser.join();
+
+                          _pipeline_stats.translate.elapsed =
+                              std::chrono::steady_clock::now() - start;
+                      }};
+
+    try
+    {
+        _translate_batches(parsed_lines);
+    }
+    catch (...)
+    {
+        stop_stages();
+        throw;
+    }
+    stop_stages();
+}
+
+void Assembler::_read_batches(SpscQueue<LineBatch>& output)
+{
+    PipelineStageStats& stats {_pipeline_stats.read};
+    auto                start {std::chrono::steady_clock::now()};
+
+    while (!_instructions_file.end_of_file())
+    {
+        LineBatch batch;
+        batch.lines.reserve(LINES_PER_BATCH);
+
+        // Splitting the lines touches every page of the mapped source, so
+        // this is where the source is actually read from storage.
+        while (batch.lines.size() < LINES_PER_BATCH &&
+               !_instructions_file.end_of_file())
+        {
+            batch.lines.push_back(_instructions_file.get_next_line());
+        }
+
+        stats.lines += static_cast<long long>(batch.lines.size());
+        stats.batches++;
+
+        if (!wait_stalled(stats.stalled,
+                          [&] { return output.push(std::move(batch)); }))
+        {
+            break;
+        }
+    }
+
+    output.close();
+    stats.elapsed = std::chrono::steady_clock::now() - start;
+}
+
+void Assembler::_parse_batches(SpscQueue<LineBatch>& input,
+                               SpscQueue<LineBatch>& output)
+{
+    PipelineStageStats& stats {_pipeline_stats.parse};
+    auto                start {std::chrono::steady_clock::now()};
+
+    // Lines after the END statement or an error are passed on unparsed.
+    bool parsing {true};
+
+    while (auto batch {
+               wait_stalled(stats.stalled, [&] { return input.pop(); })})
+    {
+        try
+        {
+            for (std::size_t i = 0; parsing && i < batch->lines.size(); i++)
+            {
+                SymbolicInstruction statement(batch->lines[i]);
+                _check_opcode_enabled(statement);
+
+                batch->statements.push_back(statement);
+                parsing = statement.get_type() != InstructionType::End;
+            }
+        }
+        catch (...)
+        {
+            batch->error = std::current_exception();
+            parsing = false;
+        }
+
+        stats.lines += static_cast<long long>(batch->lines.size());
+        stats.batches++;
+
+        if (!wait_stalled(stats.stalled,
+                          [&] { return output.push(std::move(*batch)); }))
+        {
+            break;
+        }
+    }
+
+    output.close();
+    stats.elapsed = std::chrono::steady_clock::now() - start;
+}
+
+void Assembler::_translate_batches(SpscQueue<LineBatch>& input)
+{
+    PipelineStageStats& stats {_pipeline_stats.translate};
+
+    int current_instruction_location = 0;
+
+    std::optional<SymbolicInstruction> end;
+    std::vector<std::string_view>      statements_after_end;
+
+    while (auto batch {
+               wait_stalled(stats.stalled, [&] { return input.pop(); })})
+    {
+        stats.lines += static_cast<long long>(batch->lines.size());
+        stats.batches++;
+
+        if (end)
+        {
+            statements_after_end.insert(statements_after_end.end(),
+                                        batch->lines.begin(),
+                                        batch->lines.end());
             continue;
+        }
 
-        default:
-            NumericInstruction current_numeric_instruction(
-                current_symbolic_instruction, _symbol_table);
+        for (std::size_t i = 0; i < batch->statements.size(); i++)
+        {
+            const SymbolicInstruction& statement {batch->statements[i]};
 
-            std::cout << fmt::format(
-                "{:<10}{:<15}{:<30}\n", // Set format
-                current_instruction_location,
-                current_numeric_instruction.get_string_representation(),
-                current_symbolic_instruction.get_original_instruction());
+            if (statement.get_type() == InstructionType::End)
+            {
+                end = statement;
+                statements_after_end.assign(batch->lines.begin() + i + 1,
+                                            batch->lines.end());
+                break;
+            }
 
-            _emulator.insert(
-                current_instruction_location,
-                current_numeric_instruction.get_numeric_representation());
+            _translate_statement(statement, current_instruction_location);
         }
 
-        current_instruction_location = get_location_of_next_instruction(
-            current_symbolic_instruction, current_instruction_location);
+        // The line after the last statement parsed is the one that failed.
+        if (!end && batch->error)
+        {
+            std::rethrow_exception(batch->error);
+        }
+    }
+
+    if (end)
+    {
+        _finish_single_pass(*end, current_instruction_location,
+                            statements_after_end);
+        return;
     }
+
+    _check_memory_sufficiency(current_instruction_location);
+    throw MissingEndStatementError();
 }
 
-void Assembler::run_program_in_emulator() { _emulator.run_program(); }
\ No newline at end of file
+void Assembler::_backpatch(std::string_view label, int location)
+{
+    auto fixups {_fixups.find(label)};
+    if (fixups == _fixups.end())
+    {
+        return;
+    }
+
+    for (auto [statement_index, operand_number] : fixups->second)
+    {
+        TranslatedStatement& statement {_statements[statement_index]};
+
+        statement.numeric->set_operand(operand_number, location);
+        statement.undefined_operands &= ~(1 << operand_number);
+    }
+    _fixups.erase(fixups);
+}
+
+void Assembler::_write_translated_statements()
+{
+    // The listing reports the undefined label; memory stays as it was.
+    if (!_fixups.empty())
+    {
+        return;
+    }
+
+    // In statement order, so a later ORG overwrites like in pass_2.
+    for (const TranslatedStatement& statement : _statements)
+    {
+        if (!statement.numeric)
+        {
+            continue;
+        }
+
+        _emulator.insert(statement.location,
+                         statement.numeric->get_numeric_representation());
+
+        if (statement.numeric->has_extension_word())
+        {
+            _emulator.insert(statement.location + 1,
+                             statement.numeric->get_operand_3());
+        }
+    }
+
+    // Later resets restore memory to the assembled program.
+    _emulator.save_image();
+}
+
+void Assembler::display_listing() const
+{
+    if (_listing != nullptr)
+    {
+        _listing->add_translation_header();
+    }
+
+    for (const TranslatedStatement& statement : _statements)
+    {
+        if (!statement.numeric)
+        {
+            if (_listing != nullptr)
+            {
+                _listing->add_statement(
+                    statement.symbolic.get_original_instruction());
+            }
+            continue;
+        }
+
+        // pass_2 reports the first operand that has no location.
+        if (statement.undefined_operands != 0)
+        {
+            _flush_listing();
+            throw UndefinedLabelError(
+                statement.undefined_operands & (1 << 1)
+                    ? statement.symbolic.get_operand_1()
+                    : statement.symbolic.get_operand_2());
+        }
+
+        if (_listing != nullptr)
+        {
+            _listing->add_instruction(
+                statement.location, *statement.numeric,
+                statement.symbolic.get_original_instruction());
+        }
+    }
+
+    _flush_listing();
+}
+
+void Assembler::run_program_in_emulator() { _emulator.run_program(); }
+
+void Assembler::run_program_in_emulator(TraceWriter& trace_writer)
+{
+    _emulator.set_trace_sink(&trace_writer);
+    _emulator.run_program();
+    _emulator.set_trace_sink(nullptr);
+}
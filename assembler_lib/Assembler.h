@@ -7,11 +7,53 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "Emulator.h"
 #include "FileAccess.h"
+#include "Listing.h"
+#include "NumericInstruction.h"
+#include "SpscQueue.h"
 #include "SymbolTable.h"
 #include "SymbolicInstruction.h"
 
+class TraceWriter;
+
+/**
+ * @brief What a stage of the assemble_single_pass pipeline did.
+ */
+struct PipelineStageStats
+{
+    long long lines {0};
+    long long batches {0};
+
+    // The time from the start of the stage to its end, and the part of it
+    // spent waiting for the stage before or after it.
+    std::chrono::nanoseconds elapsed {0};
+    std::chrono::nanoseconds stalled {0};
+};
+
+/**
+ * @brief What the stages of the assemble_single_pass pipeline did.
+ */
+struct PipelineStats
+{
+    PipelineStageStats read;
+    PipelineStageStats parse;
+    PipelineStageStats translate;
+};
+
 /**
  * @brief The assembler class.
  * @details This class is the container for all the components that make up the
@@ -23,16 +65,43 @@ class Assembler
     /**
      * @brief Constructs an assembler object.
      * @param source_file_path The path to the source file.
+     * @param block_instructions True to accept the block instructions BCOPY,
+     * BADD, BFILL and BSUM, which are an extension of the VC1620.
      */
-    explicit Assembler(const std::string& source_file_path);
+    explicit Assembler(const std::string& source_file_path,
+                       bool               block_instructions = false);
     ~Assembler() = default;
 
+    /**
+     * @brief Sets the number of threads the passes use.
+     * @param thread_count The number of threads, or 0 for one per core.
+     */
+    void set_thread_count(int thread_count) { _thread_count = thread_count; }
+
+    /**
+     * @brief Sets where the symbol table and the translation are listed.
+     * @param listing_sink The listing, or nullptr to list nothing; it must
+     * outlive its use. By default the listing goes to the console.
+     */
+    void set_listing_sink(ListingSink* listing_sink)
+    {
+        _listing = listing_sink;
+    }
+
     /**
      * @brief Establishes the location of the symbols.
      * @details This is the first pass of the assembler. It establishes the
      * location of the symbols. It also checks if the memory is sufficient to
      * hold the program.
-     * @throws InvalidOpcodeError
+     *
+     * Large sources are split into chunks of lines that are parsed and
+     * checked on several threads. Each chunk's labels are located relative
+     * to where the chunk starts, unless an ORG in the chunk fixed their
+     * location, so the chunks are stitched together in source order
+     * afterwards. Errors are thrown as if the lines had been read one by
+     * one: the first error in the source is the one reported.
+     * @throws InvalidOpcodeError, also for block instructions unless they
+     * were enabled
      * @throws MultiplyDefinedLabelError
      * @throws UnmatchedOperandCountError
      * @throws InvalidOperandTypeError
@@ -49,7 +118,15 @@ class Assembler
      * @brief Translates the symbolic instructions to numeric instructions.
      * @details This is the second pass of the assembler. It translates the
      * symbolic instructions to numeric instructions, and writes them to the
-     * memory.
+     * memory. The assembled program becomes the emulator's loaded image.
+     * The translation is listed in the listing sink, if there is one.
+     *
+     * The chunks of lines pass_1 split the source into are translated on
+     * several threads, each starting at the location pass_1 found for it.
+     * The symbol table no longer changes, so the threads share it. The
+     * listing and the memory writes are then taken in source order, up to
+     * the first line that fails, so the outcome is the same as translating
+     * one line after the other.
      * @throws InvalidOpcodeError
      * @throws MultiplyDefinedLabelError
      * @throws UnmatchedOperandCountError
@@ -61,24 +138,259 @@ class Assembler
      * @throws InvalidConstantSizeError
      * @throws SymbolicOpcodeInLabelError
      * @throws UndefinedLabelError
+     * @throws ListingFileError
      */
     void pass_2();
 
     /**
-     * @brief Displays the symbol table.
+     * @brief Assembles the program reading the source only once.
+     * @details An alternative to pass_1 and pass_2. Each statement is
+     * translated as soon as it is read. Operands naming labels that are not
+     * defined yet are recorded in the label's fixup list and patched when
+     * the label is defined. At the END statement the program is written to
+     * memory and becomes the emulator's loaded image, as in pass_2. Errors
+     * are thrown as pass_1 throws them; undefined labels are reported by
+     * display_listing, as pass_2 reports them.
+     *
+     * With more than one thread the work is split into a pipeline: one
+     * thread reads the source, one parses and validates the statements, and
+     * the calling thread translates them. The stages pass batches of lines
+     * through bounded queues, so reading and parsing run ahead of the
+     * translation by at most a few batches. Errors are carried along with
+     * the batch of the line that caused them and thrown when the
+     * translation reaches that line, so they are the ones the sequential
+     * assembly throws.
+     * @throws InvalidOpcodeError, also for block instructions unless they
+     * were enabled
+     * @throws MultiplyDefinedLabelError
+     * @throws UnmatchedOperandCountError
+     * @throws InvalidOperandTypeError
+     * @throws ExtraStatementElementsError
+     * @throws InsufficientMemoryError
+     * @throws MissingEndStatementError
+     * @throws StatementAfterEndError
+     * @throws InvalidConstantSizeError
+     * @throws SymbolicOpcodeInLabelError
      */
-    void display_symbol_table() const { _symbol_table.display_symbol_table(); }
+    void assemble_single_pass();
+
+    /**
+     * @brief Gets what the stages of the last pipelined assembly did.
+     * @return The counters of each stage; all zero if assemble_single_pass
+     * ran on one thread.
+     */
+    [[nodiscard]] const PipelineStats& get_pipeline_stats() const
+    {
+        return _pipeline_stats;
+    }
+
+    /**
+     * @brief Displays the translation of a program assembled by
+     * assemble_single_pass.
+     * @details The listing is the one pass_2 displays. Without a listing
+     * sink nothing is listed, but undefined labels are still reported.
+     * @throws UndefinedLabelError at the first statement using a label that
+     * was never defined.
+     */
+    void display_listing() const;
+
+    /**
+     * @brief Displays the symbol table in the listing.
+     */
+    void display_symbol_table() const;
+
+    /**
+     * @brief Saves the assembled program and its symbols in an object file,
+     * so it can be run again without assembling it.
+     * @param object_file_path The path to the object file.
+     * @throws ObjectFileError
+     */
+    void write_object_file(const std::string& object_file_path) const;
 
     /**
      * @brief Runs the program in the emulator.
      */
     void run_program_in_emulator();
 
+    /**
+     * @brief Runs the program in the emulator and records every executed
+     * instruction.
+     * @param trace_writer The trace the executed instructions are written to.
+     */
+    void run_program_in_emulator(TraceWriter& trace_writer);
+
+    /**
+     * @brief Gets the emulator the program is assembled into.
+     * @return The emulator.
+     */
+    Emulator& get_emulator() { return _emulator; }
+
   private:
     FileAccess  _instructions_file;
     SymbolTable _symbol_table;
     Emulator    _emulator;
 
+    ConsoleListing _console_listing;
+    ListingSink*   _listing {&_console_listing};
+
+    bool _block_instructions {false};
+    int  _thread_count {0};
+
+    // A label found by pass_1 in a chunk of lines.
+    struct ChunkLabel
+    {
+        std::string_view label;
+        int              location {0};
+
+        // False if the location is relative to the start of the chunk.
+        bool absolute {false};
+    };
+
+    // A chunk of the source lines and the location it starts at.
+    struct SourceChunk
+    {
+        std::span<const std::string_view> lines;
+        int                               location {0};
+    };
+
+    // The source lines and the chunks pass_1 split them into, up to the one
+    // holding the END statement, for pass_2 to translate.
+    std::vector<std::string_view> _lines;
+    std::vector<SourceChunk>      _chunks;
+
+    // What pass_1 found in a chunk of lines.
+    struct Pass1Chunk
+    {
+        std::vector<ChunkLabel> labels;
+
+        // The location after the last line scanned, as for the labels.
+        int  location {0};
+        bool absolute {false};
+
+        // Scanning stops at the END statement or at the first error.
+        bool               found_end {false};
+        std::size_t        end_line {0};
+        std::exception_ptr error;
+    };
+
+    // What pass_2 made of a chunk of lines.
+    struct Pass2Chunk
+    {
+        // Empty if nothing is listed.
+        std::unique_ptr<MemoryListing> listing;
+
+        // The words to write to memory, as location and contents, in order.
+        std::vector<std::pair<int, long long>> words;
+
+        // Translating stops at the END statement or at the first error.
+        bool               found_end {false};
+        std::exception_ptr error;
+    };
+
+    // A statement translated by assemble_single_pass.
+    struct TranslatedStatement
+    {
+        SymbolicInstruction symbolic;
+
+        // Empty for comments and the END statement.
+        std::optional<NumericInstruction> numeric;
+        int                               location {0};
+
+        // Bit n is set while operand n waits for its label to be defined.
+        int undefined_operands {0};
+    };
+
+    std::vector<TranslatedStatement> _statements;
+
+    // A batch of source lines on its way through the assemble_single_pass
+    // pipeline.
+    struct LineBatch
+    {
+        std::vector<std::string_view> lines;
+
+        // The statements parsed from the lines. Parsing stops after the END
+        // statement and at the first error, which is kept.
+        std::vector<SymbolicInstruction> statements;
+        std::exception_ptr               error;
+    };
+
+    PipelineStats _pipeline_stats;
+
+    // For each label used before its definition, the statements and
+    // operand numbers that use it. Labels are views into the source file.
+    std::unordered_map<std::string_view,
+                       std::vector<std::pair<std::size_t, int>>>
+        _fixups;
+
+    /**
+     * @brief Translates a statement for assemble_single_pass.
+     * @param statement The statement, which is not the END statement.
+     * @param location The location of the statement, moved on to the
+     * location of the next one.
+     * @throws MultiplyDefinedLabelError
+     * @throws InvalidConstantSizeError
+     */
+    void _translate_statement(const SymbolicInstruction& statement,
+                              int&                       location);
+
+    /**
+     * @brief Finishes assemble_single_pass at the END statement.
+     * @param end The END statement.
+     * @param location The location after the last statement.
+     * @param statements_after_end The lines after the END statement.
+     * @throws InsufficientMemoryError
+     * @throws StatementAfterEndError
+     */
+    void _finish_single_pass(
+        const SymbolicInstruction&        end,
+        int                               location,
+        std::span<const std::string_view> statements_after_end);
+
+    /**
+     * @brief Runs assemble_single_pass as a pipeline of three stages.
+     */
+    void _assemble_pipelined();
+
+    /**
+     * @brief The read stage: splits the source into batches of lines.
+     * @param output The queue to the parse stage, closed at the end.
+     */
+    void _read_batches(SpscQueue<LineBatch>& output);
+
+    /**
+     * @brief The parse stage: parses and validates the lines of batches.
+     * @param input The queue from the read stage.
+     * @param output The queue to the translate stage, closed at the end.
+     */
+    void _parse_batches(SpscQueue<LineBatch>& input,
+                        SpscQueue<LineBatch>& output);
+
+    /**
+     * @brief The translate stage: translates the statements of batches.
+     * @param input The queue from the parse stage.
+     * @throws Whatever assemble_single_pass throws, in source order.
+     */
+    void _translate_batches(SpscQueue<LineBatch>& input);
+
+    /**
+     * @brief Patches the uses of a label recorded before its definition.
+     * @param label The label just defined.
+     * @param location The location of the label.
+     */
+    void _backpatch(std::string_view label, int location);
+
+    /**
+     * @brief Writes the statements translated by assemble_single_pass to
+     * memory, unless some label is still undefined.
+     */
+    void _write_translated_statements();
+
+    /**
+     * @brief Hands what was listed so far to the listing's destination.
+     * @throws ListingFileError
+     */
+    void _flush_listing() const;
+
     /**
      * @brief Checks if the memory is sufficient to hold the program.
      * @param last_instruction_location The location of the last instruction.
@@ -86,10 +398,63 @@ class Assembler
     void _check_memory_sufficiency(int last_instruction_location) const;
 
     /**
-     * @brief Checks if the end statement is valid and throws error if not.
-     * @details The end statement is valid if it is the last statement in the
-     * program and there are no statements after it. If the end statement is
-     * invalid, a StatementAfterEndError is thrown.
+     * @brief Checks that the lines after the end statement are empty.
+     * @param statements_after_end The lines after the end statement.
+     * @throws StatementAfterEndError
+     */
+    static void _check_if_end_is_valid(
+        std::span<const std::string_view> statements_after_end);
+
+    /**
+     * @brief Gets the number of threads to use.
+     * @return The number of threads, at least 1.
+     */
+    [[nodiscard]] int _get_thread_count() const;
+
+    /**
+     * @brief Gets a chunk of the source lines.
+     * @param chunk_index The index of the chunk.
+     * @param chunk_count The number of chunks.
+     * @return The lines of the chunk.
+     */
+    [[nodiscard]] std::span<const std::string_view>
+    _get_chunk(std::size_t chunk_index, std::size_t chunk_count) const;
+
+    /**
+     * @brief Runs a task for each chunk of the source, on several threads.
+     * @param chunk_count The number of chunks; one runs on the calling
+     * thread.
+     * @param task The task, called with the index of each chunk.
+     */
+    static void
+    _for_each_chunk(std::size_t                             chunk_count,
+                    const std::function<void(std::size_t)>& task);
+
+    /**
+     * @brief Scans a chunk of lines for pass_1.
+     * @param lines The lines of the chunk.
+     * @return What the chunk holds; errors are caught and kept in it.
+     */
+    [[nodiscard]] Pass1Chunk
+    _scan_chunk(std::span<const std::string_view> lines) const;
+
+    /**
+     * @brief Translates a chunk of lines for pass_2.
+     * @param lines The lines of the chunk.
+     * @param location The location of the first line.
+     * @return The listing and memory contents of the chunk; errors are
+     * caught and kept in it.
+     */
+    [[nodiscard]] Pass2Chunk
+    _translate_chunk(std::span<const std::string_view> lines,
+                     int                               location) const;
+
+    /**
+     * @brief Checks that the opcode of an instruction is accepted.
+     * @details Block instructions are only accepted when they were enabled,
+     * so programs for the plain VC1620 cannot use them by accident.
+     * @param instruction The instruction.
+     * @throws InvalidOpcodeError
      */
-    void _check_if_end_is_valid();
+    void _check_opcode_enabled(const SymbolicInstruction& instruction) const;
 };
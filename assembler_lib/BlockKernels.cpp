@@ -0,0 +1,124 @@
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLOCK_KERNELS_SSE2
+#endif
+
+#include "BlockKernels.h"
+
+namespace
+{
+/**
+ * @brief Adds two cells, wrapping around on overflow like the SSE2 lanes.
+ * @param a The first cell.
+ * @param b The second cell.
+ * @return The sum.
+ */
+inline long long add_cells(long long a, long long b)
+{
+    return static_cast<long long>(static_cast<std::uint64_t>(a) +
+                                  static_cast<std::uint64_t>(b));
+}
+
+#ifdef BLOCK_KERNELS_SSE2
+/**
+ * @brief Adds two cells of a source to two cells of a destination.
+ * @param destination The first of the two cells to add to.
+ * @param source The first of the two cells to add.
+ */
+inline void add_pair(long long* destination, const long long* source)
+{
+    __m128i augend {_mm_loadu_si128(reinterpret_cast<__m128i*>(destination))};
+    __m128i addend {
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source))};
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination),
+                     _mm_add_epi64(augend, addend));
+}
+#endif
+} // namespace
+
+void copy_block(long long* destination, const long long* source, int length)
+{
+    // The C library's memmove is already vectorised.
+    std::memmove(destination, source, sizeof(long long) * length);
+}
+
+void add_block(long long* destination, const long long* source, int length)
+{
+    // A destination above an overlapping source is processed from the end,
+    // so no source cell is read after it was added to.
+    bool backwards {destination > source && destination < source + length};
+
+    if (!backwards)
+    {
+        int i {0};
+#ifdef BLOCK_KERNELS_SSE2
+        for (; i + 2 <= length; i += 2)
+        {
+            add_pair(destination + i, source + i);
+        }
+#endif
+        for (; i < length; i++)
+        {
+            destination[i] = add_cells(destination[i], source[i]);
+        }
+        return;
+    }
+
+    int i {length};
+#ifdef BLOCK_KERNELS_SSE2
+    for (; i >= 2; i -= 2)
+    {
+        add_pair(destination + i - 2, source + i - 2);
+    }
+#endif
+    for (; i > 0; i--)
+    {
+        destination[i - 1] = add_cells(destination[i - 1], source[i - 1]);
+    }
+}
+
+void fill_block(long long* destination, long long value, int length)
+{
+    int i {0};
+#ifdef BLOCK_KERNELS_SSE2
+    __m128i values {_mm_set1_epi64x(value)};
+    for (; i + 2 <= length; i += 2)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), values);
+    }
+#endif
+    for (; i < length; i++)
+    {
+        destination[i] = value;
+    }
+}
+
+long long sum_block(const long long* source, int length)
+{
+    long long sum {0};
+    int       i {0};
+#ifdef BLOCK_KERNELS_SSE2
+    // Two independent accumulators keep both adders busy.
+    __m128i sums[2] {_mm_setzero_si128(), _mm_setzero_si128()};
+    for (; i + 4 <= length; i += 4)
+    {
+        const auto* cells {reinterpret_cast<const __m128i*>(source + i)};
+        sums[0] = _mm_add_epi64(sums[0], _mm_loadu_si128(cells));
+        sums[1] = _mm_add_epi64(sums[1], _mm_loadu_si128(cells + 1));
+    }
+
+    alignas(16) long long lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes),
+                    _mm_add_epi64(sums[0], sums[1]));
+    sum = add_cells(lanes[0], lanes[1]);
+#endif
+    for (; i < length; i++)
+    {
+        sum = add_cells(sum, source[i]);
+    }
+    return sum;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file BlockKernels.h
+ * @brief Kernels that run the block instructions over ranges of cells.
+ * @details Where SSE2 is available the kernels process two cells per
+ * operation; elsewhere they fall back to one cell at a time. Arithmetic
+ * wraps around on overflow either way. Overlapping ranges are handled as
+ * memmove does: every source cell is read before it is overwritten.
+ */
+
+#pragma once
+
+/**
+ * @brief Copies a block of cells.
+ * @param destination The first cell to write.
+ * @param source The first cell to read.
+ * @param length The number of cells.
+ */
+void copy_block(long long* destination, const long long* source, int length);
+
+/**
+ * @brief Adds a block of cells to another, cell by cell.
+ * @param destination The first cell to add to.
+ * @param source The first cell to add.
+ * @param length The number of cells.
+ */
+void add_block(long long* destination, const long long* source, int length);
+
+/**
+ * @brief Stores a value in a block of cells.
+ * @param destination The first cell to write.
+ * @param value The value.
+ * @param length The number of cells.
+ */
+void fill_block(long long* destination, long long value, int length);
+
+/**
+ * @brief Adds up a block of cells.
+ * @param source The first cell to read.
+ * @param length The number of cells.
+ * @return The sum of the cells.
+ */
+long long sum_block(const long long* source, int length);
@@ -1,88 +1,905 @@
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <vector>
 
+#include "BlockKernels.h"
 #include "Emulator.h"
+#include "Exceptions.h"
 #include "InstructionDefinitions.h"
+#include "PagePool.h"
+#include "StateInspector.h"
+#include "StatsSegment.h"
+#include "TraceFile.h"
+
+namespace
+{
+ConsoleInput  console_input;
+ConsoleOutput console_output;
+
+/**
+ * @brief Gets the weight of a cell in the memory digest.
+ * @details The digest is the sum of every cell times its weight, modulo
+ * 2^64. Weights are odd, so changing any single cell changes the digest, and
+ * a store updates the digest with one multiplication.
+ * @param address The address of the cell.
+ * @return The weight of the cell.
+ */
+inline std::uint64_t get_digest_weight(int address)
+{
+    return static_cast<std::uint64_t>(address) * 0x9E3779B97F4A7C15 | 1;
+}
+
+/**
+ * @brief Gets the change in the memory digest when a cell is overwritten.
+ * @param address The address of the cell.
+ * @param old_value The contents being replaced.
+ * @param new_value The new contents.
+ * @return The amount to add to the digest.
+ */
+inline std::uint64_t get_digest_change(int address, long long old_value,
+                                       long long new_value)
+{
+    return (static_cast<std::uint64_t>(new_value) -
+            static_cast<std::uint64_t>(old_value)) *
+           get_digest_weight(address);
+}
+
+/**
+ * @brief Computes the part of the memory digest that comes from a range.
+ * @param memory The memory.
+ * @param first The first cell of the range.
+ * @param length The number of cells in the range.
+ * @return The sum of the cells in the range times their weights.
+ */
+std::uint64_t get_block_digest(const long long* memory, int first, int length)
+{
+    std::uint64_t digest {0};
+
+    for (int address = first; address < first + length; address++)
+    {
+        digest += static_cast<std::uint64_t>(memory[address]) *
+                  get_digest_weight(address);
+    }
+
+    return digest;
+}
+
+/**
+ * @brief Gets the memory cells an instruction reads or writes.
+ * @details Block instructions look through trap words themselves, so their
+ * ranges are not reported.
+ * @param instruction The decoded instruction.
+ * @param cells Receives the cells.
+ * @return The number of cells stored in cells.
+ */
+int get_data_cells(const DecodedInstruction& instruction,
+                   std::array<int, 2>&       cells)
+{
+    using enum NumericOpcode;
+
+    int cell_count {0};
+
+    switch (instruction.opcode)
+    {
+    case ADD:
+    case SUB:
+    case MULT:
+    case DIV:
+    case COPY:
+        cells[cell_count++] = instruction.operand1;
+        cells[cell_count++] = instruction.operand2;
+        break;
+    case READ:
+    case WRITE:
+        cells[cell_count++] = instruction.operand1;
+        break;
+    case BM:
+    case BZ:
+    case BP:
+        cells[cell_count++] = instruction.operand2;
+        break;
+    default:
+        break;
+    }
+
+    // Words that are not really instructions may decode to any operand.
+    for (int i = 0; i < cell_count; i++)
+    {
+        if (cells[i] < 0 || cells[i] >= Emulator::MEMORY_SIZE)
+            return 0;
+    }
+
+    return cell_count;
+}
+} // namespace
+
+Emulator::Emulator(PagePool* page_pool)
+    : _page_pool(page_pool), _input(&console_input), _output(&console_output)
+{
+}
+
+DecodedInstruction Emulator::decode(long long contents)
+{
+    DecodedInstruction instruction;
+
+    instruction.operand2 = static_cast<int>(contents % 1'00000);
+    contents /= 1'00000;
+
+    instruction.operand1 = static_cast<int>(contents % 1'00000);
+    contents /= 1'00000;
+
+    instruction.opcode = static_cast<NumericOpcode>(contents);
+
+    return instruction;
+}
 
 void Emulator::insert(int location, long long int contents)
 {
-    _memory[location] = contents;
+    if (auto patched_cell {_patched_cells.find(location)};
+        patched_cell != _patched_cells.end())
+    {
+        _digest +=
+            get_digest_change(location, patched_cell->second, contents);
+
+        patched_cell->second = contents;
+        return;
+    }
+
+    _digest += get_digest_change(location, _memory[location], contents);
+
+    _memory_pages.write_unwatched(location, contents);
+    _dirty_pages[location / DIRTY_PAGE_SIZE] = true;
+}
+
+long long Emulator::peek(int location) const
+{
+    if (!_patched_cells.empty())
+    {
+        if (auto patched_cell {_patched_cells.find(location)};
+            patched_cell != _patched_cells.end())
+        {
+            return patched_cell->second;
+        }
+    }
+
+    return _memory[location];
+}
+
+void Emulator::set_input_source(InputSource* input)
+{
+    _input = input != nullptr ? input : &console_input;
 }
 
-void Emulator::run_program()
+void Emulator::set_output_sink(OutputSink* output)
 {
-    int current_instruction_location = 100;
+    _output = output != nullptr ? output : &console_output;
+}
 
-    while (true)
+void Emulator::save_image()
+{
+    if (_page_pool != nullptr)
     {
-        long long int current_instruction =
-            _memory[current_instruction_location];
-
-        int operand2 {static_cast<int>(current_instruction % 1'00000)};
-        current_instruction /= 1'00000;
-
-        int operand1 {static_cast<int>(current_instruction % 1'00000)};
-        current_instruction /= 1'00000;
-
-        auto opcode = static_cast<NumericOpcode>(current_instruction);
-
-        using enum NumericOpcode;
-
-        switch (opcode)
-        {
-        case DC:
-        case DS:
-            break;
-        case ADD:
-            _memory[operand1] += _memory[operand2];
-            break;
-        case SUB:
-            _memory[operand1] -= _memory[operand2];
-            break;
-        case MULT:
-            _memory[operand1] *= _memory[operand2];
-            break;
-        case DIV:
-            _memory[operand1] /= _memory[operand2];
-            break;
-        case COPY:
-            _memory[operand1] = _memory[operand2];
-            break;
-        case READ:
-            std::cout << '?';
-            std::cin >> _memory[operand1];
-            std::cout << std::endl;
-            break;
-        case WRITE:
-            std::cout << _memory[operand1] << std::endl;
-            break;
-        case B:
-            current_instruction_location = operand1;
+        std::vector<long long> image(_memory, _memory + MEMORY_SIZE);
+        for (const auto& [location, original] : _patched_cells)
+        {
+            image[location] = original;
+        }
+
+        _map_image(image);
+        return;
+    }
+
+    _image_pages.copy_unwatched(0, _memory, MEMORY_SIZE);
+    for (const auto& [location, original] : _patched_cells)
+    {
+        _image_pages.write_unwatched(location, original);
+    }
+    _image = {_image_pages.data(), MEMORY_SIZE};
+
+    _dirty_pages.fill(false);
+    _image_digest = _digest;
+}
+
+void Emulator::load_image(std::span<const long long> image)
+{
+    if (_page_pool != nullptr)
+    {
+        _map_image(image);
+        return;
+    }
+
+    for (int location = 0; location < MEMORY_SIZE; location++)
+    {
+        insert(location, image.empty() ? 0 : image[location]);
+    }
+
+    save_image();
+}
+
+void Emulator::reset()
+{
+    std::vector<long long> zeros;
+    if (_image.empty())
+    {
+        zeros.resize(DIRTY_PAGE_SIZE, 0);
+    }
+
+    for (int page = 0; page < DIRTY_PAGE_COUNT; page++)
+    {
+        if (!_dirty_pages[page])
             continue;
-        case BM:
-            if (_memory[operand2] < 0)
+
+        int first {page * DIRTY_PAGE_SIZE};
+        int count {std::min(DIRTY_PAGE_SIZE, MEMORY_SIZE - first)};
+
+        if (_page_pool != nullptr)
+        {
+            _memory_pages.discard_private_pages(first, count);
+            continue;
+        }
+
+        _memory_pages.copy_unwatched(
+            first, _image.empty() ? zeros.data() : _image.data() + first,
+            count);
+    }
+    _dirty_pages.fill(false);
+
+    // Restoring a page removes the trap words in it, so patch them again.
+    // The patches were computed against the image, so they still apply.
+    for (auto& [location, original] : _patched_cells)
+    {
+        original = _get_image_cell(location);
+        _memory_pages.write_unwatched(location, TRAP_WORD);
+    }
+
+    _digest = _image_digest;
+    _location = START_LOCATION;
+    _instruction_count = 0;
+    _read_count = 0;
+    _write_count = 0;
+}
+
+std::vector<MemoryDelta> Emulator::get_memory_delta() const
+{
+    std::vector<MemoryDelta> delta;
+
+    for (int page = 0; page < DIRTY_PAGE_COUNT; page++)
+    {
+        if (!_dirty_pages[page])
+            continue;
+
+        int first {page * DIRTY_PAGE_SIZE};
+        int end {std::min(first + DIRTY_PAGE_SIZE, MEMORY_SIZE)};
+
+        for (int address = first; address < end; address++)
+        {
+            long long old_value {_get_image_cell(address)};
+            long long new_value {peek(address)};
+
+            if (old_value != new_value)
             {
-                current_instruction_location = operand1;
+                delta.push_back({address, old_value, new_value});
+            }
+        }
+    }
+
+    return delta;
+}
+
+void Emulator::read_page(int page, long long* cells) const
+{
+    int first {page * DIRTY_PAGE_SIZE};
+    int count {std::min(DIRTY_PAGE_SIZE, MEMORY_SIZE - first)};
+
+    std::copy(_memory + first, _memory + first + count, cells);
+
+    for (const auto& [location, original] : _patched_cells)
+    {
+        if (location / DIRTY_PAGE_SIZE == page)
+        {
+            cells[location - first] = original;
+        }
+    }
+}
+
+void Emulator::write_page(int page, const long long* cells)
+{
+    int first {page * DIRTY_PAGE_SIZE};
+    int count {std::min(DIRTY_PAGE_SIZE, MEMORY_SIZE - first)};
+
+    for (int i = 0; i < count; i++)
+    {
+        _digest += get_digest_change(first + i, peek(first + i), cells[i]);
+    }
+
+    _memory_pages.copy_unwatched(first, cells, count);
+    _dirty_pages[page] = true;
+
+    // Copying removes the trap words in the page, so patch them again.
+    for (auto& [location, original] : _patched_cells)
+    {
+        if (location / DIRTY_PAGE_SIZE == page)
+        {
+            original = _memory[location];
+            _memory_pages.write_unwatched(location, TRAP_WORD);
+        }
+    }
+}
+
+std::uint64_t Emulator::compute_memory_digest() const
+{
+    std::uint64_t digest {0};
+
+    for (int address = 0; address < MEMORY_SIZE; address++)
+    {
+        digest += static_cast<std::uint64_t>(peek(address)) *
+                  get_digest_weight(address);
+    }
+
+    return digest;
+}
+
+StopReason Emulator::run_program()
+{
+    _instruction_count = 0;
+    _read_count = 0;
+    _write_count = 0;
+    return _run(START_LOCATION, false);
+}
+
+StopReason Emulator::resume() { return _run(_location, true); }
+
+void Emulator::set_position(const RunPosition& position)
+{
+    _location = position.location;
+    _instruction_count = position.instruction_count;
+    _read_count = position.read_count;
+    _write_count = position.write_count;
+}
+
+void Emulator::add_breakpoint(int location)
+{
+    _breakpoints.insert(location);
+    _patch_breakpoints();
+}
+
+void Emulator::remove_breakpoint(int location)
+{
+    _breakpoints.erase(location);
+    _patch_breakpoints();
+}
+
+void Emulator::_map_image(std::span<const long long> image)
+{
+    int                    cells_per_page {_page_pool->get_cells_per_page()};
+    std::vector<long long> pages;
+
+    for (int first = 0; first < MEMORY_SIZE; first += cells_per_page)
+    {
+        int count {std::min(cells_per_page, MEMORY_SIZE - first)};
+        pages.push_back(image.empty()
+                            ? PagePool::ZERO_PAGE
+                            : _page_pool->intern(image.data() + first, count));
+    }
+
+    _memory_pages.map_pool_pages(*_page_pool, pages, true);
+    _image_pages.map_pool_pages(*_page_pool, pages, false);
+    _image = {_image_pages.data(), MEMORY_SIZE};
+    _dirty_pages.fill(false);
+
+    // Mapping replaced the trap words, so patch them again.
+    for (auto& [location, original] : _patched_cells)
+    {
+        original = _get_image_cell(location);
+        _memory_pages.write_unwatched(location, TRAP_WORD);
+    }
+
+    _digest = compute_memory_digest();
+    _image_digest = _digest;
+}
+
+void Emulator::_patch_breakpoints()
+{
+    for (const auto& [location, original] : _patched_cells)
+    {
+        _memory[location] = original;
+    }
+    _patched_cells.clear();
+
+    std::vector<bool> patched(MEMORY_SIZE, false);
+    for (int location : _breakpoints)
+    {
+        patched[location] = true;
+    }
+
+    // Any instruction that uses a patched cell would see a trap word, so it
+    // is patched too. Repeat until no more instructions are affected.
+    bool changed {!_breakpoints.empty()};
+    while (changed)
+    {
+        changed = false;
+
+        for (int location = 0; location < MEMORY_SIZE; location++)
+        {
+            if (patched[location])
                 continue;
+
+            std::array<int, 2> cells {};
+            int cell_count {get_data_cells(decode(_memory[location]), cells)};
+
+            for (int i = 0; i < cell_count; i++)
+            {
+                if (patched[cells[i]])
+                {
+                    patched[location] = true;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int location = 0; location < MEMORY_SIZE; location++)
+    {
+        if (patched[location])
+        {
+            _patched_cells[location] = _memory[location];
+            _memory[location] = TRAP_WORD;
+        }
+    }
+}
+
+StopReason Emulator::_run(int location, bool resuming)
+{
+    _limit_end = _instruction_limit > 0
+                     ? _instruction_count + _instruction_limit
+                     : std::numeric_limits<long long>::max();
+
+    _publish(location, _instruction_count, std::nullopt);
+
+    StopReason stop_reason;
+    if (_trace_sink != nullptr)
+    {
+        stop_reason = _run_traced(location, resuming);
+    }
+    else if (_memory_pages.has_watchpoints())
+    {
+        stop_reason = _run_untraced<true>(location, resuming);
+    }
+    else
+    {
+        stop_reason = _run_untraced<false>(location, resuming);
+    }
+
+    _publish(_location, _instruction_count, stop_reason);
+    return stop_reason;
+}
+
+long long Emulator::_get_slice_end(long long instruction_count) const
+{
+    if (_stats != nullptr || _inspector != nullptr)
+    {
+        return std::min(instruction_count + SLICE_SIZE, _limit_end);
+    }
+
+    return _limit_end;
+}
+
+void Emulator::_publish(int location, long long instruction_count,
+                        std::optional<StopReason> stop_reason)
+{
+    if (_inspector != nullptr)
+    {
+        _inspector->publish(location, instruction_count,
+                            stop_reason.has_value(), *this);
+    }
+
+    if (_stats == nullptr)
+    {
+        return;
+    }
+
+    StatsState state {StatsState::Running};
+    if (stop_reason == StopReason::Halt)
+    {
+        state = StatsState::Halted;
+    }
+    else if (stop_reason == StopReason::Breakpoint)
+    {
+        state = StatsState::Breakpoint;
+    }
+    else if (stop_reason == StopReason::InstructionLimit)
+    {
+        state = StatsState::InstructionLimit;
+    }
+
+    _stats->publish({.state = state,
+                     .instruction_count = instruction_count,
+                     .location = location,
+                     .read_count = _read_count,
+                     .write_count = _write_count});
+}
+
+template <bool Watched>
+StopReason Emulator::_run_untraced(int location, bool resuming)
+{
+    long long executed_count {_instruction_count};
+    long long slice_end {_get_slice_end(executed_count)};
+    int       next_location {location};
+
+    // The instruction count at which a breakpoint is ignored, if resuming.
+    long long resumed_count {resuming ? executed_count : -1};
+
+    while (next_location != HALTED)
+    {
+        location = next_location;
+
+        if constexpr (Watched)
+        {
+            _location = location;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+
+        next_location = _execute_instruction(location, executed_count);
+
+        if (next_location == TRAPPED)
+        {
+            if (executed_count != resumed_count &&
+                _breakpoints.contains(location))
+            {
+                _location = location;
+                _instruction_count = executed_count;
+                return StopReason::Breakpoint;
             }
-            break;
-        case BZ:
-            if (_memory[operand2] == 0)
+
+            next_location = _execute_unpatched(location, executed_count);
+        }
+
+        // Counters are published and the limit checked in slices, to keep
+        // the loop cheap.
+        if (++executed_count == slice_end)
+        {
+            if (executed_count >= _limit_end && next_location != HALTED)
             {
-                current_instruction_location = operand1;
-                continue;
+                _location = next_location;
+                _instruction_count = executed_count;
+                return StopReason::InstructionLimit;
             }
-            break;
-        case BP:
-            if (_memory[operand2] > 0)
+
+            _publish(next_location, executed_count, std::nullopt);
+            slice_end = _get_slice_end(executed_count);
+        }
+    }
+
+    _location = location;
+    _instruction_count = executed_count;
+    return StopReason::Halt;
+}
+
+StopReason Emulator::_run_traced(int location, bool resuming)
+{
+    long long slice_end {_get_slice_end(_instruction_count)};
+
+    while (true)
+    {
+        if (!resuming && _breakpoints.contains(location))
+        {
+            _location = location;
+            return StopReason::Breakpoint;
+        }
+        resuming = false;
+        _location = location;
+
+        // Decode before executing: the instruction may overwrite itself.
+        DecodedInstruction executed {decode(peek(location))};
+
+        TraceRecord record {_instruction_count, location, executed.opcode,
+                            executed.operand1, executed.operand2};
+
+        bool block {is_block_opcode(executed.opcode)};
+        if (block && location + 1 < MEMORY_SIZE)
+        {
+            record.value = peek(location + 1);
+        }
+
+        int next_location {_step(location, _instruction_count)};
+
+        if (trace_records_value(executed.opcode) && !block)
+        {
+            record.value = peek(executed.operand1);
+        }
+
+        _trace_sink->record(record);
+
+        if (++_instruction_count == slice_end)
+        {
+            if (_instruction_count >= _limit_end && next_location != HALTED)
             {
-                current_instruction_location = operand1;
-                continue;
+                _location = next_location;
+                return StopReason::InstructionLimit;
             }
-            break;
-        case HALT:
-            return;
+
+            _publish(next_location, _instruction_count, std::nullopt);
+            slice_end = _get_slice_end(_instruction_count);
+        }
+
+        if (next_location == HALTED)
+        {
+            _location = location;
+            return StopReason::Halt;
         }
 
-        current_instruction_location++;
+        location = next_location;
     }
-}
\ No newline at end of file
+}
+
+int Emulator::_step(int location, long long instruction_count)
+{
+    int next_location {_execute_instruction(location, instruction_count)};
+
+    if (next_location == TRAPPED)
+    {
+        next_location = _execute_unpatched(location, instruction_count);
+    }
+
+    return next_location;
+}
+
+int Emulator::_execute_unpatched(int location, long long instruction_count)
+{
+    std::array<int, 3> cells {location};
+    int                cell_count {1};
+
+    // A trap the program computed itself is not a patch, and opcode 99 is
+    // not an instruction, so it does nothing.
+    auto patched_cell {_patched_cells.find(location)};
+    if (patched_cell == _patched_cells.end())
+    {
+        return location + 1;
+    }
+
+    std::array<int, 2> data_cells {};
+    int                data_cell_count {
+        get_data_cells(decode(patched_cell->second), data_cells)};
+
+    for (int i = 0; i < data_cell_count; i++)
+    {
+        if (_patched_cells.contains(data_cells[i]) &&
+            std::find(cells.begin(), cells.begin() + cell_count,
+                      data_cells[i]) == cells.begin() + cell_count)
+        {
+            cells[cell_count++] = data_cells[i];
+        }
+    }
+
+    for (int i = 0; i < cell_count; i++)
+    {
+        _memory[cells[i]] = _patched_cells[cells[i]];
+    }
+
+    // The instruction may have written to a patched cell, so the new
+    // contents become the original contents. The traps go back even if the
+    // instruction throws, so the patches outlive a failed run.
+    auto repatch {[&]
+                  {
+                      for (int i = 0; i < cell_count; i++)
+                      {
+                          _patched_cells[cells[i]] = _memory[cells[i]];
+                          _memory[cells[i]] = TRAP_WORD;
+                      }
+                  }};
+
+    int next_location;
+    try
+    {
+        next_location = _execute_instruction(location, instruction_count);
+    }
+    catch (...)
+    {
+        repatch();
+        throw;
+    }
+    repatch();
+
+    return next_location;
+}
+
+void Emulator::_store(int address, long long value)
+{
+    // An instruction the program computed may write to a patched cell. The
+    // write goes to the original contents and the trap stays.
+    bool patched {false};
+    if (_memory[address] == TRAP_WORD) [[unlikely]]
+    {
+        if (auto patched_cell {_patched_cells.find(address)};
+            patched_cell != _patched_cells.end())
+        {
+            _memory_pages.write_unwatched(address, patched_cell->second);
+            patched = true;
+        }
+    }
+
+    _digest += get_digest_change(address, _memory[address], value);
+    _memory[address] = value;
+    _dirty_pages[address / DIRTY_PAGE_SIZE] = true;
+
+    if (patched)
+    {
+        _patched_cells[address] = value;
+        _memory_pages.write_unwatched(address, TRAP_WORD);
+    }
+}
+
+int Emulator::_execute_block(int location, long long instruction_count,
+                             const DecodedInstruction& instruction)
+{
+    using enum NumericOpcode;
+
+    auto [opcode, destination, source] {instruction};
+
+    auto in_memory {[](int first, long long length)
+                    { return first >= 0 && length <= MEMORY_SIZE - first; }};
+
+    long long length {location + 1 < MEMORY_SIZE ? peek(location + 1) : -1};
+
+    if (length < 0 || !in_memory(destination, opcode == BSUM ? 1 : length) ||
+        !in_memory(source, opcode == BFILL ? 1 : length))
+    {
+        throw BlockRangeError(location, instruction_count);
+    }
+
+    int cell_count {static_cast<int>(length)};
+
+    // The kernels must see the original contents of patched cells.
+    std::vector<int> unpatched_cells;
+    for (const auto& [cell, original] : _patched_cells)
+    {
+        if (_memory[cell] == TRAP_WORD)
+        {
+            _memory[cell] = original;
+            unpatched_cells.push_back(cell);
+        }
+    }
+
+    if (opcode == BSUM)
+    {
+        _store(destination, sum_block(_memory + source, cell_count));
+    }
+    else if (_memory_pages.has_watchpoints())
+    {
+        // A store that faults is reported for the cell it starts at, so the
+        // block is built aside and stored one cell at a time.
+        std::vector<long long> cells(_memory + destination,
+                                     _memory + destination + cell_count);
+        _run_block_kernel(opcode, cells.data(), source, cell_count);
+
+        for (int i = 0; i < cell_count; i++)
+        {
+            _store(destination + i, cells[i]);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+    }
+    else
+    {
+        std::uint64_t old_digest {
+            get_block_digest(_memory, destination, cell_count)};
+
+        _run_block_kernel(opcode, _memory + destination, source, cell_count);
+
+        _digest += get_block_digest(_memory, destination, cell_count) -
+                   old_digest;
+
+        for (int page = destination / DIRTY_PAGE_SIZE;
+             page * DIRTY_PAGE_SIZE < destination + cell_count; page++)
+        {
+            _dirty_pages[page] = true;
+        }
+    }
+
+    // The block may have written to a patched cell, so the new contents
+    // become the original contents.
+    for (int cell : unpatched_cells)
+    {
+        _patched_cells[cell] = _memory[cell];
+        _memory[cell] = TRAP_WORD;
+    }
+
+    return location + 2;
+}
+
+void Emulator::_run_block_kernel(NumericOpcode opcode, long long* cells,
+                                 int source, int cell_count) const
+{
+    using enum NumericOpcode;
+
+    switch (opcode)
+    {
+    case BCOPY:
+        copy_block(cells, _memory + source, cell_count);
+        break;
+    case BADD:
+        add_block(cells, _memory + source, cell_count);
+        break;
+    case BFILL:
+        fill_block(cells, _memory[source], cell_count);
+        break;
+    default:
+        break;
+    }
+}
+
+int Emulator::_branch(int location, bool taken, int target)
+{
+    int next_location {taken ? target : location + 1};
+
+    if (_coverage_map != nullptr)
+    {
+        auto edge {(static_cast<unsigned>(location) * 0x9E3779B1u >> 16) ^
+                   static_cast<unsigned>(next_location)};
+        _coverage_map[edge & (COVERAGE_MAP_SIZE - 1)]++;
+    }
+
+    return next_location;
+}
+
+int Emulator::_execute_instruction(int location, long long instruction_count)
+{
+    auto [opcode, operand1, operand2] {decode(_memory[location])};
+
+    using enum NumericOpcode;
+
+    switch (opcode)
+    {
+    case DC:
+    case DS:
+        break;
+    case ADD:
+        _store(operand1, _load(operand1) + _load(operand2));
+        break;
+    case SUB:
+        _store(operand1, _load(operand1) - _load(operand2));
+        break;
+    case MULT:
+        _store(operand1, _load(operand1) * _load(operand2));
+        break;
+    case DIV:
+        if (_load(operand2) == 0)
+        {
+            throw DivisionByZeroError(location, instruction_count);
+        }
+        _store(operand1, _load(operand1) / _load(operand2));
+        break;
+    case COPY:
+        _store(operand1, _load(operand2));
+        break;
+    case READ:
+        _store(operand1, _input->read_value(instruction_count));
+        _read_count++;
+        break;
+    case WRITE:
+        _output->write_value(_load(operand1));
+        _write_count++;
+        break;
+    case B:
+        return _branch(location, true, operand1);
+    case BM:
+        return _branch(location, _load(operand2) < 0, operand1);
+    case BZ:
+        return _branch(location, _load(operand2) == 0, operand1);
+    case BP:
+        return _branch(location, _load(operand2) > 0, operand1);
+    case HALT:
+        return HALTED;
+    case BCOPY:
+    case BADD:
+    case BFILL:
+    case BSUM:
+        return _execute_block(location, instruction_count,
+                              {opcode, operand1, operand2});
+    case TRAP:
+        return TRAPPED;
+    }
+
+    return location + 1;
+}
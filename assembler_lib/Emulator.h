@@ -7,6 +7,62 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "EmulatorIO.h"
+#include "InstructionDefinitions.h"
+#include "PagedMemory.h"
+
+class PagePool;
+class StateInspector;
+class StatsPublisher;
+class TraceSink;
+
+/**
+ * @brief A VC1620 machine word split into its fields.
+ */
+struct DecodedInstruction
+{
+    NumericOpcode opcode {NumericOpcode::DC};
+    int           operand1 {0};
+    int           operand2 {0};
+};
+
+/**
+ * @brief A memory cell whose contents differ from the loaded image.
+ */
+struct MemoryDelta
+{
+    int       address {0};
+    long long old_value {0};
+    long long new_value {0};
+};
+
+/**
+ * @brief Where a run is, enough to continue it from there.
+ */
+struct RunPosition
+{
+    int       location {0};
+    long long instruction_count {0};
+    long long read_count {0};
+    long long write_count {0};
+};
+
+/**
+ * @brief The reason the emulator stopped running a program.
+ */
+enum class StopReason
+{
+    Halt,
+    Breakpoint,
+    InstructionLimit
+};
 
 /**
  * @brief The emulator class.
@@ -15,26 +71,509 @@
 class Emulator
 {
   public:
-    const static int MEMORY_SIZE = 100'000;
+    static constexpr int MEMORY_SIZE = 100'000;
+    static constexpr int START_LOCATION = 100;
+
+    // Entries in an edge coverage map.
+    static constexpr int COVERAGE_MAP_SIZE = 1 << 16;
+
+    // Cells in a page of the dirty page map.
+    static constexpr int DIRTY_PAGE_SIZE = 512;
+    static constexpr int DIRTY_PAGE_COUNT =
+        (MEMORY_SIZE + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE;
+
+    // Instructions executed between two publications of the emulator state
+    // to stats segments and inspectors.
+    static constexpr int SLICE_SIZE = 1 << 16;
 
     /**
      * @brief Constructs an emulator object.
+     * @param page_pool A pool to map memory and the loaded image from, so
+     * pages identical to those of other emulators in the pool are held once,
+     * or nullptr to keep them private. The pool must outlive the emulator.
      */
-    Emulator() = default;
+    explicit Emulator(PagePool* page_pool = nullptr);
     ~Emulator() = default;
 
+    Emulator(const Emulator&) = delete;
+    Emulator& operator=(const Emulator&) = delete;
+
+    /**
+     * @brief Splits a machine word into its opcode and operands.
+     * @param contents The machine word.
+     * @return The decoded instruction.
+     */
+    [[nodiscard]] static DecodedInstruction decode(long long contents);
+
     /**
      * @brief Records instructions and data into simulated memory.
+     * @details Breakpoints are armed against the contents of memory at the
+     * time they are added, so programs should be loaded before breakpoints
+     * are set.
      * @param location The location in memory to record the contents.
      * @param contents The contents to record in memory.
      */
     void insert(int location, long long contents);
 
+    /**
+     * @brief Reads simulated memory as the program sees it.
+     * @param location The location in memory to read.
+     * @return The contents of the location, without debugger patches.
+     */
+    [[nodiscard]] long long peek(int location) const;
+
+    /**
+     * @brief Makes the current contents of memory the loaded image.
+     * @details reset and get_memory_delta compare against this image. Before
+     * it is first called, the image is memory filled with zeros. With a page
+     * pool, the pages of the image are interned and memory is mapped from
+     * them.
+     * @throws PagePoolError
+     */
+    void save_image();
+
+    /**
+     * @brief Gets the loaded image.
+     * @return The contents of memory when the image was saved, or an empty
+     * span if no image was saved.
+     */
+    [[nodiscard]] std::span<const long long> get_image() const
+    {
+        return _image;
+    }
+
+    /**
+     * @brief Loads an image taken from another emulator and saves it.
+     * @details With a page pool, memory is mapped from the pool directly.
+     * @param image The image, as returned by get_image.
+     * @throws PagePoolError
+     */
+    void load_image(std::span<const long long> image);
+
+    /**
+     * @brief Restores the loaded image so the program can be run again.
+     * @details Only pages written since the image was saved or memory was
+     * last reset are copied, so resetting after a short run is cheap. With
+     * a page pool, the private copies of those pages are dropped instead, so
+     * they are shared again. The instruction and I/O counts are cleared as
+     * well.
+     */
+    void reset();
+
+    /**
+     * @brief Gets the cells whose contents differ from the loaded image.
+     * @details Only the pages written since the image was saved or memory
+     * was last reset are compared.
+     * @return The changed cells, in address order.
+     */
+    [[nodiscard]] std::vector<MemoryDelta> get_memory_delta() const;
+
+    /**
+     * @brief Checks if a page was written since the image was saved or
+     * memory was last reset.
+     * @param page The index of the page.
+     * @return True if the page may differ from the loaded image.
+     */
+    [[nodiscard]] bool is_page_dirty(int page) const
+    {
+        return _dirty_pages[page];
+    }
+
+    /**
+     * @brief Copies a page of memory as the program sees it.
+     * @param page The index of the page.
+     * @param cells Receives the cells of the page; the last page is shorter
+     * than DIRTY_PAGE_SIZE.
+     */
+    void read_page(int page, long long* cells) const;
+
+    /**
+     * @brief Overwrites a page of memory, as insert does for each cell.
+     * @param page The index of the page.
+     * @param cells The new contents of the page.
+     */
+    void write_page(int page, const long long* cells);
+
+    /**
+     * @brief Gets a digest of the contents of memory.
+     * @details The digest is a weighted sum of the cells, kept up to date on
+     * each store, so reading it costs nothing.
+     * Runs that end with the same memory have the same digest; runs whose
+     * digests differ can be compared with get_memory_delta.
+     * @return The digest of memory as the program sees it.
+     */
+    [[nodiscard]] std::uint64_t get_memory_digest() const { return _digest; }
+
+    /**
+     * @brief Computes the digest of memory from scratch.
+     * @return The same value as get_memory_digest, computed in O(n).
+     */
+    [[nodiscard]] std::uint64_t compute_memory_digest() const;
+
     /**
      * @brief Runs the program recorded in memory.
+     * @return Why the program stopped.
+     * @throws DivisionByZeroError
+     * @throws BlockRangeError
      */
-    void run_program();
+    StopReason run_program();
+
+    /**
+     * @brief Continues the program from where it stopped.
+     * @details The instruction under the breakpoint that stopped the program
+     * is executed before any breakpoint is checked again.
+     * @return Why the program stopped.
+     * @throws DivisionByZeroError
+     * @throws BlockRangeError
+     */
+    StopReason resume();
+
+    /**
+     * @brief Gets where the run is.
+     * @return The location of the next instruction and the counters.
+     */
+    [[nodiscard]] RunPosition get_position() const
+    {
+        return {_location, _instruction_count, _read_count, _write_count};
+    }
+
+    /**
+     * @brief Moves the run to a position, so resume continues from there.
+     * @details Memory is not touched; restore it first with write_page.
+     * @param position A position returned by get_position.
+     */
+    void set_position(const RunPosition& position);
+
+    /**
+     * @brief Records every executed instruction, in a trace file or
+     * elsewhere.
+     * @param trace_sink The sink to record to, or nullptr to stop tracing.
+     */
+    void set_trace_sink(TraceSink* trace_sink) { _trace_sink = trace_sink; }
+
+    /**
+     * @brief Publishes live counters into a stats segment.
+     * @details The counters are published every SLICE_SIZE instructions
+     * and when the program stops.
+     * @param stats The segment to publish to, or nullptr to stop publishing.
+     */
+    void set_stats_publisher(StatsPublisher* stats) { _stats = stats; }
+
+    /**
+     * @brief Publishes the location and selected memory to other threads.
+     * @details Snapshots are published every SLICE_SIZE instructions and
+     * when the program stops, so a running program is seen at most one
+     * slice late.
+     * @param inspector The inspector to publish to, or nullptr to stop
+     * publishing.
+     */
+    void set_state_inspector(StateInspector* inspector)
+    {
+        _inspector = inspector;
+    }
+
+    /**
+     * @brief Counts the branch edges the program takes.
+     * @details Every executed branch instruction, taken or not, increments
+     * the entry of the map chosen by a hash of its location and the location
+     * it continues at. Counts wrap around.
+     * @param coverage_map A map of COVERAGE_MAP_SIZE entries, or nullptr to
+     * stop counting.
+     */
+    void set_coverage_map(unsigned char* coverage_map)
+    {
+        _coverage_map = coverage_map;
+    }
+
+    /**
+     * @brief Limits the instructions executed by each call to run_program or
+     * resume, so programs that never halt can be stopped.
+     * @param instruction_limit The limit, or 0 for no limit.
+     */
+    void set_instruction_limit(long long instruction_limit)
+    {
+        _instruction_limit = instruction_limit;
+    }
+
+    /**
+     * @brief Sets where READ takes its values from.
+     * @param input The input source, or nullptr for the console.
+     */
+    void set_input_source(InputSource* input);
+
+    /**
+     * @brief Sets where WRITE sends its values.
+     * @param output The output sink, or nullptr for the console.
+     */
+    void set_output_sink(OutputSink* output);
+
+    /**
+     * @brief Stops the program before the instruction at a location runs.
+     * @details The instruction is replaced by a trap word, so running
+     * instructions pays nothing for breakpoints. Instructions that read or
+     * write patched cells are patched as well and executed against the
+     * original contents, so programs never see the trap words.
+     * @param location The location of the instruction.
+     */
+    void add_breakpoint(int location);
+
+    /**
+     * @brief Removes a breakpoint.
+     * @param location The location of the instruction.
+     */
+    void remove_breakpoint(int location);
+
+    /**
+     * @brief Checks if there is a breakpoint at a location.
+     * @param location The location of the instruction.
+     * @return True if the program stops before the instruction runs.
+     */
+    [[nodiscard]] bool has_breakpoint(int location) const
+    {
+        return _breakpoints.contains(location);
+    }
+
+    /**
+     * @brief Reports every write to a memory cell.
+     * @details The page holding the cell is write-protected, so only writes
+     * to that page pay for the watchpoint.
+     * @param address The cell to watch.
+     * @throws WatchpointError
+     */
+    void add_watchpoint(int address) { _memory_pages.add_watchpoint(address); }
+
+    /**
+     * @brief Removes a watchpoint.
+     * @param address The watched cell.
+     */
+    void remove_watchpoint(int address)
+    {
+        _memory_pages.remove_watchpoint(address);
+    }
+
+    /**
+     * @brief Gets the writes to watched cells since the last call.
+     * @return The writes, in the order they happened.
+     */
+    std::vector<WatchpointHit> take_watchpoint_hits()
+    {
+        return _memory_pages.take_watchpoint_hits();
+    }
+
+    /**
+     * @brief Gets the location the program stopped at.
+     * @return The location of the HALT or of the instruction under the
+     * breakpoint.
+     */
+    [[nodiscard]] int get_location() const { return _location; }
+
+    /**
+     * @brief Gets the number of instructions executed by the last run.
+     * @return The number of instructions executed.
+     */
+    [[nodiscard]] long long get_instruction_count() const
+    {
+        return _instruction_count;
+    }
 
   private:
-    std::array<long long, MEMORY_SIZE> _memory {0};
+    // Returned by _execute_instruction when the program has halted.
+    static constexpr int HALTED = -1;
+
+    // Returned by _execute_instruction when it finds a trap word.
+    static constexpr int TRAPPED = -2;
+
+    static constexpr long long TRAP_WORD =
+        static_cast<long long>(NumericOpcode::TRAP) * 1'00000'00000;
+
+    // Published before each instruction while cells are watched, so the
+    // fault handler can report the instruction that wrote a cell.
+    int       _location {START_LOCATION};
+    long long _instruction_count {0};
+
+    PagedMemory _memory_pages {MEMORY_SIZE, &_location};
+    long long*  _memory {_memory_pages.data()};
+
+    // Pages written since the image was saved or memory was last reset.
+    std::array<bool, DIRTY_PAGE_COUNT> _dirty_pages {};
+
+    PagePool* _page_pool {nullptr};
+
+    // The loaded image, or empty if it is all zeros. Points into
+    // _image_pages, which is mapped read-only from the pool if there is one.
+    PagedMemory                _image_pages {MEMORY_SIZE, &_location};
+    std::span<const long long> _image;
+
+    // Digest of memory without debugger patches, and of the loaded image.
+    std::uint64_t _digest {0};
+    std::uint64_t _image_digest {0};
+
+    TraceSink* _trace_sink {nullptr};
+
+    InputSource* _input;
+    OutputSink*  _output;
+
+    long long _read_count {0};
+    long long _write_count {0};
+
+    StatsPublisher* _stats {nullptr};
+    StateInspector* _inspector {nullptr};
+
+    unsigned char* _coverage_map {nullptr};
+
+    long long _instruction_limit {0};
+
+    // Instruction count at which the current call reaches the limit.
+    long long _limit_end {0};
+
+    std::set<int> _breakpoints;
+
+    // Original contents of the cells holding trap words.
+    std::unordered_map<int, long long> _patched_cells;
+
+    /**
+     * @brief Executes a single instruction.
+     * @param location The location of the instruction to execute.
+     * @param instruction_count The number of instructions executed before
+     * this one, passed to the input source.
+     * @return The location of the next instruction, HALTED or TRAPPED.
+     */
+    int _execute_instruction(int location, long long instruction_count);
+
+    /**
+     * @brief Executes a patched instruction against the original contents of
+     * the cells it uses, then patches them again.
+     * @param location The location of the patched instruction.
+     * @param instruction_count The number of instructions executed before
+     * this one.
+     * @return The location of the next instruction or HALTED.
+     */
+    int _execute_unpatched(int location, long long instruction_count);
+
+    /**
+     * @brief Executes a single instruction, looking through patches.
+     * @param location The location of the instruction to execute.
+     * @param instruction_count The number of instructions executed before
+     * this one.
+     * @return The location of the next instruction or HALTED.
+     */
+    int _step(int location, long long instruction_count);
+
+    /**
+     * @brief Runs instructions until the program halts or hits a breakpoint.
+     * @param location The location of the first instruction.
+     * @param resuming True if a breakpoint at the first instruction is to be
+     * ignored.
+     * @return Why the program stopped.
+     */
+    StopReason _run(int location, bool resuming);
+
+    /**
+     * @brief Like _run, without tracing.
+     * @tparam Watched True if the location of each instruction is published
+     * for watchpoints.
+     */
+    template <bool Watched>
+    StopReason _run_untraced(int location, bool resuming);
+
+    /**
+     * @brief Like _run, but records every executed instruction.
+     */
+    StopReason _run_traced(int location, bool resuming);
+
+    /**
+     * @brief Executes a block instruction.
+     * @details The block length is the word after the instruction. Blocks
+     * are processed by SIMD kernels, except that stores to watched pages are
+     * made one cell at a time so that each is reported.
+     * @param location The location of the instruction.
+     * @param instruction_count The number of instructions executed before
+     * this one.
+     * @param instruction The decoded instruction.
+     * @return The location after the block length.
+     * @throws BlockRangeError
+     */
+    int _execute_block(int location, long long instruction_count,
+                       const DecodedInstruction& instruction);
+
+    /**
+     * @brief Runs the kernel of BCOPY, BADD or BFILL.
+     * @param opcode The opcode of the instruction.
+     * @param cells The destination block, in memory or a copy of it.
+     * @param source The first source cell, or the cell BFILL stores.
+     * @param cell_count The block length.
+     */
+    void _run_block_kernel(NumericOpcode opcode, long long* cells, int source,
+                           int cell_count) const;
+
+    /**
+     * @brief Loads a value read by an instruction, looking through patches.
+     * @param address The cell to read.
+     * @return The contents of the cell.
+     */
+    [[nodiscard]] long long _load(int address) const
+    {
+        long long value {_memory[address]};
+        return value == TRAP_WORD ? peek(address) : value;
+    }
+
+    /**
+     * @brief Stores a value written by an instruction.
+     * @details Updates the memory digest and the dirty page map. A patched
+     * cell keeps its trap and gets the value as its original contents.
+     * @param address The cell to write.
+     * @param value The value to store.
+     */
+    void _store(int address, long long value);
+
+    /**
+     * @brief Gets the contents of a cell in the loaded image.
+     * @param address The cell.
+     * @return The contents of the cell when the image was saved.
+     */
+    [[nodiscard]] long long _get_image_cell(int address) const
+    {
+        return _image.empty() ? 0 : _image[address];
+    }
+
+    /**
+     * @brief Finishes a branch instruction.
+     * @param location The location of the branch.
+     * @param taken True if the branch is taken.
+     * @param target The location branched to.
+     * @return The location of the next instruction.
+     */
+    int _branch(int location, bool taken, int target);
+
+    /**
+     * @brief Gets the instruction count at which the current slice ends.
+     * @details A slice ends where the state is next published or where the
+     * instruction limit is reached.
+     * @param instruction_count The instruction count of the slice start.
+     * @return The end of the slice, or LLONG_MAX if there is no such point.
+     */
+    [[nodiscard]] long long _get_slice_end(long long instruction_count) const;
+
+    /**
+     * @brief Publishes the state to the stats segment and inspector.
+     * @param location The location of the next instruction.
+     * @param instruction_count The number of instructions executed.
+     * @param stop_reason Why the program stopped, if it did.
+     */
+    void _publish(int location, long long instruction_count,
+                        std::optional<StopReason> stop_reason);
+
+    /**
+     * @brief Interns the pages of an image in the page pool and maps memory
+     * and the image from them.
+     * @param image The image, or an empty span for all zeros.
+     * @throws PagePoolError
+     */
+    void _map_image(std::span<const long long> image);
+
+    /**
+     * @brief Restores all patched cells, then patches the breakpoints and
+     * every instruction that uses a patched cell.
+     */
+    void _patch_breakpoints();
 };
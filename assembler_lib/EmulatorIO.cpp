@@ -0,0 +1,39 @@
+#include <iostream>
+
+#include "EmulatorIO.h"
+
+long long ConsoleInput::read_value(long long)
+{
+    long long value {0};
+
+    std::cout << '?';
+    std::cin >> value;
+    std::cout << std::endl;
+
+    return value;
+}
+
+void ConsoleOutput::write_value(long long value)
+{
+    std::cout << value << std::endl;
+}
+
+long long SequenceInput::read_value(long long)
+{
+    if (_values != nullptr && _next_value < _values->size())
+    {
+        return (*_values)[_next_value++];
+    }
+
+    return 0;
+}
+
+long long PrefixedInput::read_value(long long instruction_count)
+{
+    if (_next_value < _values.size())
+    {
+        return _values[_next_value++];
+    }
+
+    return _rest.read_value(instruction_count);
+}
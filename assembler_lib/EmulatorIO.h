@@ -0,0 +1,131 @@
+/**
+ * @file EmulatorIO.h
+ * @brief Input and output devices of the emulator.
+ * @details READ takes its value from an input source and WRITE hands its
+ * value to an output sink. By default both are the console.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Supplies the values consumed by READ.
+ */
+class InputSource
+{
+  public:
+    virtual ~InputSource() = default;
+
+    /**
+     * @brief Gets the next input value.
+     * @param instruction_count The number of instructions executed before
+     * the READ.
+     * @return The value to store.
+     */
+    virtual long long read_value(long long instruction_count) = 0;
+};
+
+/**
+ * @brief Receives the values produced by WRITE.
+ */
+class OutputSink
+{
+  public:
+    virtual ~OutputSink() = default;
+
+    /**
+     * @brief Outputs a value.
+     * @param value The value written by the program.
+     */
+    virtual void write_value(long long value) = 0;
+};
+
+/**
+ * @brief Prompts for input values on the console.
+ */
+class ConsoleInput : public InputSource
+{
+  public:
+    long long read_value(long long instruction_count) override;
+};
+
+/**
+ * @brief Prints output values on the console.
+ */
+class ConsoleOutput : public OutputSink
+{
+  public:
+    void write_value(long long value) override;
+};
+
+/**
+ * @brief Supplies a fixed sequence of input values, then zeros.
+ */
+class SequenceInput : public InputSource
+{
+  public:
+    /**
+     * @brief Starts supplying a sequence from its first value.
+     * @param values The values; they must outlive their use.
+     */
+    void set_values(const std::vector<long long>& values)
+    {
+        _values = &values;
+        _next_value = 0;
+    }
+
+    long long read_value(long long instruction_count) override;
+
+  private:
+    const std::vector<long long>* _values {nullptr};
+    std::size_t                   _next_value {0};
+};
+
+/**
+ * @brief Supplies a fixed list of values, then takes the rest from another
+ * source.
+ */
+class PrefixedInput : public InputSource
+{
+  public:
+    /**
+     * @brief Prepares the input.
+     * @param values The values supplied first.
+     * @param rest The source of the values after them.
+     */
+    PrefixedInput(std::vector<long long> values, InputSource& rest)
+        : _values(std::move(values)), _rest(rest)
+    {
+    }
+
+    long long read_value(long long instruction_count) override;
+
+  private:
+    std::vector<long long> _values;
+    std::size_t            _next_value {0};
+    InputSource&           _rest;
+};
+
+/**
+ * @brief Keeps the output values.
+ */
+class CollectingOutput : public OutputSink
+{
+  public:
+    void write_value(long long value) override { _values.push_back(value); }
+
+    /**
+     * @brief Gets the values written so far.
+     * @return The values, in the order they were written.
+     */
+    [[nodiscard]] const std::vector<long long>& get_values() const
+    {
+        return _values;
+    }
+
+  private:
+    std::vector<long long> _values;
+};
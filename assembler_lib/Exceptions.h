@@ -7,6 +7,7 @@
 
 #include <exception>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include <fmt/core.h>
@@ -19,8 +20,8 @@
 class InvalidOpcodeError : public std::exception
 {
   public:
-    explicit InvalidOpcodeError(std::string opcode)
-        : _opcode(std::move(opcode)),
+    explicit InvalidOpcodeError(std::string_view opcode)
+        : _opcode(opcode),
           _message {fmt::format("Invalid opcode: '{}'", _opcode)}
     {
     }
@@ -42,9 +43,9 @@ class InvalidOpcodeError : public std::exception
 class MultiplyDefinedLabelError : public std::exception
 {
   public:
-    explicit MultiplyDefinedLabelError(std::string label, int previous_location,
-                                       int new_location)
-        : _label(std::move(label)), _previous_location(previous_location),
+    explicit MultiplyDefinedLabelError(std::string_view label,
+                                       int previous_location, int new_location)
+        : _label(label), _previous_location(previous_location),
           _new_location(new_location),
           _message {fmt::format(
               "Multiply defined label: '{}' at address {} and address {}",
@@ -71,9 +72,9 @@ class MultiplyDefinedLabelError : public std::exception
 class UnmatchedOperandCountError : public std::exception
 {
   public:
-    explicit UnmatchedOperandCountError(std::string symbolic_opcode,
+    explicit UnmatchedOperandCountError(std::string_view symbolic_opcode,
                                         int expected_count, int actual_count)
-        : _symbolic_opcode(std::move(symbolic_opcode)),
+        : _symbolic_opcode(symbolic_opcode),
           _expected_count(expected_count), _actual_count(actual_count),
           _message {
               fmt::format("Unmatched operand count in '{}' expected {} but "
@@ -100,9 +101,9 @@ class UnmatchedOperandCountError : public std::exception
 class InvalidOperandTypeError : public std::exception
 {
   public:
-    explicit InvalidOperandTypeError(std::string operand, OperandType expected,
-                                     OperandType actual)
-        : _operand(std::move(operand)), _expected(expected), _actual(actual),
+    explicit InvalidOperandTypeError(std::string_view operand,
+                                     OperandType expected, OperandType actual)
+        : _operand(operand), _expected(expected), _actual(actual),
           _message {fmt::format("Invalid operand type: '{}' expected {} but "
                                 "found {}",
                                 _operand, get_operand_type_str(_expected),
@@ -129,9 +130,9 @@ class InvalidOperandTypeError : public std::exception
 class ExtraStatementElementsError : public std::exception
 {
   public:
-    explicit ExtraStatementElementsError(std::string statement,
-                                         std::string extra)
-        : _statement(std::move(statement)), _extra(std::move(extra)),
+    explicit ExtraStatementElementsError(std::string_view statement,
+                                         std::string_view extra)
+        : _statement(statement), _extra(extra),
           _message {
               fmt::format("Extra  element '{}' in '{}'", _extra, _statement)}
     {
@@ -196,8 +197,8 @@ class MissingEndStatementError : public std::exception
 class StatementAfterEndError : public std::exception
 {
   public:
-    explicit StatementAfterEndError(std::string statement)
-        : _statement(std::move(statement)),
+    explicit StatementAfterEndError(std::string_view statement)
+        : _statement(statement),
           _message {fmt::format("Statement after END: '{}'", _statement)}
     {
     }
@@ -219,8 +220,8 @@ class StatementAfterEndError : public std::exception
 class InvalidConstantSizeError : public std::exception
 {
   public:
-    explicit InvalidConstantSizeError(std::string constant, int value)
-        : _constant(std::move(constant)), _value(value),
+    explicit InvalidConstantSizeError(std::string_view constant, int value)
+        : _constant(constant), _value(value),
           _message {fmt::format("Invalid constant size: '{}' value {}. "
                                 "Constant must be between 0 and 99,999",
                                 _constant, _value)}
@@ -245,8 +246,8 @@ class InvalidConstantSizeError : public std::exception
 class UndefinedLabelError : public std::exception
 {
   public:
-    explicit UndefinedLabelError(std::string label)
-        : _label(std::move(label)),
+    explicit UndefinedLabelError(std::string_view label)
+        : _label(label),
           _message {fmt::format("Undefined label: '{}'", _label)}
     {
     }
@@ -268,8 +269,8 @@ class UndefinedLabelError : public std::exception
 class SymbolicOpcodeInLabelError : public std::exception
 {
   public:
-    explicit SymbolicOpcodeInLabelError(std::string label)
-        : _label(std::move(label)),
+    explicit SymbolicOpcodeInLabelError(std::string_view label)
+        : _label(label),
           _message {fmt::format("Symbolic opcode in label: '{}'", _label)}
     {
     }
@@ -283,4 +284,358 @@ class SymbolicOpcodeInLabelError : public std::exception
     std::string _label;
 
     std::string _message;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Exception thrown when a trace file cannot be read or written.
+ */
+class TraceFileError : public std::exception
+{
+  public:
+    explicit TraceFileError(std::string trace_file_path, std::string reason)
+        : _trace_file_path(std::move(trace_file_path)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Trace file '{}' {}", _trace_file_path,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _trace_file_path;
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a memory cell cannot be watched.
+ */
+class WatchpointError : public std::exception
+{
+  public:
+    explicit WatchpointError(int address, std::string reason)
+        : _address(address), _reason(std::move(reason)),
+          _message {fmt::format("Watchpoint at address {} {}", _address,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    int         _address {0};
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when an input log cannot be read or written.
+ */
+class InputLogError : public std::exception
+{
+  public:
+    explicit InputLogError(std::string input_log_path, std::string reason)
+        : _input_log_path(std::move(input_log_path)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Input log '{}' {}", _input_log_path,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _input_log_path;
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a replayed run differs from the recorded run.
+ */
+class ReplayDivergenceError : public std::exception
+{
+  public:
+    explicit ReplayDivergenceError(std::string expected,
+                                   long long   instruction_count)
+        : _expected(std::move(expected)),
+          _instruction_count(instruction_count),
+          _message {
+              fmt::format("Replay diverged at instruction {}: expected {}",
+                          _instruction_count, _expected)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _expected;
+    long long   _instruction_count {0};
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a stats segment cannot be created or opened.
+ */
+class StatsSegmentError : public std::exception
+{
+  public:
+    explicit StatsSegmentError(std::string segment_name, std::string reason)
+        : _segment_name(std::move(segment_name)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Stats segment '{}' {}", _segment_name,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _segment_name;
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when an inspected range does not lie within
+ * memory.
+ */
+class InspectedRangeError : public std::exception
+{
+  public:
+    explicit InspectedRangeError(int first, int count)
+        : _first(first), _count(count),
+          _message {fmt::format("Inspected range of {} cells at address {} "
+                                "does not lie within memory",
+                                _count, _first)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    int _first {0};
+    int _count {0};
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a DIV instruction divides by zero.
+ */
+class DivisionByZeroError : public std::exception
+{
+  public:
+    explicit DivisionByZeroError(int location, long long instruction_count)
+        : _location(location),
+          _instruction_count(instruction_count),
+          _message {fmt::format(
+              "Division by zero at location {} after {} instructions",
+              _location, _instruction_count)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+    [[nodiscard]] int get_location() const { return _location; }
+
+    [[nodiscard]] long long get_instruction_count() const
+    {
+        return _instruction_count;
+    }
+
+  private:
+    int       _location {0};
+    long long _instruction_count {0};
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when the result cache directory cannot be used.
+ */
+class ResultCacheError : public std::exception
+{
+  public:
+    explicit ResultCacheError(std::string directory, std::string reason)
+        : _directory(std::move(directory)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Result cache '{}' {}", _directory, _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _directory;
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a run session file cannot be written.
+ */
+class SessionError : public std::exception
+{
+  public:
+    explicit SessionError(std::string session_file_path, std::string reason)
+        : _session_file_path(std::move(session_file_path)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Session file '{}' {}", _session_file_path,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _session_file_path;
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a block instruction reaches past the end of
+ * memory.
+ */
+class BlockRangeError : public std::exception
+{
+  public:
+    explicit BlockRangeError(int location, long long instruction_count)
+        : _location(location),
+          _instruction_count(instruction_count),
+          _message {fmt::format("Block instruction at location {} reaches past "
+                                "the end of memory after {} instructions",
+                                _location, _instruction_count)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+    [[nodiscard]] int get_location() const { return _location; }
+
+    [[nodiscard]] long long get_instruction_count() const
+    {
+        return _instruction_count;
+    }
+
+  private:
+    int       _location {0};
+    long long _instruction_count {0};
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a page pool cannot be created or used.
+ */
+class PagePoolError : public std::exception
+{
+  public:
+    explicit PagePoolError(std::string reason)
+        : _reason(std::move(reason)),
+          _message {fmt::format("Page pool {}", _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when a listing file cannot be written.
+ */
+class ListingFileError : public std::exception
+{
+  public:
+    explicit ListingFileError(std::string listing_file_path,
+                              std::string reason)
+        : _listing_file_path(std::move(listing_file_path)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Listing file '{}' {}", _listing_file_path,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _listing_file_path;
+    std::string _reason;
+
+    std::string _message;
+};
+
+/**
+ * @brief Exception thrown when an object file cannot be read or written.
+ */
+class ObjectFileError : public std::exception
+{
+  public:
+    explicit ObjectFileError(std::string object_file_path, std::string reason)
+        : _object_file_path(std::move(object_file_path)),
+          _reason(std::move(reason)),
+          _message {fmt::format("Object file '{}' {}", _object_file_path,
+                                _reason)}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return _message.c_str();
+    }
+
+  private:
+    std::string _object_file_path;
+    std::string _reason;
+
+    std::string _message;
+};
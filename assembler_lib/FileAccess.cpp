@@ -1,37 +1,83 @@
+#include <cstring>
 #include <iostream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "FileAccess.h"
 
 FileAccess::FileAccess(const std::string& file_path)
 {
-    _source_file.open(file_path, std::ios::in);
+    int         fd {open(file_path.c_str(), O_RDONLY | O_CLOEXEC)};
+    struct stat status {};
 
-    if (!_source_file.is_open())
+    if (fd < 0 || fstat(fd, &status) != 0)
     {
         std::cerr << "Source file could not be opened, assembler terminated.\n";
         exit(1);
     }
+
+    _size = static_cast<std::size_t>(status.st_size);
+
+    // An empty file cannot be mapped, and has nothing to map.
+    if (_size > 0)
+    {
+        void* contents {mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0)};
+        if (contents == MAP_FAILED)
+        {
+            std::cerr
+                << "Source file could not be opened, assembler terminated.\n";
+            exit(1);
+        }
+
+        // The source is read front to back.
+        madvise(contents, _size, MADV_SEQUENTIAL);
+        _contents = static_cast<const char*>(contents);
+    }
+
+    // The mapping outlives the descriptor.
+    close(fd);
 }
 
-FileAccess::~FileAccess() { _source_file.close(); }
+FileAccess::~FileAccess()
+{
+    if (_contents != nullptr)
+    {
+        munmap(const_cast<char*>(_contents), _size);
+    }
+}
 
-std::string FileAccess::get_next_line()
+std::string_view FileAccess::get_next_line()
 {
-    if (_source_file.eof())
+    if (end_of_file())
     {
         std::cerr << "End of file.\n";
         exit(1);
     }
 
-    std::string next_line;
-    std::getline(_source_file, next_line);
+    const char* start {_contents + _position};
+    std::size_t remaining {_size - _position};
+    const auto* newline {
+        remaining == 0
+            ? nullptr
+            : static_cast<const char*>(std::memchr(start, '\n', remaining))};
+
+    if (newline == nullptr)
+    {
+        _position = _size + 1;
+        return {start, remaining};
+    }
+
+    std::size_t length {static_cast<std::size_t>(newline - start)};
+    _position += length + 1;
 
-    return next_line;
+    return {start, length};
 }
 
 void FileAccess::rewind()
 {
-    // Clean all file flags and go back to the beginning of the file.
-    _source_file.clear();
-    _source_file.seekg(0, std::ios::beg);
-}
\ No newline at end of file
+    // Go back to the beginning of the file.
+    _position = 0;
+}
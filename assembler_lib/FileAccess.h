@@ -7,13 +7,15 @@
 
 #pragma once
 
-#include <fstream>
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 /**
  * @brief File access class.
- * @details This class is responsible for opening and closing the source file.
- * It also provides a method to get the next line from the source file.
+ * @details The source file is mapped into memory rather than read, and lines
+ * are handed out as views into the mapping, so reading a line neither copies
+ * nor allocates. The views stay valid as long as the file access object.
  */
 class FileAccess
 {
@@ -29,17 +31,22 @@ class FileAccess
      */
     ~FileAccess();
 
+    FileAccess(const FileAccess&) = delete;
+    FileAccess& operator=(const FileAccess&) = delete;
+
     /**
      * @brief Gets the next line from the source file.
-     * @return The next line from the source file.
+     * @details Like std::getline, a final newline is followed by one more,
+     * empty, line.
+     * @return The next line from the source file, without its newline.
      */
-    std::string get_next_line();
+    std::string_view get_next_line();
 
     /**
      * @brief Checks if the end of the file has been reached.
      * @return True if the end of the file has been reached, false otherwise.
      */
-    [[nodiscard]] bool end_of_file() const { return _source_file.eof(); };
+    [[nodiscard]] bool end_of_file() const { return _position > _size; };
 
     /**
      * @brief Rewinds the file pointer to the beginning of the file.
@@ -47,5 +54,9 @@ class FileAccess
     void rewind();
 
   private:
-    std::ifstream _source_file;
-};
\ No newline at end of file
+    const char* _contents {nullptr};
+    std::size_t _size {0};
+
+    // The start of the next line; past _size once the last line was read.
+    std::size_t _position {0};
+};
@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <thread>
+
+#include "Emulator.h"
+#include "Exceptions.h"
+#include "Fuzzer.h"
+
+namespace
+{
+// Values that often reach special cases.
+const std::array<long long, 9> INTERESTING_VALUES {
+    0, 1, -1, 2, 10, 100, 99'999, -99'999, 100'000};
+
+// Largest change made to a value by an arithmetic mutation.
+const int MAX_DELTA {16};
+
+// Instructions a hanging run goes on for to find its loop.
+const long long LOOP_SIGNATURE_INSTRUCTIONS {4096};
+
+/**
+ * @brief Builds the table that maps a hit count to its bucket.
+ * @details Counts are grouped as 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and
+ * 128-255, each group a bit, so a loop running a few more times is not new
+ * coverage but running twice as often is.
+ * @return The bucket of every hit count.
+ */
+constexpr std::array<unsigned char, 256> make_bucket_table()
+{
+    std::array<unsigned char, 256> table {};
+
+    for (int count = 1; count < 256; count++)
+    {
+        int bucket {count <= 3     ? count - 1
+                    : count <= 7   ? 3
+                    : count <= 15  ? 4
+                    : count <= 31  ? 5
+                    : count <= 127 ? 6
+                                   : 7};
+        table[count] = static_cast<unsigned char>(1 << bucket);
+    }
+
+    return table;
+}
+
+const std::array<unsigned char, 256> BUCKETS {make_bucket_table()};
+
+/**
+ * @brief Throws away the output of WRITE.
+ */
+class DiscardedOutput : public OutputSink
+{
+  public:
+    void write_value(long long) override {}
+};
+
+/**
+ * @brief Checks if a run reached an edge or hit count bucket not seen yet.
+ * @param coverage_map The edge hit counts of the run.
+ * @param seen_buckets The buckets seen so far.
+ * @return True if the coverage is new.
+ */
+bool has_new_coverage(const std::vector<unsigned char>& coverage_map,
+                      const std::vector<unsigned char>& seen_buckets)
+{
+    for (std::size_t i = 0; i < coverage_map.size(); i += 8)
+    {
+        // Most of the map is untouched, so skip it a word at a time.
+        std::uint64_t word;
+        std::memcpy(&word, coverage_map.data() + i, sizeof(word));
+        if (word == 0)
+            continue;
+
+        for (std::size_t j = i; j < i + 8; j++)
+        {
+            if (BUCKETS[coverage_map[j]] & ~seen_buckets[j])
+                return true;
+        }
+    }
+
+    return false;
+}
+} // namespace
+
+Fuzzer::Fuzzer(std::span<const long long> image, FuzzerOptions options)
+    : _image(image.begin(), image.end()), _options(std::move(options))
+{
+}
+
+FuzzReport Fuzzer::run()
+{
+    _corpus = _options.seeds;
+    if (_corpus.empty())
+    {
+        _corpus.emplace_back();
+    }
+
+    _seen_buckets.assign(Emulator::COVERAGE_MAP_SIZE, 0);
+    _findings.clear();
+    _next_execution = 0;
+
+    int thread_count {_options.thread_count};
+    if (thread_count <= 0)
+    {
+        thread_count =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < thread_count; i++)
+    {
+        workers.emplace_back(&Fuzzer::_work, this, i);
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    FuzzReport report;
+    report.execution_count = _options.execution_count;
+    report.covered_edge_count = static_cast<int>(
+        _seen_buckets.size() - std::ranges::count(_seen_buckets, 0));
+    report.corpus = _corpus;
+    report.findings = _findings;
+
+    std::ranges::sort(report.findings,
+                      [](const FuzzFinding& a, const FuzzFinding& b)
+                      {
+                          return a.kind != b.kind ? a.kind < b.kind
+                                                  : a.location < b.location;
+                      });
+
+    return report;
+}
+
+void Fuzzer::_work(int worker_index)
+{
+    std::mt19937_64 random {_options.seed * 0x9E3779B97F4A7C15 +
+                            static_cast<unsigned>(worker_index)};
+
+    Emulator emulator;
+    emulator.load_image(_image);
+
+    SequenceInput   input;
+    DiscardedOutput output;
+    emulator.set_input_source(&input);
+    emulator.set_output_sink(&output);
+
+    std::vector<unsigned char> coverage_map(Emulator::COVERAGE_MAP_SIZE, 0);
+    emulator.set_coverage_map(coverage_map.data());
+    emulator.set_instruction_limit(_options.instruction_limit);
+
+    std::vector<unsigned char> seen_buckets;
+    {
+        std::lock_guard lock {_mutex};
+        seen_buckets = _seen_buckets;
+    }
+
+    while (_next_execution.fetch_add(1) < _options.execution_count)
+    {
+        std::vector<long long> values {_generate_input(random)};
+        input.set_values(values);
+
+        std::ranges::fill(coverage_map, 0);
+        emulator.reset();
+
+        // Any exception is a finding; letting one out of the thread would
+        // end the session.
+        std::optional<FuzzFinding> finding;
+        try
+        {
+            if (emulator.run_program() == StopReason::InstructionLimit)
+            {
+                finding = {.kind = FuzzFindingKind::Hang,
+                           .location = emulator.get_location(),
+                           .input = values};
+            }
+        }
+        catch (const DivisionByZeroError& error)
+        {
+            finding = {.kind = FuzzFindingKind::DivisionByZero,
+                       .location = error.get_location(),
+                       .input = values};
+        }
+        catch (const BlockRangeError& error)
+        {
+            finding = {.kind = FuzzFindingKind::Crash,
+                       .location = error.get_location(),
+                       .input = values,
+                       .message = error.what()};
+        }
+        catch (const std::exception& error)
+        {
+            finding = {.kind = FuzzFindingKind::Crash,
+                       .location = emulator.get_location(),
+                       .input = values,
+                       .message = error.what()};
+        }
+
+        _keep_if_new(values, coverage_map, seen_buckets);
+
+        if (finding)
+        {
+            if (finding->kind == FuzzFindingKind::Hang)
+            {
+                finding->loop_signature =
+                    _get_loop_signature(emulator, coverage_map);
+            }
+            _report(std::move(*finding));
+        }
+    }
+}
+
+std::uint64_t
+Fuzzer::_get_loop_signature(Emulator&                   emulator,
+                            std::vector<unsigned char>& coverage_map)
+{
+    std::ranges::fill(coverage_map, 0);
+    emulator.set_instruction_limit(LOOP_SIGNATURE_INSTRUCTIONS);
+
+    try
+    {
+        emulator.resume();
+    }
+    catch (const std::exception&)
+    {
+        // The edges taken up to the exception still tell the loop apart.
+    }
+    emulator.set_instruction_limit(_options.instruction_limit);
+
+    std::uint64_t signature {0xCBF29CE484222325};
+    for (std::size_t i = 0; i < coverage_map.size(); i++)
+    {
+        if (coverage_map[i] != 0)
+        {
+            signature = (signature ^ i) * 0x100000001B3;
+        }
+    }
+
+    return signature;
+}
+
+std::vector<long long> Fuzzer::_generate_input(std::mt19937_64& random)
+{
+    std::vector<long long> input;
+    std::vector<long long> other;
+    {
+        std::lock_guard lock {_mutex};
+        input = _corpus[random() % _corpus.size()];
+        other = _corpus[random() % _corpus.size()];
+    }
+
+    auto max_length {static_cast<std::size_t>(_options.max_input_length)};
+    auto pick_index {[&random](std::size_t size)
+                     { return static_cast<std::ptrdiff_t>(random() % size); }};
+    auto small_value {[&random]()
+                      {
+                          return static_cast<long long>(
+                                     random() % (2 * MAX_DELTA + 1)) -
+                                 MAX_DELTA;
+                      }};
+
+    int mutation_count {1 + static_cast<int>(random() % 4)};
+    for (int i = 0; i < mutation_count; i++)
+    {
+        int mutation {static_cast<int>(random() % 6)};
+
+        // Inputs without values can only grow.
+        if (input.empty() || (mutation == 5 && other.empty()))
+            mutation = 2;
+
+        switch (mutation)
+        {
+        case 0: // Nudge a value.
+            input[pick_index(input.size())] += small_value();
+            break;
+        case 1: // Replace a value with an interesting one.
+            input[pick_index(input.size())] =
+                INTERESTING_VALUES[random() % INTERESTING_VALUES.size()];
+            break;
+        case 2: // Insert a small value.
+            if (input.size() < max_length)
+            {
+                input.insert(input.begin() + pick_index(input.size() + 1),
+                             small_value());
+            }
+            break;
+        case 3: // Delete a value.
+            input.erase(input.begin() + pick_index(input.size()));
+            break;
+        case 4: // Repeat a value.
+            if (input.size() < max_length)
+            {
+                auto index {pick_index(input.size())};
+                input.insert(input.begin() + index, input[index]);
+            }
+            break;
+        case 5: // Splice in the tail of another input.
+        {
+            auto split {pick_index(input.size() + 1)};
+            auto other_split {pick_index(other.size())};
+            input.resize(split);
+            input.insert(input.end(), other.begin() + other_split,
+                         other.end());
+            if (input.size() > max_length)
+                input.resize(max_length);
+            break;
+        }
+        }
+    }
+
+    return input;
+}
+
+void Fuzzer::_keep_if_new(const std::vector<long long>&     input,
+                          const std::vector<unsigned char>& coverage_map,
+                          std::vector<unsigned char>&       seen_buckets)
+{
+    // Checked against the worker's copy first, to keep the lock rarely held.
+    if (!has_new_coverage(coverage_map, seen_buckets))
+    {
+        return;
+    }
+
+    std::lock_guard lock {_mutex};
+
+    if (has_new_coverage(coverage_map, _seen_buckets))
+    {
+        for (std::size_t i = 0; i < coverage_map.size(); i++)
+        {
+            _seen_buckets[i] |= BUCKETS[coverage_map[i]];
+        }
+        _corpus.push_back(input);
+    }
+
+    seen_buckets = _seen_buckets;
+}
+
+void Fuzzer::_report(FuzzFinding finding)
+{
+    std::lock_guard lock {_mutex};
+
+    bool known {std::ranges::any_of(
+        _findings, [&finding](const FuzzFinding& known_finding)
+        {
+            if (known_finding.kind != finding.kind)
+            {
+                return false;
+            }
+            return finding.kind == FuzzFindingKind::Hang
+                       ? known_finding.loop_signature ==
+                             finding.loop_signature
+                       : known_finding.location == finding.location;
+        })};
+
+    if (!known)
+    {
+        _findings.push_back(std::move(finding));
+    }
+}
@@ -0,0 +1,166 @@
+/**
+ * @file Fuzzer.h
+ * @brief Coverage-guided fuzzing of the input of VC1620 programs.
+ * @details The fuzzer runs an assembled program over and over, feeding READ
+ * from generated input sequences. Each worker thread owns an emulator loaded
+ * with the program's image and restarts it with Emulator::reset, so a run
+ * costs only the pages the previous run dirtied. Branch edges are counted in
+ * a coverage map and bucketed by hit count; an input that produces an edge
+ * or bucket no earlier input produced joins the corpus and is mutated
+ * further. Inputs that divide by zero or make the emulator throw anything
+ * else are reported once per location. Inputs that exceed the instruction
+ * limit are reported once per loop: the run goes on for a few more
+ * instructions, and the edges it takes then identify the loop.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+class Emulator;
+
+/**
+ * @brief The kind of problem an input causes.
+ */
+enum class FuzzFindingKind
+{
+    DivisionByZero,
+    Hang,
+    Crash
+};
+
+/**
+ * @brief An input that makes the program fail.
+ */
+struct FuzzFinding
+{
+    FuzzFindingKind kind {FuzzFindingKind::DivisionByZero};
+
+    // The DIV that failed, or where the program was when it was stopped.
+    int location {0};
+
+    std::vector<long long> input;
+
+    // What the emulator threw, for a crash.
+    std::string message;
+
+    // The edges a hang keeps taking, for telling loops apart.
+    std::uint64_t loop_signature {0};
+};
+
+/**
+ * @brief Settings for a fuzzing session.
+ */
+struct FuzzerOptions
+{
+    // Runs of the program, over all threads.
+    long long execution_count {100'000};
+
+    // Worker threads, or 0 for one per core.
+    int thread_count {0};
+
+    // Instructions after which a run is considered to hang.
+    long long instruction_limit {1'000'000};
+
+    // Values a generated input may hold at most.
+    int max_input_length {64};
+
+    unsigned seed {1};
+
+    // Inputs to start from. An empty input is used if there are none.
+    std::vector<std::vector<long long>> seeds;
+};
+
+/**
+ * @brief The result of a fuzzing session.
+ */
+struct FuzzReport
+{
+    long long                           execution_count {0};
+    int                                 covered_edge_count {0};
+    std::vector<std::vector<long long>> corpus;
+    std::vector<FuzzFinding>            findings;
+};
+
+/**
+ * @brief Fuzzes the input of an assembled program on several threads.
+ */
+class Fuzzer
+{
+  public:
+    /**
+     * @brief Prepares to fuzz a program.
+     * @param image The program as loaded into memory, see
+     * Emulator::get_image.
+     * @param options The settings of the session.
+     */
+    Fuzzer(std::span<const long long> image, FuzzerOptions options);
+
+    /**
+     * @brief Runs the session.
+     * @return What the session found.
+     */
+    FuzzReport run();
+
+  private:
+    std::vector<long long> _image;
+    FuzzerOptions          _options;
+
+    std::atomic<long long> _next_execution {0};
+
+    // Guards everything below.
+    std::mutex _mutex;
+
+    // Hit count buckets seen so far for each edge.
+    std::vector<unsigned char> _seen_buckets;
+
+    std::vector<std::vector<long long>> _corpus;
+    std::vector<FuzzFinding>            _findings;
+
+    /**
+     * @brief Runs generated inputs until the session's executions are used.
+     * @param worker_index The index of the worker, used to seed it.
+     */
+    void _work(int worker_index);
+
+    /**
+     * @brief Generates a new input from the corpus.
+     * @param random The worker's random number generator.
+     * @return The input.
+     */
+    std::vector<long long> _generate_input(std::mt19937_64& random);
+
+    /**
+     * @brief Adds an input to the corpus if it reached new coverage.
+     * @param input The input.
+     * @param coverage_map The edge hit counts of its run.
+     * @param seen_buckets The worker's copy of the buckets seen so far,
+     * refreshed if the input is added.
+     */
+    void _keep_if_new(const std::vector<long long>&     input,
+                      const std::vector<unsigned char>& coverage_map,
+                      std::vector<unsigned char>&       seen_buckets);
+
+    /**
+     * @brief Runs a hanging program a little further to find its loop.
+     * @param emulator The emulator, stopped at the instruction limit.
+     * @param coverage_map The coverage map of the emulator, cleared here.
+     * @return The signature of the edges the loop takes.
+     */
+    std::uint64_t _get_loop_signature(Emulator&                   emulator,
+                                      std::vector<unsigned char>& coverage_map);
+
+    /**
+     * @brief Records an input that makes the program fail, unless the same
+     * failure is already recorded: a division by zero or crash at the same
+     * location, or a hang in the same loop.
+     * @param finding The failure.
+     */
+    void _report(FuzzFinding finding);
+};
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <charconv>
 #include <fstream>
 #include <stdexcept>
 
@@ -10,23 +11,29 @@ int get_location_of_next_instruction(
 {
     int next_location {current_location + 1};
 
-    std::string opcode {current_instruction.get_opcode()};
+    NumericOpcode opcode {current_instruction.get_numeric_opcode()};
 
-    if (opcode == "ORG")
+    if (opcode == NumericOpcode::ORG)
     {
-        next_location = std::stoi(current_instruction.get_operand_1());
+        next_location = parse_number(current_instruction.get_operand_1());
     }
 
-    if (opcode == "DS")
+    if (opcode == NumericOpcode::DS)
     {
-        next_location =
-            current_location + std::stoi(current_instruction.get_operand_1());
+        next_location = current_location +
+                        parse_number(current_instruction.get_operand_1());
+    }
+
+    // Block instructions are followed by their block length.
+    if (!current_instruction.get_operand_3().empty())
+    {
+        next_location = current_location + 2;
     }
 
     return next_location;
 }
 
-bool is_comment_or_empty(const std::string& line)
+bool is_comment_or_empty(std::string_view line)
 {
     if (line.empty()) // Empty line
         return true;
@@ -37,60 +44,39 @@ bool is_comment_or_empty(const std::string& line)
     return false;
 }
 
-bool line_contains_label(const std::string& line)
-{
-    std::string uncommented_line = get_uncommented_line(line);
-    return uncommented_line[0] != ' ' && uncommented_line[0] != '\t';
-}
-
-std::string get_uncommented_line(const std::string& line)
-{
-    if (auto comment_position {line.find(';')};
-        comment_position != std::string::npos)
-    {
-        return line.substr(0, comment_position);
-    }
-    return line;
-}
-
-std::string get_upper_case(const std::string& str)
+std::string get_upper_case(std::string_view str)
 {
     std::string upper;
+    upper.reserve(str.size());
     for (auto c : str)
-        upper += std::toupper(c);
+        upper += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
 
     return upper;
 }
 
-std::string replace_commas(const std::string& str)
+int parse_number(std::string_view number)
 {
-    std::string replaced {str};
-    std::ranges::replace(replaced.begin(), replaced.end(), ',', ' ');
-    return replaced;
-}
+    int value {0};
+    auto [end, error] {
+        std::from_chars(number.data(), number.data() + number.size(), value)};
 
-std::string remove_comments_and_commas(const std::string& line)
-{
-    std::string uncommented_line {get_uncommented_line(line)};
-    return replace_commas(uncommented_line);
+    if (error == std::errc::result_out_of_range)
+        throw std::out_of_range {"parse_number"};
+
+    if (error != std::errc {})
+        throw std::invalid_argument {"parse_number"};
+
+    return value;
 }
 
 int get_instruction_operand_count(const std::string& opcode)
 {
-    std::string upper_opcode {get_upper_case(opcode)};
-
-    using enum InstructionType;
+    std::optional<NumericOpcode> numeric_opcode {find_numeric_opcode(opcode)};
 
-    try
-    {
-        NumericOpcode opcode_enum {
-            SymbolicOpcode_NumericOpcode.at(upper_opcode)};
-        return NumericOpcode_OperandCount.at(opcode_enum);
-    }
-    catch (const std::out_of_range&)
-    {
+    if (!numeric_opcode)
         throw InvalidOpcodeError {opcode};
-    }
+
+    return get_operand_count(*numeric_opcode);
 }
 
 std::string get_operand_type_str(OperandType operand_type)
@@ -110,13 +96,13 @@ std::string get_operand_type_str(OperandType operand_type)
     return "Unknown";
 }
 
-OperandType get_operand_type(const std::string& operand)
+OperandType get_operand_type(std::string_view operand)
 {
     using enum OperandType;
     if (operand.empty())
         return None;
 
-    if (std::isdigit(operand[0]))
+    if (std::isdigit(static_cast<unsigned char>(operand[0])))
         return Numeric;
 
     return Symbolic;
@@ -12,6 +12,7 @@
 #include <locale>
 #include <map>
 #include <string>
+#include <string_view>
 
 #include "InstructionDefinitions.h"
 #include "SymbolicInstruction.h"
@@ -30,42 +31,23 @@ int get_location_of_next_instruction(
  * @param line  The line to check
  * @return True if the line is a comment or empty, false otherwise
  */
-bool is_comment_or_empty(const std::string& line);
-
-/**
- * @brief Check if the line contains a label
- * @param line  The line to check
- * @return True if the line contains a label, false otherwise
- */
-bool line_contains_label(const std::string& line);
-
-/**
- * @brief Get the uncommented line
- * @param line  The line to get the uncommented line from
- * @return The uncommented line
- */
-std::string get_uncommented_line(const std::string& line);
+bool is_comment_or_empty(std::string_view line);
 
 /**
  * @brief Get the upper case version of the string
  * @param str   The string to get the upper case version of
  * @return The upper case version of the string
  */
-std::string get_upper_case(const std::string& str);
-
-/**
- * @brief Replace all commas in the string with spaces
- * @param str
- * @return
- */
-std::string replace_commas(const std::string& str);
+std::string get_upper_case(std::string_view str);
 
 /**
- * @brief Remove all comments and commas from the line
- * @param line  The line to remove the comments and commas from
- * @return The line without comments and commas
+ * @brief Parse the number an operand starts with, like std::stoi
+ * @param number    The operand
+ * @return The number
+ * @throws std::invalid_argument if the operand does not start with a number
+ * @throws std::out_of_range if the number does not fit in an int
  */
-std::string remove_comments_and_commas(const std::string& line);
+int parse_number(std::string_view number);
 
 /**
  * @brief Get the instruction operand count
@@ -79,7 +61,7 @@ int get_instruction_operand_count(const std::string& opcode);
  * @param operand   The operand
  * @return The operand type
  */
-OperandType get_operand_type(const std::string& operand);
+OperandType get_operand_type(std::string_view operand);
 
 /**
  * @brief Get the instruction operand type
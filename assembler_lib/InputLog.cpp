@@ -0,0 +1,165 @@
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include <fmt/core.h>
+
+#include "Exceptions.h"
+#include "InputLog.h"
+#include "Varint.h"
+
+namespace
+{
+const char INPUT_LOG_MAGIC[] {"VCINPUT1"};
+const int  MAGIC_SIZE {8};
+} // namespace
+
+RecordingInput::RecordingInput(const std::string& input_log_path,
+                               InputSource&       source)
+    : _input_log_path(input_log_path),
+      _input_log(input_log_path, std::ios::out | std::ios::binary),
+      _source(source)
+{
+    if (!_input_log.is_open())
+    {
+        throw InputLogError(_input_log_path, "could not be created");
+    }
+
+    _input_log.write(INPUT_LOG_MAGIC, MAGIC_SIZE);
+}
+
+long long RecordingInput::read_value(long long instruction_count)
+{
+    long long value {_source.read_value(instruction_count)};
+
+    _write_entry(instruction_count, false, value);
+    return value;
+}
+
+void RecordingInput::close(long long instruction_count)
+{
+    _write_entry(instruction_count, true, 0);
+    _input_log.close();
+
+    if (_input_log.fail())
+    {
+        throw InputLogError(_input_log_path, "could not be written");
+    }
+}
+
+void RecordingInput::_write_entry(long long instruction_count, bool final,
+                                  long long value)
+{
+    auto delta {
+        static_cast<std::uint64_t>(instruction_count - _previous_count)};
+    _previous_count = instruction_count;
+
+    std::string entry;
+    put_varint(entry, delta << 1 | (final ? 1 : 0));
+    if (!final)
+    {
+        put_varint(entry, zigzag_encode(value));
+    }
+
+    // Flushed at once, so the log survives a crash of the recorded run.
+    _input_log.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+    _input_log.flush();
+}
+
+ReplayInput::ReplayInput(const std::string& input_log_path)
+{
+    std::ifstream input_log(input_log_path, std::ios::in | std::ios::binary);
+    if (!input_log.is_open())
+    {
+        throw InputLogError(input_log_path, "could not be opened");
+    }
+
+    std::string contents {std::istreambuf_iterator<char>(input_log),
+                          std::istreambuf_iterator<char>()};
+
+    if (contents.size() < MAGIC_SIZE ||
+        std::memcmp(contents.data(), INPUT_LOG_MAGIC, MAGIC_SIZE) != 0)
+    {
+        throw InputLogError(input_log_path, "is not an input log");
+    }
+
+    std::size_t   position {MAGIC_SIZE};
+    long long     instruction_count {0};
+    std::uint64_t header;
+
+    while (position < contents.size())
+    {
+        if (!get_varint(contents, position, header))
+        {
+            throw InputLogError(input_log_path, "has a corrupt entry");
+        }
+
+        instruction_count += static_cast<long long>(header >> 1);
+
+        if (header & 1)
+        {
+            _final_count = instruction_count;
+            break;
+        }
+
+        std::uint64_t value;
+        if (!get_varint(contents, position, value))
+        {
+            throw InputLogError(input_log_path, "has a corrupt entry");
+        }
+
+        _entries.push_back({instruction_count, zigzag_decode(value)});
+    }
+}
+
+long long ReplayInput::read_value(long long instruction_count)
+{
+    if (_next_entry >= _entries.size())
+    {
+        throw ReplayDivergenceError(
+            "READ after the last recorded input", instruction_count);
+    }
+
+    const Entry& entry {_entries[_next_entry++]};
+
+    if (entry.instruction_count != instruction_count)
+    {
+        throw ReplayDivergenceError(
+            fmt::format("READ recorded at instruction {}",
+                        entry.instruction_count),
+            instruction_count);
+    }
+
+    return entry.value;
+}
+
+void ReplayInput::check_finished(long long instruction_count) const
+{
+    if (_next_entry < _entries.size())
+    {
+        throw ReplayDivergenceError(
+            fmt::format("halt with {} recorded inputs unread",
+                        _entries.size() - _next_entry),
+            instruction_count);
+    }
+
+    if (_final_count >= 0 && _final_count != instruction_count)
+    {
+        throw ReplayDivergenceError(
+            fmt::format("halt recorded at instruction {}", _final_count),
+            instruction_count);
+    }
+}
+
+std::vector<long long> ReplayInput::get_values() const
+{
+    std::vector<long long> values;
+    values.reserve(_entries.size());
+
+    for (const Entry& entry : _entries)
+    {
+        values.push_back(entry.value);
+    }
+
+    return values;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file InputLog.h
+ * @brief Recording and replaying the input of a run.
+ * @details An input log holds every value consumed by READ together with the
+ * number of instructions executed before it, so a run can be reproduced
+ * exactly without a terminal. The file starts with the magic "VCINPUT1".
+ * Each entry is a varint holding the instruction count delta since the
+ * previous entry shifted left by one, with the low bit set on the final
+ * entry. Input entries are followed by the value as a zigzag varint; the
+ * final entry carries the instruction count at which the run halted.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "EmulatorIO.h"
+
+/**
+ * @brief Passes input through from another source and logs it.
+ */
+class RecordingInput : public InputSource
+{
+  public:
+    /**
+     * @brief Creates the input log.
+     * @param input_log_path The path to the input log.
+     * @param source The source the values are read from.
+     * @throws InputLogError
+     */
+    RecordingInput(const std::string& input_log_path, InputSource& source);
+
+    long long read_value(long long instruction_count) override;
+
+    /**
+     * @brief Records the end of the run and closes the log.
+     * @param instruction_count The number of instructions the run executed.
+     * @throws InputLogError
+     */
+    void close(long long instruction_count);
+
+  private:
+    std::string   _input_log_path;
+    std::ofstream _input_log;
+    InputSource&  _source;
+
+    long long _previous_count {0};
+
+    /**
+     * @brief Appends an entry to the log.
+     * @param instruction_count The instruction count of the entry.
+     * @param final True for the entry that ends the run.
+     * @param value The value consumed, ignored for the final entry.
+     */
+    void _write_entry(long long instruction_count, bool final,
+                      long long value);
+};
+
+/**
+ * @brief Supplies the input recorded in an input log.
+ * @details The whole log is loaded when the object is constructed, so
+ * replaying runs at full emulator speed.
+ */
+class ReplayInput : public InputSource
+{
+  public:
+    /**
+     * @brief Loads an input log.
+     * @param input_log_path The path to the input log.
+     * @throws InputLogError
+     */
+    explicit ReplayInput(const std::string& input_log_path);
+
+    /**
+     * @brief Gets the next recorded value.
+     * @param instruction_count The number of instructions executed before
+     * the READ.
+     * @return The recorded value.
+     * @throws ReplayDivergenceError
+     */
+    long long read_value(long long instruction_count) override;
+
+    /**
+     * @brief Checks that the replayed run ended where the recorded run did.
+     * @param instruction_count The number of instructions the replayed run
+     * executed.
+     * @throws ReplayDivergenceError
+     */
+    void check_finished(long long instruction_count) const;
+
+    /**
+     * @brief Gets the recorded input values.
+     * @return The values, in the order they were read.
+     */
+    [[nodiscard]] std::vector<long long> get_values() const;
+
+    /**
+     * @brief Gets the instruction count the recorded run halted at.
+     * @return The instruction count, or -1 if the run did not finish.
+     */
+    [[nodiscard]] long long get_final_count() const { return _final_count; }
+
+  private:
+    struct Entry
+    {
+        long long instruction_count {0};
+        long long value {0};
+    };
+
+    std::vector<Entry> _entries;
+    std::size_t        _next_entry {0};
+
+    // Instruction count of the recorded run, or -1 if it did not finish.
+    long long _final_count {-1};
+};
@@ -6,8 +6,10 @@
 
 #pragma once
 
-#include <map>
-#include <string>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
 
 // Codes to indicate the type of instruction we are processing
 enum class InstructionType
@@ -18,29 +20,6 @@ enum class InstructionType
     End
 };
 
-// Maps symbolic opcode to type
-const std::map<std::string, InstructionType, std::less<>> SymbolicOpcode_Type {
-
-    // Assembler Instructions
-    {"DC", InstructionType::AssemblerInstruction},
-    {"DS", InstructionType::AssemblerInstruction},
-    {"ORG", InstructionType::AssemblerInstruction},
-    {"END", InstructionType::End},
-
-    // Machine Language Instructions
-    {"ADD", InstructionType::MachineLanguage},
-    {"SUB", InstructionType::MachineLanguage},
-    {"MULT", InstructionType::MachineLanguage},
-    {"DIV", InstructionType::MachineLanguage},
-    {"COPY", InstructionType::MachineLanguage},
-    {"READ", InstructionType::MachineLanguage},
-    {"WRITE", InstructionType::MachineLanguage},
-    {"B", InstructionType::MachineLanguage},
-    {"BM", InstructionType::MachineLanguage},
-    {"BZ", InstructionType::MachineLanguage},
-    {"BP", InstructionType::MachineLanguage},
-    {"HALT", InstructionType::MachineLanguage}};
-
 enum class NumericOpcode
 {
     // Assembler Instructions
@@ -61,55 +40,18 @@ enum class NumericOpcode
     BM = 10,
     BZ = 11,
     BP = 12,
-    HALT = 13
-};
+    HALT = 13,
 
-// Maps symbolic opcode to NumericOpcode
-const std::map<std::string, NumericOpcode, std::less<>>
-    SymbolicOpcode_NumericOpcode {
-
-        // Assembler Instructions
-        {"DC", NumericOpcode::DC},
-        {"DS", NumericOpcode::DS},
-        {"ORG", NumericOpcode::ORG},
-        {"END", NumericOpcode::END},
-
-        // Machine Language Instructions
-        {"ADD", NumericOpcode::ADD},
-        {"SUB", NumericOpcode::SUB},
-        {"MULT", NumericOpcode::MULT},
-        {"DIV", NumericOpcode::DIV},
-        {"COPY", NumericOpcode::COPY},
-        {"READ", NumericOpcode::READ},
-        {"WRITE", NumericOpcode::WRITE},
-        {"B", NumericOpcode::B},
-        {"BM", NumericOpcode::BM},
-        {"BZ", NumericOpcode::BZ},
-        {"BP", NumericOpcode::BP},
-        {"HALT", NumericOpcode::HALT}};
-
-// Maps numeric opcode to number of operands
-const std::map<NumericOpcode, int, std::less<>> NumericOpcode_OperandCount {
+    // Block Instructions. The word after the instruction holds the number of
+    // cells in the block.
+    BCOPY = 14, // copies a block, as if all of it were read first
+    BADD = 15,  // adds a block to another, cell by cell
+    BFILL = 16, // stores the contents of one cell in a block
+    BSUM = 17,  // stores the sum of a block in one cell
 
-    // Assembler Instructions
-    {NumericOpcode::DC, 1},
-    {NumericOpcode::DS, 1},
-    {NumericOpcode::ORG, 1},
-    {NumericOpcode::END, 0},
-
-    // Machine Language Instructions
-    {NumericOpcode::ADD, 2},
-    {NumericOpcode::SUB, 2},
-    {NumericOpcode::MULT, 2},
-    {NumericOpcode::DIV, 2},
-    {NumericOpcode::COPY, 2},
-    {NumericOpcode::READ, 1},
-    {NumericOpcode::WRITE, 1},
-    {NumericOpcode::B, 1},
-    {NumericOpcode::BM, 2},
-    {NumericOpcode::BZ, 2},
-    {NumericOpcode::BP, 2},
-    {NumericOpcode::HALT, 0}};
+    // Reserved for the emulator's debugger; has no symbolic opcode
+    TRAP = 99
+};
 
 // Types of operands
 enum class OperandType
@@ -119,26 +61,300 @@ enum class OperandType
     None
 };
 
-// Maps symbolic opcode to type of operand
-const std::map<std::string, OperandType, std::less<>>
-    SymbolicOpcode_OperandType {
-
-        // Assembler Instructions
-        {"DC", OperandType::Numeric},
-        {"DS", OperandType::Numeric},
-        {"ORG", OperandType::Numeric},
-        {"END", OperandType::None},
-
-        // Machine Language Instructions
-        {"ADD", OperandType::Symbolic},
-        {"SUB", OperandType::Symbolic},
-        {"MULT", OperandType::Symbolic},
-        {"DIV", OperandType::Symbolic},
-        {"COPY", OperandType::Symbolic},
-        {"READ", OperandType::Symbolic},
-        {"WRITE", OperandType::Symbolic},
-        {"B", OperandType::Symbolic},
-        {"BM", OperandType::Symbolic},
-        {"BZ", OperandType::Symbolic},
-        {"BP", OperandType::Symbolic},
-        {"HALT", OperandType::None}};
+/**
+ * @brief Describes an opcode of the assembler language.
+ */
+struct OpcodeDescriptor
+{
+    std::string_view symbolic_opcode; // in upper case
+    NumericOpcode    numeric_opcode;
+    InstructionType  type;
+    int              operand_count;
+    OperandType      operand_type; // a block length is always numeric
+};
+
+// Every opcode of the assembler language
+constexpr std::array<OpcodeDescriptor, 20> OPCODE_DESCRIPTORS {{
+    // Assembler Instructions
+    {"DC", NumericOpcode::DC, InstructionType::AssemblerInstruction, 1,
+     OperandType::Numeric},
+    {"DS", NumericOpcode::DS, InstructionType::AssemblerInstruction, 1,
+     OperandType::Numeric},
+    {"ORG", NumericOpcode::ORG, InstructionType::AssemblerInstruction, 1,
+     OperandType::Numeric},
+    {"END", NumericOpcode::END, InstructionType::End, 0, OperandType::None},
+
+    // Machine Language Instructions
+    {"ADD", NumericOpcode::ADD, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"SUB", NumericOpcode::SUB, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"MULT", NumericOpcode::MULT, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"DIV", NumericOpcode::DIV, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"COPY", NumericOpcode::COPY, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"READ", NumericOpcode::READ, InstructionType::MachineLanguage, 1,
+     OperandType::Symbolic},
+    {"WRITE", NumericOpcode::WRITE, InstructionType::MachineLanguage, 1,
+     OperandType::Symbolic},
+    {"B", NumericOpcode::B, InstructionType::MachineLanguage, 1,
+     OperandType::Symbolic},
+    {"BM", NumericOpcode::BM, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"BZ", NumericOpcode::BZ, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"BP", NumericOpcode::BP, InstructionType::MachineLanguage, 2,
+     OperandType::Symbolic},
+    {"HALT", NumericOpcode::HALT, InstructionType::MachineLanguage, 0,
+     OperandType::None},
+
+    // Block Instructions
+    {"BCOPY", NumericOpcode::BCOPY, InstructionType::MachineLanguage, 3,
+     OperandType::Symbolic},
+    {"BADD", NumericOpcode::BADD, InstructionType::MachineLanguage, 3,
+     OperandType::Symbolic},
+    {"BFILL", NumericOpcode::BFILL, InstructionType::MachineLanguage, 3,
+     OperandType::Symbolic},
+    {"BSUM", NumericOpcode::BSUM, InstructionType::MachineLanguage, 3,
+     OperandType::Symbolic},
+}};
+
+/**
+ * @brief Checks if an opcode is one of the block instructions.
+ * @details Block instructions are an extension of the VC1620 that programs
+ * opt in to. Each takes two words: the instruction, then the block length.
+ * @param opcode The numeric opcode.
+ * @return True for BCOPY, BADD, BFILL and BSUM.
+ */
+constexpr bool is_block_opcode(NumericOpcode opcode)
+{
+    return opcode == NumericOpcode::BCOPY || opcode == NumericOpcode::BADD ||
+           opcode == NumericOpcode::BFILL || opcode == NumericOpcode::BSUM;
+}
+
+namespace opcode_table
+{
+// The longest symbolic opcode; longer names are never looked up.
+constexpr std::size_t MAX_OPCODE_LENGTH {5};
+
+// Slots of the hash table; a power of two, to mask rather than divide.
+constexpr std::uint32_t SLOT_COUNT {64};
+
+/**
+ * @brief Converts an ASCII letter to upper case, in a constant expression.
+ * @param c The character.
+ * @return The character in upper case.
+ */
+constexpr char to_upper(char c)
+{
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+/**
+ * @brief Hashes a symbolic opcode, ignoring case.
+ * @param symbolic_opcode The symbolic opcode.
+ * @param seed The seed that makes the hash perfect.
+ * @return The slot of the opcode.
+ */
+constexpr std::uint32_t hash(std::string_view symbolic_opcode,
+                             std::uint32_t    seed)
+{
+    std::uint32_t hash {seed};
+    for (char c : symbolic_opcode)
+    {
+        hash = (hash ^ static_cast<unsigned char>(to_upper(c))) * 0x01000193;
+    }
+    return (hash ^ (hash >> 16)) & (SLOT_COUNT - 1);
+}
+
+/**
+ * @brief Finds the first seed that hashes every opcode to a different slot.
+ * @return The seed.
+ */
+consteval std::uint32_t find_seed()
+{
+    for (std::uint32_t seed {0x811C9DC5};; seed++)
+    {
+        std::array<bool, SLOT_COUNT> used {};
+        bool                         perfect {true};
+
+        for (const OpcodeDescriptor& descriptor : OPCODE_DESCRIPTORS)
+        {
+            std::uint32_t slot {hash(descriptor.symbolic_opcode, seed)};
+            perfect = perfect && !used[slot];
+            used[slot] = true;
+        }
+
+        if (perfect)
+        {
+            return seed;
+        }
+    }
+}
+
+constexpr std::uint32_t SEED {find_seed()};
+
+/**
+ * @brief Builds the hash table.
+ * @return For each slot, the index of the descriptor hashed to it, or -1.
+ */
+consteval std::array<std::int8_t, SLOT_COUNT> build_slots()
+{
+    std::array<std::int8_t, SLOT_COUNT> slots {};
+    slots.fill(-1);
+
+    for (std::size_t i = 0; i < OPCODE_DESCRIPTORS.size(); i++)
+    {
+        slots[hash(OPCODE_DESCRIPTORS[i].symbolic_opcode, SEED)] =
+            static_cast<std::int8_t>(i);
+    }
+    return slots;
+}
+
+constexpr std::array<std::int8_t, SLOT_COUNT> SLOTS {build_slots()};
+
+// Numeric opcodes of the table run from END to BSUM.
+constexpr int FIRST_NUMERIC_OPCODE {static_cast<int>(NumericOpcode::END)};
+constexpr int LAST_NUMERIC_OPCODE {static_cast<int>(NumericOpcode::BSUM)};
+
+/**
+ * @brief Builds the index of the descriptors by numeric opcode.
+ * @return For each numeric opcode from END, the index of its descriptor.
+ */
+consteval std::array<std::int8_t,
+                     LAST_NUMERIC_OPCODE - FIRST_NUMERIC_OPCODE + 1>
+build_numeric_index()
+{
+    std::array<std::int8_t, LAST_NUMERIC_OPCODE - FIRST_NUMERIC_OPCODE + 1>
+        index {};
+    index.fill(-1);
+
+    for (std::size_t i = 0; i < OPCODE_DESCRIPTORS.size(); i++)
+    {
+        int numeric_opcode {
+            static_cast<int>(OPCODE_DESCRIPTORS[i].numeric_opcode)};
+        index[numeric_opcode - FIRST_NUMERIC_OPCODE] =
+            static_cast<std::int8_t>(i);
+    }
+    return index;
+}
+
+constexpr auto NUMERIC_INDEX {build_numeric_index()};
+} // namespace opcode_table
+
+/**
+ * @brief Finds the descriptor of a symbolic opcode, in any case.
+ * @details One hash and one comparison; nothing is allocated.
+ * @param symbolic_opcode The symbolic opcode.
+ * @return The descriptor, or nullptr if there is no such opcode.
+ */
+constexpr const OpcodeDescriptor*
+find_opcode_descriptor(std::string_view symbolic_opcode)
+{
+    using namespace opcode_table;
+
+    if (symbolic_opcode.empty() || symbolic_opcode.size() > MAX_OPCODE_LENGTH)
+    {
+        return nullptr;
+    }
+
+    int index {SLOTS[hash(symbolic_opcode, SEED)]};
+    if (index < 0)
+    {
+        return nullptr;
+    }
+
+    const OpcodeDescriptor& descriptor {OPCODE_DESCRIPTORS[index]};
+    if (descriptor.symbolic_opcode.size() != symbolic_opcode.size())
+    {
+        return nullptr;
+    }
+
+    for (std::size_t i = 0; i < symbolic_opcode.size(); i++)
+    {
+        if (to_upper(symbolic_opcode[i]) != descriptor.symbolic_opcode[i])
+        {
+            return nullptr;
+        }
+    }
+    return &descriptor;
+}
+
+/**
+ * @brief Finds the descriptor of a numeric opcode.
+ * @param opcode The numeric opcode.
+ * @return The descriptor, or nullptr for TRAP, which has no symbolic opcode.
+ */
+constexpr const OpcodeDescriptor* find_opcode_descriptor(NumericOpcode opcode)
+{
+    using namespace opcode_table;
+
+    int numeric_opcode {static_cast<int>(opcode)};
+    if (numeric_opcode < FIRST_NUMERIC_OPCODE ||
+        numeric_opcode > LAST_NUMERIC_OPCODE ||
+        NUMERIC_INDEX[numeric_opcode - FIRST_NUMERIC_OPCODE] < 0)
+    {
+        return nullptr;
+    }
+
+    return &OPCODE_DESCRIPTORS[NUMERIC_INDEX[numeric_opcode -
+                                             FIRST_NUMERIC_OPCODE]];
+}
+
+/**
+ * @brief Finds the numeric opcode of a symbolic opcode, in any case.
+ * @param symbolic_opcode The symbolic opcode.
+ * @return The numeric opcode, or nothing if there is no such opcode.
+ */
+constexpr std::optional<NumericOpcode>
+find_numeric_opcode(std::string_view symbolic_opcode)
+{
+    const OpcodeDescriptor* descriptor {
+        find_opcode_descriptor(symbolic_opcode)};
+    if (descriptor == nullptr)
+    {
+        return std::nullopt;
+    }
+    return descriptor->numeric_opcode;
+}
+
+/**
+ * @brief Gets the type of the instructions with an opcode.
+ * @param opcode The numeric opcode.
+ * @return The type of instruction.
+ */
+constexpr InstructionType get_instruction_type(NumericOpcode opcode)
+{
+    const OpcodeDescriptor* descriptor {find_opcode_descriptor(opcode)};
+    return descriptor == nullptr ? InstructionType::MachineLanguage
+                                 : descriptor->type;
+}
+
+/**
+ * @brief Gets the number of operands an opcode takes.
+ * @param opcode The numeric opcode.
+ * @return The number of operands.
+ */
+constexpr int get_operand_count(NumericOpcode opcode)
+{
+    const OpcodeDescriptor* descriptor {find_opcode_descriptor(opcode)};
+    return descriptor == nullptr ? 0 : descriptor->operand_count;
+}
+
+/**
+ * @brief Gets the type of the operands an opcode takes.
+ * @param opcode The numeric opcode.
+ * @return The type of the operands; the block length of a block instruction
+ * is always numeric.
+ */
+constexpr OperandType get_expected_operand_type(NumericOpcode opcode)
+{
+    const OpcodeDescriptor* descriptor {find_opcode_descriptor(opcode)};
+    return descriptor == nullptr ? OperandType::None
+                                 : descriptor->operand_type;
+}
+
+static_assert(find_numeric_opcode("bSuM") == NumericOpcode::BSUM);
+static_assert(!find_numeric_opcode("BX"));
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LINE_SCANNER_SSE2
+#endif
+
+#include "LineScanner.h"
+
+namespace
+{
+const std::size_t BLOCK_SIZE {16};
+const unsigned    BLOCK_MASK {(1u << BLOCK_SIZE) - 1};
+
+// Bit i of a mask stands for byte i of a block.
+struct BlockMasks
+{
+    unsigned separators {0};
+    unsigned comments {0};
+};
+
+#ifdef LINE_SCANNER_SSE2
+/**
+ * @brief Classifies the bytes of a block.
+ * @param block The block.
+ * @return The separators and comment starts in the block.
+ */
+inline BlockMasks classify_block(const char* block)
+{
+    __m128i bytes {_mm_loadu_si128(reinterpret_cast<const __m128i*>(block))};
+
+    // Tab, newline, vertical tab, form feed and carriage return are the
+    // bytes 9 to 13; below 9 they wrap around to large values.
+    __m128i control {_mm_sub_epi8(bytes, _mm_set1_epi8(9))};
+    __m128i whitespace {_mm_or_si128(
+        _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control),
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')))};
+    __m128i separators {_mm_or_si128(
+        whitespace, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(',')))};
+
+    return {static_cast<unsigned>(_mm_movemask_epi8(separators)),
+            static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8(';'))))};
+}
+#else
+/**
+ * @brief Classifies the bytes of a block.
+ * @param block The block.
+ * @return The separators and comment starts in the block.
+ */
+inline BlockMasks classify_block(const char* block)
+{
+    BlockMasks masks;
+
+    for (std::size_t i = 0; i < BLOCK_SIZE; i++)
+    {
+        char c {block[i]};
+        bool separator {c == ' ' || (c >= '\t' && c <= '\r') || c == ','};
+
+        masks.separators |= static_cast<unsigned>(separator) << i;
+        masks.comments |= static_cast<unsigned>(c == ';') << i;
+    }
+
+    return masks;
+}
+#endif
+} // namespace
+
+LineFields scan_line(std::string_view line)
+{
+    LineFields fields;
+
+    fields.has_label = !line.empty() && line[0] != ' ' && line[0] != '\t' &&
+                       line[0] != ',' && line[0] != ';';
+
+    // Whether the byte before the block is a separator; the line starts as
+    // if one came before it.
+    unsigned    previous_separator {1};
+    std::size_t token_start {0};
+
+    for (std::size_t offset = 0; offset < line.size(); offset += BLOCK_SIZE)
+    {
+        std::size_t length {std::min(BLOCK_SIZE, line.size() - offset)};
+
+        // The last block is padded with separators rather than read past
+        // the end of the line.
+        alignas(16) char padded[BLOCK_SIZE];
+        const char*      block {line.data() + offset};
+        if (length < BLOCK_SIZE)
+        {
+            std::memset(padded, ' ', BLOCK_SIZE);
+            std::memcpy(padded, block, length);
+            block = padded;
+        }
+
+        BlockMasks masks {classify_block(block)};
+
+        // Everything from a semicolon on separates, and ends the line.
+        bool last_block {length < BLOCK_SIZE || masks.comments != 0};
+        if (masks.comments != 0)
+        {
+            masks.separators |=
+                BLOCK_MASK & ~((1u << std::countr_zero(masks.comments)) - 1);
+        }
+
+        // A token starts or ends wherever a byte is classified differently
+        // from the byte before it.
+        unsigned changes {(masks.separators ^
+                           ((masks.separators << 1) | previous_separator)) &
+                          BLOCK_MASK};
+
+        for (; changes != 0; changes &= changes - 1)
+        {
+            std::size_t position {offset + std::countr_zero(changes)};
+
+            if (((masks.separators >> (position - offset)) & 1) == 0)
+            {
+                token_start = position;
+                continue;
+            }
+
+            fields.tokens[fields.token_count++] =
+                line.substr(token_start, position - token_start);
+            if (fields.token_count == LineFields::MAX_TOKENS)
+            {
+                return fields;
+            }
+        }
+
+        previous_separator = (masks.separators >> (BLOCK_SIZE - 1)) & 1;
+
+        if (last_block)
+        {
+            return fields;
+        }
+    }
+
+    // A token running up to the end of a line of whole blocks.
+    if (previous_separator == 0)
+    {
+        fields.tokens[fields.token_count++] = line.substr(token_start);
+    }
+
+    return fields;
+}
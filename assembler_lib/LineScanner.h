@@ -0,0 +1,42 @@
+/**
+ * @file LineScanner.h
+ * @brief Splits a source line into its fields in one pass.
+ * @details The line is classified sixteen bytes at a time into masks of
+ * separators (whitespace and commas) and comment starts. The first comment
+ * start cuts the line short, and the tokens are read off the places where
+ * the separator mask changes. Where SSE2 is available a block is classified
+ * with a few byte comparisons; elsewhere byte by byte, with the same
+ * result.
+ */
+
+#pragma once
+
+#include <array>
+#include <string_view>
+
+/**
+ * @brief The fields of a source line.
+ */
+struct LineFields
+{
+    // A label, an opcode, three operands and one element too many; any
+    // further tokens are not looked for.
+    const static int MAX_TOKENS = 6;
+
+    // True if the line starts with its first token rather than a separator.
+    // That token is then the label.
+    bool has_label {false};
+
+    // The tokens before the comment, as views into the line.
+    std::array<std::string_view, MAX_TOKENS> tokens;
+    int                                      token_count {0};
+};
+
+/**
+ * @brief Splits a line into its label and tokens.
+ * @details Tokens are separated by whitespace and commas, and everything
+ * from a semicolon on is a comment.
+ * @param line The line.
+ * @return The fields of the line.
+ */
+LineFields scan_line(std::string_view line);
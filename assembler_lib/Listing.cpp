@@ -0,0 +1,188 @@
+#include <iostream>
+#include <iterator>
+
+#include <fmt/compile.h>
+
+#include "Exceptions.h"
+#include "Listing.h"
+#include "NumericInstruction.h"
+
+void ListingSink::add_heading(std::string_view title)
+{
+    if (_format == ListingFormat::Table)
+    {
+        fmt::format_to(fmt::appender(_buffer), FMT_COMPILE("{}:\n\n"), title);
+    }
+}
+
+void ListingSink::add_rule()
+{
+    if (_format == ListingFormat::Table)
+    {
+        add_text("___________________________________________________________"
+                 "\n\n");
+    }
+}
+
+void ListingSink::add_symbol_header()
+{
+    if (_format == ListingFormat::Table)
+    {
+        fmt::format_to(fmt::appender(_buffer),
+                       FMT_COMPILE("{:<10}{:<10}{:<10}\n"), "Symbol #",
+                       "Symbol", "Location");
+    }
+}
+
+void ListingSink::add_symbol(int number, std::string_view symbol,
+                             int location)
+{
+    if (_format == ListingFormat::Table)
+    {
+        fmt::format_to(fmt::appender(_buffer),
+                       FMT_COMPILE("{:<10}{:<10}{:<10}\n"), number, symbol,
+                       location);
+    }
+    else
+    {
+        fmt::format_to(fmt::appender(_buffer), FMT_COMPILE("S\t{}\t{}\n"),
+                       symbol, location);
+    }
+    _flush_if_full();
+}
+
+void ListingSink::add_translation_header()
+{
+    if (_format == ListingFormat::Table)
+    {
+        fmt::format_to(fmt::appender(_buffer),
+                       FMT_COMPILE("{:<10}{:<15}{:<30}\n"), "Location",
+                       "Contents", "Original Statement");
+    }
+}
+
+void ListingSink::add_statement(std::string_view statement)
+{
+    if (_format == ListingFormat::Table)
+    {
+        fmt::format_to(fmt::appender(_buffer),
+                       FMT_COMPILE("{:<10}{:<15}{:<30}\n"), "", "", statement);
+        _flush_if_full();
+    }
+}
+
+void ListingSink::add_instruction(int                       location,
+                                  const NumericInstruction& instruction,
+                                  std::string_view          statement)
+{
+    if (_format == ListingFormat::Compact)
+    {
+        if (instruction.has_no_numeric_equivalent())
+        {
+            return;
+        }
+
+        fmt::format_to(fmt::appender(_buffer), FMT_COMPILE("W\t{}\t{}\t{}\n"),
+                       location, instruction.get_numeric_representation(),
+                       statement);
+        if (instruction.has_extension_word())
+        {
+            fmt::format_to(fmt::appender(_buffer), FMT_COMPILE("W\t{}\t{}\t\n"),
+                           location + 1, instruction.get_operand_3());
+        }
+        _flush_if_full();
+        return;
+    }
+
+    // The contents are formatted into a local buffer rather than a string.
+    char        contents[64];
+    std::size_t contents_size {static_cast<std::size_t>(
+        instruction.format_to(contents) - contents)};
+
+    fmt::format_to(fmt::appender(_buffer),
+                   FMT_COMPILE("{:<10}{:<15}{:<30}\n"), location,
+                   std::string_view {contents, contents_size}, statement);
+
+    if (instruction.has_extension_word())
+    {
+        contents_size = static_cast<std::size_t>(
+            instruction.format_extension_to(contents) - contents);
+
+        fmt::format_to(fmt::appender(_buffer),
+                       FMT_COMPILE("{:<10}{:<15}{:<30}\n"), location + 1,
+                       std::string_view {contents, contents_size}, "");
+    }
+    _flush_if_full();
+}
+
+void ListingSink::add_text(std::string_view text)
+{
+    _buffer.append(text);
+    _flush_if_full();
+}
+
+void ListingSink::flush()
+{
+    if (_buffer.size() == 0)
+    {
+        return;
+    }
+
+    _write({_buffer.data(), _buffer.size()});
+    _buffer.clear();
+}
+
+void ListingSink::_flush_if_full()
+{
+    if (_buffer.size() >= FLUSH_BYTES)
+    {
+        flush();
+    }
+}
+
+std::string_view MemoryListing::get_text()
+{
+    flush();
+    return _text;
+}
+
+ConsoleListing::~ConsoleListing() { flush(); }
+
+void ConsoleListing::_write(std::string_view text)
+{
+    std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+FileListing::FileListing(const std::string& listing_file_path,
+                         ListingFormat      format)
+    : ListingSink(format), _listing_file_path(listing_file_path),
+      _file(listing_file_path, std::ios::binary)
+{
+    if (!_file.is_open())
+    {
+        throw ListingFileError(_listing_file_path, "cannot be created");
+    }
+}
+
+FileListing::~FileListing()
+{
+    try
+    {
+        flush();
+    }
+    catch (const ListingFileError&)
+    {
+        // Nothing can be reported from a destructor.
+    }
+}
+
+void FileListing::_write(std::string_view text)
+{
+    _file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    _file.flush();
+
+    if (!_file)
+    {
+        throw ListingFileError(_listing_file_path, "cannot be written");
+    }
+}
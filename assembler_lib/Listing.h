@@ -0,0 +1,215 @@
+/**
+ * @file Listing.h
+ * @brief Where the symbol table and the translation of a program go.
+ * @details A listing sink formats the lines of the listing into a memory
+ * buffer with compile-time checked format strings, and hands the buffer to
+ * its destination whenever it fills up and when flushed, so the
+ * destination sees a few large writes instead of one per line.
+ *
+ * The table format is the one the assembler has always displayed. The
+ * compact format is for programs: one tab-separated record per line, "S",
+ * the symbol and its location for a symbol, and "W", the location, the
+ * word in decimal and the statement for each word of the translation.
+ * Headings, comments and statements without a word are left out.
+ *
+ * An assembler without a listing sink formats no listing at all.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+class NumericInstruction;
+
+/**
+ * @brief How the lines of a listing are laid out.
+ */
+enum class ListingFormat
+{
+    Table,
+    Compact
+};
+
+/**
+ * @brief Receives the listing of an assembly.
+ */
+class ListingSink
+{
+  public:
+    // The buffer is handed to the destination once it holds this much.
+    const static std::size_t FLUSH_BYTES = 64 * 1024;
+
+    /**
+     * @brief Starts an empty listing.
+     * @param format The layout of the lines.
+     */
+    explicit ListingSink(ListingFormat format) : _format(format) {}
+    virtual ~ListingSink() = default;
+
+    ListingSink(const ListingSink&) = delete;
+    ListingSink& operator=(const ListingSink&) = delete;
+
+    /**
+     * @brief Gets the layout of the lines.
+     * @return The format.
+     */
+    [[nodiscard]] ListingFormat get_format() const { return _format; }
+
+    /**
+     * @brief Adds the title of a section of the listing.
+     * @param title The title.
+     */
+    void add_heading(std::string_view title);
+
+    /**
+     * @brief Adds the rule that closes a section of the listing.
+     */
+    void add_rule();
+
+    /**
+     * @brief Adds the column headings of the symbol table.
+     */
+    void add_symbol_header();
+
+    /**
+     * @brief Adds a symbol.
+     * @param number The position of the symbol in the table.
+     * @param symbol The symbol.
+     * @param location The location of the symbol.
+     */
+    void add_symbol(int number, std::string_view symbol, int location);
+
+    /**
+     * @brief Adds the column headings of the translation.
+     */
+    void add_translation_header();
+
+    /**
+     * @brief Adds a statement that is not translated to a word, such as a
+     * comment or the END statement.
+     * @param statement The statement as written.
+     */
+    void add_statement(std::string_view statement);
+
+    /**
+     * @brief Adds a translated statement, with its extension word if it
+     * has one.
+     * @param location The location of the statement.
+     * @param instruction The translation.
+     * @param statement The statement as written.
+     */
+    void add_instruction(int location, const NumericInstruction& instruction,
+                         std::string_view statement);
+
+    /**
+     * @brief Adds lines already formatted in the same format.
+     * @param text The lines.
+     */
+    void add_text(std::string_view text);
+
+    /**
+     * @brief Hands everything added so far to the destination.
+     * @throws ListingFileError for a listing file that cannot be written.
+     */
+    void flush();
+
+  protected:
+    /**
+     * @brief Writes lines to the destination.
+     * @param text The lines.
+     * @throws ListingFileError for a listing file that cannot be written.
+     */
+    virtual void _write(std::string_view text) = 0;
+
+  private:
+    ListingFormat      _format;
+    fmt::memory_buffer _buffer;
+
+    /**
+     * @brief Flushes the buffer if it is full.
+     */
+    void _flush_if_full();
+};
+
+/**
+ * @brief Keeps a listing in memory.
+ */
+class MemoryListing : public ListingSink
+{
+  public:
+    using ListingSink::ListingSink;
+
+    /**
+     * @brief Gets the listing.
+     * @return Everything added so far.
+     */
+    [[nodiscard]] std::string_view get_text();
+
+  protected:
+    void _write(std::string_view text) override { _text += text; }
+
+  private:
+    std::string _text;
+};
+
+/**
+ * @brief Writes a listing to the console.
+ */
+class ConsoleListing : public ListingSink
+{
+  public:
+    /**
+     * @brief Starts a listing on standard output.
+     * @param format The layout of the lines.
+     */
+    explicit ConsoleListing(ListingFormat format = ListingFormat::Table)
+        : ListingSink(format)
+    {
+    }
+
+    /**
+     * @brief Flushes what is left.
+     */
+    ~ConsoleListing() override;
+
+    ConsoleListing(const ConsoleListing&) = delete;
+    ConsoleListing& operator=(const ConsoleListing&) = delete;
+
+  protected:
+    void _write(std::string_view text) override;
+};
+
+/**
+ * @brief Writes a listing to a file.
+ */
+class FileListing : public ListingSink
+{
+  public:
+    /**
+     * @brief Creates the listing file.
+     * @param listing_file_path The path to the listing file.
+     * @param format The layout of the lines.
+     * @throws ListingFileError
+     */
+    FileListing(const std::string& listing_file_path, ListingFormat format);
+
+    /**
+     * @brief Flushes what is left, if it can.
+     */
+    ~FileListing() override;
+
+    FileListing(const FileListing&) = delete;
+    FileListing& operator=(const FileListing&) = delete;
+
+  protected:
+    void _write(std::string_view text) override;
+
+  private:
+    std::string   _listing_file_path;
+    std::ofstream _file;
+};
@@ -1,42 +1,64 @@
-#include <fmt/core.h>
+#include <iterator>
 
+#include "HelperFunctions.h"
 #include "NumericInstruction.h"
 
 NumericInstruction::NumericInstruction(
     const SymbolicInstruction& symbolic_instruction,
     const SymbolTable&         symbol_table)
 {
+    _translate(symbolic_instruction, symbol_table, nullptr);
+}
 
-    std::string symbolic_opcode = symbolic_instruction.get_opcode();
+NumericInstruction::NumericInstruction(
+    const SymbolicInstruction& symbolic_instruction,
+    const SymbolTable&         symbol_table,
+    std::vector<int>&          undefined_operands)
+{
+    _translate(symbolic_instruction, symbol_table, &undefined_operands);
+}
 
-    _opcode = SymbolicOpcode_NumericOpcode.at(symbolic_opcode);
+void NumericInstruction::_translate(
+    const SymbolicInstruction& symbolic_instruction,
+    const SymbolTable&         symbol_table,
+    std::vector<int>*          undefined_operands)
+{
+    _opcode = symbolic_instruction.get_numeric_opcode();
 
-    if (_has_no_numeric_equivalent())
+    if (has_no_numeric_equivalent())
     {
         return;
     }
 
     if (_opcode == NumericOpcode::DC)
     {
-        _operand2 = std::stoi(symbolic_instruction.get_operand_1());
+        _operand2 = parse_number(symbolic_instruction.get_operand_1());
         return;
     }
 
-    switch (NumericOpcode_OperandCount.at(_opcode))
+    switch (get_operand_count(_opcode))
     {
     case 0:
         break;
 
     case 1:
-        _operand1 =
-            symbol_table.get_location(symbolic_instruction.get_operand_1());
+        _operand1 = _resolve(symbolic_instruction.get_operand_1(), 1,
+                             symbol_table, undefined_operands);
         break;
 
     case 2:
-        _operand1 =
-            symbol_table.get_location(symbolic_instruction.get_operand_1());
-        _operand2 =
-            symbol_table.get_location(symbolic_instruction.get_operand_2());
+        _operand1 = _resolve(symbolic_instruction.get_operand_1(), 1,
+                             symbol_table, undefined_operands);
+        _operand2 = _resolve(symbolic_instruction.get_operand_2(), 2,
+                             symbol_table, undefined_operands);
+        break;
+
+    case 3:
+        _operand1 = _resolve(symbolic_instruction.get_operand_1(), 1,
+                             symbol_table, undefined_operands);
+        _operand2 = _resolve(symbolic_instruction.get_operand_2(), 2,
+                             symbol_table, undefined_operands);
+        _operand3 = parse_number(symbolic_instruction.get_operand_3());
         break;
 
     default:
@@ -44,35 +66,68 @@ NumericInstruction::NumericInstruction(
     }
 }
 
+int NumericInstruction::_resolve(std::string_view label, int operand_number,
+                                 const SymbolTable& symbol_table,
+                                 std::vector<int>*  undefined_operands)
+{
+    if (undefined_operands == nullptr)
+    {
+        return symbol_table.get_location(label);
+    }
+
+    int location {0};
+    if (!symbol_table.lookup_symbol(label, location))
+    {
+        undefined_operands->push_back(operand_number);
+        return 0;
+    }
+    return location;
+}
+
 NumericOpcode NumericInstruction::get_opcode() const { return _opcode; }
 
 int NumericInstruction::get_operand_1() const { return _operand1; }
 
 int NumericInstruction::get_operand_2() const { return _operand2; }
 
-std::string NumericInstruction::get_string_representation() const
+int NumericInstruction::get_operand_3() const { return _operand3; }
+
+void NumericInstruction::set_operand(int operand_number, int location)
 {
-    if (_has_no_numeric_equivalent())
-    {
-        return "";
-    }
+    (operand_number == 1 ? _operand1 : _operand2) = location;
+}
 
-    std::string opcode {fmt::format("{:02}", static_cast<int>(_opcode))};
-    std::string operand1 {fmt::format("{:05}", _operand1)};
-    std::string operand2 {fmt::format("{:05}", _operand2)};
+bool NumericInstruction::has_extension_word() const
+{
+    return is_block_opcode(_opcode);
+}
 
-    return opcode + operand1 + operand2;
+std::string NumericInstruction::get_extension_string_representation() const
+{
+    std::string representation;
+    format_extension_to(std::back_inserter(representation));
+    return representation;
+}
+
+std::string NumericInstruction::get_string_representation() const
+{
+    std::string representation;
+    format_to(std::back_inserter(representation));
+    return representation;
 }
 
-bool NumericInstruction::_has_no_numeric_equivalent() const
+bool NumericInstruction::has_no_numeric_equivalent() const
 {
     return static_cast<int>(_opcode) <= -1;
 }
 
 long long NumericInstruction::get_numeric_representation() const
 {
-    if (_has_no_numeric_equivalent())
+    if (has_no_numeric_equivalent())
         return 0;
 
-    return std::stoll(get_string_representation());
+    // The digits format_to writes, as a number.
+    return (static_cast<long long>(_opcode) * OPERAND_SCALE + _operand1) *
+               OPERAND_SCALE +
+           _operand2;
 }
@@ -5,6 +5,11 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
+#include <fmt/compile.h>
+
 #include "InstructionDefinitions.h"
 #include "SymbolTable.h"
 #include "SymbolicInstruction.h"
@@ -26,6 +31,21 @@ class NumericInstruction
     NumericInstruction(const SymbolicInstruction& symbolic_instruction,
                        const SymbolTable&         symbol_table);
 
+    /**
+     * @brief Constructs a numeric instruction whose labels may not be
+     * defined yet.
+     * @details Operands naming labels that are not in the symbol table are
+     * left at 0, to be patched with set_operand once the labels are defined.
+     * @param symbolic_instruction The symbolic instruction to convert to a
+     * numeric instruction.
+     * @param symbol_table The symbol table so far.
+     * @param undefined_operands Receives the number, 1 or 2, of each operand
+     * whose label is not defined yet, in order.
+     */
+    NumericInstruction(const SymbolicInstruction& symbolic_instruction,
+                       const SymbolTable&         symbol_table,
+                       std::vector<int>&          undefined_operands);
+
     /**
      * @brief Destroys a numeric instruction object.
      */
@@ -49,6 +69,70 @@ class NumericInstruction
      */
     [[nodiscard]] int get_operand_2() const;
 
+    /**
+     * @brief Gets the third operand of the numeric instruction.
+     * @return The block length of a block instruction, 0 otherwise.
+     */
+    [[nodiscard]] int get_operand_3() const;
+
+    /**
+     * @brief Sets the location of a label operand.
+     * @param operand_number 1 or 2.
+     * @param location The location of the label.
+     */
+    void set_operand(int operand_number, int location);
+
+    /**
+     * @brief Checks if the instruction takes a second word.
+     * @details Block instructions store their block length in the word after
+     * the instruction.
+     * @return True for block instructions, false otherwise.
+     */
+    [[nodiscard]] bool has_extension_word() const;
+
+    /**
+     * @brief Writes the second word as the listing shows it.
+     * @param out Where to write.
+     * @return The end of what was written.
+     */
+    template <typename OutputIt>
+    OutputIt format_extension_to(OutputIt out) const
+    {
+        if (!has_extension_word())
+        {
+            return out;
+        }
+
+        // Laid out like a DC of the block length.
+        return fmt::format_to(out, FMT_COMPILE("{:012}"), _operand3);
+    }
+
+    /**
+     * @brief Writes the numeric instruction as the listing shows it.
+     * @details The opcode takes two digits and each operand five, as in the
+     * numeric representation.
+     * @param out Where to write.
+     * @return The end of what was written.
+     */
+    template <typename OutputIt>
+    OutputIt format_to(OutputIt out) const
+    {
+        if (has_no_numeric_equivalent())
+        {
+            return out;
+        }
+
+        return fmt::format_to(out, FMT_COMPILE("{:02}{:05}{:05}"),
+                              static_cast<int>(_opcode), _operand1, _operand2);
+    }
+
+    /**
+     * @brief Gets the string representation of the second word.
+     * @return The string representation of the block length, or an empty
+     * string if the instruction takes one word.
+     */
+    [[nodiscard]] std::string get_extension_string_representation() const;
+
     /**
      * @brief Gets the string representation of the numeric instruction.
      * @return The string representation of the numeric instruction.
@@ -61,16 +145,45 @@ class NumericInstruction
      */
     [[nodiscard]] long long get_numeric_representation() const;
 
+    /**
+     * @brief Checks if the numeric instruction has no numeric equivalent.
+     * @return True if the numeric instruction has no numeric equivalent, false
+     * otherwise.
+     */
+    [[nodiscard]] bool has_no_numeric_equivalent() const;
+
   private:
+    // The operands take five decimal digits each, below the opcode.
+    const static long long OPERAND_SCALE = 100'000;
+
     NumericOpcode _opcode {-1};
 
     int _operand1 {0};
     int _operand2 {0};
+    int _operand3 {0};
 
     /**
-     * @brief Checks if the numeric instruction has no numeric equivalent.
-     * @return True if the numeric instruction has no numeric equivalent, false
-     * otherwise.
+     * @brief Converts a symbolic instruction.
+     * @param symbolic_instruction The symbolic instruction.
+     * @param symbol_table The symbol table.
+     * @param undefined_operands Receives the operands whose label is not
+     * defined, or nullptr to throw UndefinedLabelError for them.
+     * @throws UndefinedLabelError
+     */
+    void _translate(const SymbolicInstruction& symbolic_instruction,
+                    const SymbolTable&         symbol_table,
+                    std::vector<int>*          undefined_operands);
+
+    /**
+     * @brief Gets the location of a label operand.
+     * @param label The label.
+     * @param operand_number The number of the operand, 1 or 2.
+     * @param symbol_table The symbol table.
+     * @param undefined_operands As for _translate.
+     * @return The location of the label, or 0 if it is not defined yet.
+     * @throws UndefinedLabelError
      */
-    [[nodiscard]] bool _has_no_numeric_equivalent() const;
+    static int _resolve(std::string_view label, int operand_number,
+                        const SymbolTable& symbol_table,
+                        std::vector<int>*  undefined_operands);
 };
\ No newline at end of file
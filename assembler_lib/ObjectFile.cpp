@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Emulator.h"
+#include "Exceptions.h"
+#include "Listing.h"
+#include "ObjectFile.h"
+
+namespace
+{
+const char        OBJECT_MAGIC[] {"VCOBJCT1"};
+const std::size_t MAGIC_SIZE {8};
+
+const std::size_t HEADER_SIZE {32};
+const std::size_t SEGMENT_SIZE {24};
+const std::size_t CELL_SIZE {8};
+const std::size_t SYMBOL_SIZE {16};
+
+const std::uint32_t STORED_CELLS {0};
+const std::uint32_t RUN {1};
+
+// Shorter runs cost more as segments of their own than as stored cells.
+const int MIN_RUN_LENGTH {8};
+
+template <typename T>
+void put_fixed(std::vector<unsigned char>& buffer, T value)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T> T get_fixed(const unsigned char* bytes)
+{
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief A stretch of memory in an object file.
+ */
+struct Segment
+{
+    std::int32_t  address {0};
+    std::int32_t  length {0};
+    std::uint32_t kind {STORED_CELLS};
+
+    // The index of the first stored cell, or the value of the run.
+    long long value {0};
+};
+
+/**
+ * @brief Splits an image into segments.
+ * @param image The image.
+ * @param cells Receives the cells of the segments that store them.
+ * @return The segments, in address order.
+ */
+std::vector<Segment> encode_segments(std::span<const long long> image,
+                                     std::vector<long long>&    cells)
+{
+    std::vector<Segment> segments;
+    Segment              stored {.address = -1};
+
+    auto end_stored_cells {[&]
+                           {
+                               if (stored.address >= 0)
+                               {
+                                   segments.push_back(stored);
+                                   stored.address = -1;
+                               }
+                           }};
+
+    int size {static_cast<int>(image.size())};
+    for (int address = 0; address < size;)
+    {
+        int run_end {address + 1};
+        while (run_end < size && image[run_end] == image[address])
+        {
+            run_end++;
+        }
+
+        int length {run_end - address};
+        if (length >= MIN_RUN_LENGTH)
+        {
+            // Memory starts out zero, so runs of zeros need no segment.
+            end_stored_cells();
+            if (image[address] != 0)
+            {
+                segments.push_back({address, length, RUN, image[address]});
+            }
+        }
+        else if (stored.address >= 0 || image[address] != 0)
+        {
+            if (stored.address < 0)
+            {
+                stored = {address, 0, STORED_CELLS,
+                          static_cast<long long>(cells.size())};
+            }
+            cells.insert(cells.end(), image.begin() + address,
+                         image.begin() + run_end);
+            stored.length += length;
+        }
+
+        address = run_end;
+    }
+    end_stored_cells();
+
+    return segments;
+}
+} // namespace
+
+void save_object_file(std::span<const long long>                         image,
+                      std::span<const std::pair<std::string_view, int>> symbols,
+                      const std::string& object_file_path)
+{
+    std::vector<long long> cells;
+    std::vector<Segment>   segments {encode_segments(image, cells)};
+
+    std::string names;
+    for (const auto& [symbol, location] : symbols)
+    {
+        names += symbol;
+    }
+
+    std::vector<unsigned char> contents(OBJECT_MAGIC,
+                                        OBJECT_MAGIC + MAGIC_SIZE);
+    put_fixed<std::uint32_t>(contents,
+                             static_cast<std::uint32_t>(segments.size()));
+    put_fixed<std::uint32_t>(contents,
+                             static_cast<std::uint32_t>(symbols.size()));
+    put_fixed<std::uint32_t>(contents,
+                             static_cast<std::uint32_t>(names.size()));
+    put_fixed<std::uint32_t>(contents, 0);
+    put_fixed<std::uint64_t>(contents, cells.size());
+
+    for (const auto& [address, length, kind, value] : segments)
+    {
+        put_fixed<std::int32_t>(contents, address);
+        put_fixed<std::int32_t>(contents, length);
+        put_fixed<std::uint32_t>(contents, kind);
+        put_fixed<std::uint32_t>(contents, 0);
+        put_fixed<long long>(contents, value);
+    }
+
+    for (long long cell : cells)
+    {
+        put_fixed<long long>(contents, cell);
+    }
+
+    std::uint32_t name_offset {0};
+    for (const auto& [symbol, location] : symbols)
+    {
+        put_fixed<std::uint32_t>(contents, name_offset);
+        put_fixed<std::uint32_t>(contents,
+                                 static_cast<std::uint32_t>(symbol.size()));
+        put_fixed<std::int32_t>(contents, location);
+        put_fixed<std::uint32_t>(contents, 0);
+        name_offset += static_cast<std::uint32_t>(symbol.size());
+    }
+    contents.insert(contents.end(), names.begin(), names.end());
+
+    std::string temporary_path {object_file_path + ".tmp"};
+    {
+        std::ofstream object_file {temporary_path,
+                                   std::ios::out | std::ios::binary};
+        object_file.write(reinterpret_cast<const char*>(contents.data()),
+                          static_cast<std::streamsize>(contents.size()));
+        if (!object_file.good())
+        {
+            throw ObjectFileError(object_file_path, "cannot be written");
+        }
+    }
+
+    if (std::rename(temporary_path.c_str(), object_file_path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw ObjectFileError(object_file_path, "cannot be written");
+    }
+}
+
+bool is_object_file(const std::string& file_path)
+{
+    std::ifstream file {file_path, std::ios::in | std::ios::binary};
+    char          magic[MAGIC_SIZE] {};
+
+    file.read(magic, MAGIC_SIZE);
+    return file.good() && std::memcmp(magic, OBJECT_MAGIC, MAGIC_SIZE) == 0;
+}
+
+ObjectFile::ObjectFile(const std::string& object_file_path)
+{
+    int         fd {open(object_file_path.c_str(), O_RDONLY | O_CLOEXEC)};
+    struct stat status {};
+
+    if (fd < 0 || fstat(fd, &status) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw ObjectFileError(object_file_path, "cannot be opened");
+    }
+
+    _size = static_cast<std::size_t>(status.st_size);
+    if (_size < HEADER_SIZE)
+    {
+        close(fd);
+        throw ObjectFileError(object_file_path, "is not an object file");
+    }
+
+    void* contents {mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0)};
+    close(fd);
+    if (contents == MAP_FAILED)
+    {
+        throw ObjectFileError(object_file_path, "cannot be mapped");
+    }
+    _contents = static_cast<const unsigned char*>(contents);
+
+    // From here on the destructor does not run, so unmap before throwing.
+    auto reject {[&](const char* reason)
+                 {
+                     munmap(contents, _size);
+                     throw ObjectFileError(object_file_path, reason);
+                 }};
+
+    if (std::memcmp(_contents, OBJECT_MAGIC, MAGIC_SIZE) != 0)
+    {
+        reject("is not an object file");
+    }
+
+    _segment_count = get_fixed<std::uint32_t>(_contents + 8);
+    _symbol_count = get_fixed<std::uint32_t>(_contents + 12);
+    auto names_size {get_fixed<std::uint32_t>(_contents + 16)};
+    auto cell_count {get_fixed<std::uint64_t>(_contents + 24)};
+
+    // Every count is checked against the size of the file before the
+    // offsets are computed from it, so they cannot overflow.
+    if (cell_count > _size / CELL_SIZE)
+    {
+        reject("is truncated");
+    }
+
+    _segments = HEADER_SIZE;
+    _cells = _segments + _segment_count * SEGMENT_SIZE;
+    _symbols = _cells + cell_count * CELL_SIZE;
+    _names = _symbols + _symbol_count * SYMBOL_SIZE;
+
+    if (_names + names_size != _size)
+    {
+        reject("is truncated");
+    }
+
+    // Loading relies on every segment lying within memory and the stored
+    // cells, and on every name lying within the names.
+    for (std::size_t i = 0; i < _segment_count; i++)
+    {
+        const unsigned char* segment {_contents + _segments +
+                                      i * SEGMENT_SIZE};
+        auto address {get_fixed<std::int32_t>(segment)};
+        auto length {get_fixed<std::int32_t>(segment + 4)};
+        auto kind {get_fixed<std::uint32_t>(segment + 8)};
+        auto first_cell {get_fixed<long long>(segment + 16)};
+
+        if (address < 0 || length < 0 ||
+            address > Emulator::MEMORY_SIZE - length ||
+            (kind != STORED_CELLS && kind != RUN) ||
+            (kind == STORED_CELLS &&
+             (first_cell < 0 ||
+              static_cast<std::uint64_t>(first_cell) + length > cell_count)))
+        {
+            reject("has a malformed segment");
+        }
+    }
+
+    for (std::size_t i = 0; i < _symbol_count; i++)
+    {
+        const unsigned char* symbol {_contents + _symbols + i * SYMBOL_SIZE};
+        auto name_offset {get_fixed<std::uint32_t>(symbol)};
+        auto name_size {get_fixed<std::uint32_t>(symbol + 4)};
+
+        if (static_cast<std::uint64_t>(name_offset) + name_size > names_size)
+        {
+            reject("has a malformed symbol");
+        }
+    }
+}
+
+ObjectFile::~ObjectFile()
+{
+    munmap(const_cast<unsigned char*>(_contents), _size);
+}
+
+void ObjectFile::load_into(Emulator& emulator) const
+{
+    std::vector<long long> image(Emulator::MEMORY_SIZE, 0);
+
+    for (std::size_t i = 0; i < _segment_count; i++)
+    {
+        const unsigned char* segment {_contents + _segments +
+                                      i * SEGMENT_SIZE};
+        auto address {get_fixed<std::int32_t>(segment)};
+        auto length {get_fixed<std::int32_t>(segment + 4)};
+        auto kind {get_fixed<std::uint32_t>(segment + 8)};
+        auto value {get_fixed<long long>(segment + 16)};
+
+        if (kind == RUN)
+        {
+            std::fill_n(image.begin() + address, length, value);
+            continue;
+        }
+
+        // Stored cells are copied straight out of the mapping.
+        std::memcpy(image.data() + address,
+                    _contents + _cells + value * CELL_SIZE,
+                    length * CELL_SIZE);
+    }
+
+    emulator.load_image(image);
+}
+
+std::vector<std::pair<std::string_view, int>> ObjectFile::get_symbols() const
+{
+    std::vector<std::pair<std::string_view, int>> symbols;
+    symbols.reserve(_symbol_count);
+
+    const char* names {reinterpret_cast<const char*>(_contents + _names)};
+    for (std::size_t i = 0; i < _symbol_count; i++)
+    {
+        const unsigned char* symbol {_contents + _symbols + i * SYMBOL_SIZE};
+        symbols.emplace_back(
+            std::string_view {names + get_fixed<std::uint32_t>(symbol),
+                              get_fixed<std::uint32_t>(symbol + 4)},
+            get_fixed<std::int32_t>(symbol + 8));
+    }
+
+    return symbols;
+}
+
+void ObjectFile::display_symbol_table(ListingSink& listing) const
+{
+    listing.add_symbol_header();
+
+    int counter {0};
+    for (const auto& [symbol, location] : get_symbols())
+    {
+        listing.add_symbol(counter, symbol, location);
+        ++counter;
+    }
+}
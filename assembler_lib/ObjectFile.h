@@ -0,0 +1,111 @@
+/**
+ * @file ObjectFile.h
+ * @brief Assembled programs saved for running without the assembler.
+ * @details An object file holds the loaded image of an assembled program and
+ * its symbol table. Memory is stored as segments: a run of cells with the
+ * same value is stored as the value, and other stretches of cells are stored
+ * cell by cell. Cells that are zero, such as those reserved with DS, are not
+ * stored at all.
+ *
+ * Object file format, all fields fixed-width little-endian: the magic
+ * "VCOBJCT1", whose last character is the format version; the segment
+ * count, symbol count and size of the symbol names as 32-bit values; and
+ * the number of stored cells as a 64-bit value. Then come the segments, each
+ * as the address, length and kind (0 for stored cells, 1 for a run) as
+ * 32-bit values, 4 bytes of padding and a 64-bit value: the index of the
+ * segment's first stored cell, or the value of the run. Then the stored
+ * cells as 64-bit values, the symbols, each as the offset and size of its
+ * name and its location as 32-bit values and 4 bytes of padding, and last
+ * the names of the symbols.
+ *
+ * Every table starts at a multiple of 8 bytes, so a mapped object file is
+ * used where it lies: loading reads the tables out of the mapping rather
+ * than decoding the file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class Emulator;
+class ListingSink;
+
+/**
+ * @brief Writes an object file.
+ * @details The file is written under a temporary name and renamed into
+ * place, so an interrupted write leaves the previous object file intact.
+ * @param image The loaded image of the program.
+ * @param symbols The symbols of the program and their locations.
+ * @param object_file_path The path to the object file.
+ * @throws ObjectFileError
+ */
+void save_object_file(std::span<const long long>                         image,
+                      std::span<const std::pair<std::string_view, int>> symbols,
+                      const std::string& object_file_path);
+
+/**
+ * @brief Checks if a file is an object file rather than a source file.
+ * @param file_path The path to the file.
+ * @return True if the file starts with the object file magic.
+ */
+bool is_object_file(const std::string& file_path);
+
+/**
+ * @brief An object file, mapped into memory.
+ */
+class ObjectFile
+{
+  public:
+    /**
+     * @brief Maps an object file and checks that its tables lie within it.
+     * @param object_file_path The path to the object file.
+     * @throws ObjectFileError
+     */
+    explicit ObjectFile(const std::string& object_file_path);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~ObjectFile();
+
+    ObjectFile(const ObjectFile&) = delete;
+    ObjectFile& operator=(const ObjectFile&) = delete;
+
+    /**
+     * @brief Loads the program into an emulator, as its loaded image.
+     * @param emulator The emulator.
+     * @throws PagePoolError
+     */
+    void load_into(Emulator& emulator) const;
+
+    /**
+     * @brief Gets the symbols of the program.
+     * @return The symbols in order, as views into the mapped file.
+     */
+    [[nodiscard]] std::vector<std::pair<std::string_view, int>>
+    get_symbols() const;
+
+    /**
+     * @brief Adds the symbol table to a listing, as SymbolTable does.
+     * @param listing The listing.
+     */
+    void display_symbol_table(ListingSink& listing) const;
+
+  private:
+    const unsigned char* _contents {nullptr};
+    std::size_t          _size {0};
+
+    std::size_t _segment_count {0};
+    std::size_t _symbol_count {0};
+
+    // Offsets of the tables in the file.
+    std::size_t _segments {0};
+    std::size_t _cells {0};
+    std::size_t _symbols {0};
+    std::size_t _names {0};
+};
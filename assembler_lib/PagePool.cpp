@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Exceptions.h"
+#include "PagePool.h"
+
+namespace
+{
+/**
+ * @brief Hashes the contents of a page.
+ * @param cells The cells of the page.
+ * @param cell_count The number of cells.
+ * @return The hash.
+ */
+std::uint64_t hash_page(const long long* cells, int cell_count)
+{
+    std::uint64_t hash {0};
+
+    for (int i = 0; i < cell_count; i++)
+    {
+        hash = (hash ^ static_cast<std::uint64_t>(cells[i])) *
+               0x9E3779B97F4A7C15;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
+} // namespace
+
+PagePool::PagePool()
+{
+#if defined(__linux__)
+    _fd = memfd_create("vc1620-page-pool", MFD_CLOEXEC);
+#endif
+    if (_fd < 0)
+    {
+        throw PagePoolError("cannot be created");
+    }
+
+    _page_bytes = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    _cells_per_page = static_cast<int>(_page_bytes / sizeof(long long));
+    _stored_page.resize(_cells_per_page);
+}
+
+PagePool::~PagePool() { close(_fd); }
+
+long long PagePool::intern(const long long* cells, int cell_count)
+{
+    std::vector<long long> page(cells, cells + cell_count);
+    page.resize(_cells_per_page, 0);
+
+    if (std::ranges::all_of(page, [](long long cell) { return cell == 0; }))
+    {
+        return ZERO_PAGE;
+    }
+
+    std::uint64_t   hash {hash_page(page.data(), _cells_per_page)};
+    std::lock_guard lock {_mutex};
+
+    auto [first, last] {_pages_by_hash.equal_range(hash)};
+    for (auto candidate {first}; candidate != last; ++candidate)
+    {
+        auto offset {static_cast<off_t>(candidate->second * _page_bytes)};
+
+        if (pread(_fd, _stored_page.data(), _page_bytes, offset) ==
+                static_cast<ssize_t>(_page_bytes) &&
+            _stored_page == page)
+        {
+            return candidate->second;
+        }
+    }
+
+    auto offset {static_cast<off_t>(_page_count * _page_bytes)};
+    if (pwrite(_fd, page.data(), _page_bytes, offset) !=
+        static_cast<ssize_t>(_page_bytes))
+    {
+        throw PagePoolError(
+            fmt::format("cannot store a page: {}", std::strerror(errno)));
+    }
+
+    _pages_by_hash.emplace(hash, _page_count);
+    return _page_count++;
+}
+
+long long PagePool::get_page_count() const
+{
+    std::lock_guard lock {_mutex};
+    return _page_count;
+}
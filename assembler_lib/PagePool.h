@@ -0,0 +1,91 @@
+/**
+ * @file PagePool.h
+ * @brief Memory pages shared by the emulators in a process.
+ * @details Many emulators holding similar programs hold mostly identical
+ * pages. A pool keeps one copy of each distinct page in a memfd, found by a
+ * hash of its contents, and emulators map their pages from it copy-on-write.
+ * Pages nobody writes stay shared, so memory grows with the number of
+ * distinct pages rather than with the number of emulators. Pages of zeros
+ * are not stored at all: they are mapped from anonymous memory, which the
+ * kernel backs with its shared zero page until written.
+ *
+ * Pages in the pool are never changed, only appended, so a mapping of a
+ * page always sees the contents it was interned with.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A process-wide store of distinct memory pages.
+ * @details Interning is thread-safe, so emulators on several threads can
+ * share a pool.
+ */
+class PagePool
+{
+  public:
+    // Returned by intern for a page of zeros.
+    const static long long ZERO_PAGE = -1;
+
+    /**
+     * @brief Creates an empty pool.
+     * @throws PagePoolError
+     */
+    PagePool();
+
+    /**
+     * @brief Closes the pool. Pages that are still mapped stay valid.
+     */
+    ~PagePool();
+
+    PagePool(const PagePool&) = delete;
+    PagePool& operator=(const PagePool&) = delete;
+
+    /**
+     * @brief Finds a page with some contents, adding it if it is new.
+     * @param cells The cells of the page; fewer than a page are padded with
+     * zeros.
+     * @param cell_count The number of cells, at most get_cells_per_page.
+     * @return The index of the page in the pool, or ZERO_PAGE.
+     * @throws PagePoolError
+     */
+    long long intern(const long long* cells, int cell_count);
+
+    /**
+     * @brief Gets the file descriptor of the pool, for mapping its pages.
+     * @return The file descriptor; page i starts at offset i times the page
+     * size.
+     */
+    [[nodiscard]] int get_fd() const { return _fd; }
+
+    /**
+     * @brief Gets the number of cells in a page.
+     * @return The number of cells in a system page.
+     */
+    [[nodiscard]] int get_cells_per_page() const { return _cells_per_page; }
+
+    /**
+     * @brief Gets the number of distinct pages stored.
+     * @return The number of pages, not counting pages of zeros.
+     */
+    [[nodiscard]] long long get_page_count() const;
+
+  private:
+    int         _fd {-1};
+    std::size_t _page_bytes {0};
+    int         _cells_per_page {0};
+
+    mutable std::mutex _mutex;
+
+    // Indices of the stored pages, by hash of their contents.
+    std::unordered_multimap<std::uint64_t, long long> _pages_by_hash;
+    long long                                          _page_count {0};
+
+    // A page read back from the pool, for comparison.
+    std::vector<long long> _stored_page;
+};
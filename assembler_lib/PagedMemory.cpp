@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "Exceptions.h"
+#include "PagePool.h"
+#include "PagedMemory.h"
+
+namespace
+{
+const int MAX_WATCHED_MEMORIES {64};
+
+// Memories with watchpoints, searched by the SIGSEGV handler.
+std::array<std::atomic<PagedMemory*>, MAX_WATCHED_MEMORIES>
+    watched_memories {};
+
+// Memory whose faulting write is being single-stepped on this thread.
+thread_local PagedMemory* faulting_memory {nullptr};
+
+struct sigaction previous_segv_action {};
+struct sigaction previous_trap_action {};
+std::once_flag   handlers_installed;
+
+#if defined(__x86_64__) && defined(__linux__)
+const bool WATCHPOINTS_SUPPORTED {true};
+
+// The x86 trap flag: the processor traps after the next instruction.
+const greg_t TRAP_FLAG {0x100};
+
+/**
+ * @brief Passes a signal that is not ours on to the handler we replaced.
+ * @details Our handler stays installed, so watchpoints keep working after a
+ * fault elsewhere has been handled.
+ * @param signal_number The signal.
+ * @param previous The action in place before ours.
+ * @param info The signal information.
+ * @param context The context of the interrupted thread.
+ */
+void forward_signal(int signal_number, const struct sigaction& previous,
+                    siginfo_t* info, void* context)
+{
+    if ((previous.sa_flags & SA_SIGINFO) != 0)
+    {
+        previous.sa_sigaction(signal_number, info, context);
+        return;
+    }
+
+    // An ignored fault would only recur, so it is treated as fatal.
+    if (previous.sa_handler == SIG_IGN && signal_number != SIGSEGV)
+    {
+        return;
+    }
+
+    if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN)
+    {
+        struct sigaction default_action {};
+        default_action.sa_handler = SIG_DFL;
+        sigemptyset(&default_action.sa_mask);
+
+        sigaction(signal_number, &default_action, nullptr);
+        raise(signal_number);
+        return;
+    }
+
+    previous.sa_handler(signal_number);
+}
+
+void handle_segv(int signal_number, siginfo_t* info, void* context)
+{
+    for (auto& slot : watched_memories)
+    {
+        PagedMemory* memory {slot.load(std::memory_order_acquire)};
+
+        if (memory != nullptr && memory->begin_write_fault(info->si_addr))
+        {
+            // Let the write complete, then trap so the page can be
+            // protected again.
+            faulting_memory = memory;
+            static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EFL] |=
+                TRAP_FLAG;
+            return;
+        }
+    }
+
+    // Not a watched page.
+    forward_signal(signal_number, previous_segv_action, info, context);
+}
+
+void handle_trap(int signal_number, siginfo_t* info, void* context)
+{
+    if (faulting_memory == nullptr)
+    {
+        forward_signal(signal_number, previous_trap_action, info, context);
+        return;
+    }
+
+    static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EFL] &=
+        ~TRAP_FLAG;
+
+    faulting_memory->end_write_fault();
+    faulting_memory = nullptr;
+}
+
+void install_handlers()
+{
+    struct sigaction action {};
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    action.sa_sigaction = handle_segv;
+    sigaction(SIGSEGV, &action, &previous_segv_action);
+
+    action.sa_sigaction = handle_trap;
+    sigaction(SIGTRAP, &action, &previous_trap_action);
+}
+#else
+const bool WATCHPOINTS_SUPPORTED {false};
+
+void install_handlers() {}
+#endif
+} // namespace
+
+PagedMemory::PagedMemory(int cell_count, const int* location)
+    : _cell_count(cell_count), _location(location)
+{
+    auto page_bytes {static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+    auto cell_bytes {static_cast<std::size_t>(cell_count) * sizeof(long long)};
+
+    _mapping_bytes = (cell_bytes + page_bytes - 1) / page_bytes * page_bytes;
+    _cells_per_page = static_cast<int>(page_bytes / sizeof(long long));
+    _page_watch_counts.resize(_mapping_bytes / page_bytes, 0);
+
+    void* mapping {mmap(nullptr, _mapping_bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+    if (mapping == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+
+    _cells = static_cast<long long*>(mapping);
+}
+
+PagedMemory::~PagedMemory()
+{
+    for (auto& slot : watched_memories)
+    {
+        PagedMemory* expected {this};
+        slot.compare_exchange_strong(expected, nullptr);
+    }
+
+    munmap(_cells, _mapping_bytes);
+}
+
+void PagedMemory::write_unwatched(int address, long long value)
+{
+    if (_page_watch_counts[address / _cells_per_page] == 0)
+    {
+        _cells[address] = value;
+        return;
+    }
+
+    _protect_page(address, true);
+    _cells[address] = value;
+    _protect_page(address, false);
+}
+
+void PagedMemory::copy_unwatched(int first, const long long* source,
+                                 int count)
+{
+    int end {first + count};
+
+    while (first < end)
+    {
+        int page_end {std::min((first / _cells_per_page + 1) * _cells_per_page,
+                               end)};
+        bool watched {_page_watch_counts[first / _cells_per_page] != 0};
+
+        if (watched)
+        {
+            _protect_page(first, true);
+        }
+
+        std::copy(source, source + (page_end - first), _cells + first);
+
+        if (watched)
+        {
+            _protect_page(first, false);
+        }
+
+        source += page_end - first;
+        first = page_end;
+    }
+}
+
+void PagedMemory::map_pool_pages(const PagePool&               pool,
+                                 const std::vector<long long>& pages,
+                                 bool                          writable)
+{
+    auto page_bytes {static_cast<std::size_t>(_cells_per_page) *
+                     sizeof(long long)};
+    int  protection {writable ? PROT_READ | PROT_WRITE : PROT_READ};
+
+    // Runs of zero pages and runs of consecutive pool pages are mapped with
+    // one call each, so the kernel keeps few mappings.
+    std::size_t first {0};
+    while (first < pages.size())
+    {
+        bool        zero {pages[first] == PagePool::ZERO_PAGE};
+        std::size_t end {first + 1};
+        while (end < pages.size() &&
+               (zero ? pages[end] == PagePool::ZERO_PAGE
+                     : pages[end] == pages[end - 1] + 1))
+        {
+            end++;
+        }
+
+        char* address {reinterpret_cast<char*>(_cells) + first * page_bytes};
+        void* mapping {
+            zero ? mmap(address, (end - first) * page_bytes, protection,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0)
+                 : mmap(address, (end - first) * page_bytes, protection,
+                        (writable ? MAP_PRIVATE : MAP_SHARED) | MAP_FIXED,
+                        pool.get_fd(),
+                        static_cast<off_t>(pages[first] * page_bytes))};
+
+        if (mapping == MAP_FAILED)
+        {
+            throw PagePoolError("pages cannot be mapped");
+        }
+
+        first = end;
+    }
+
+    for (std::size_t page = 0; page < _page_watch_counts.size(); page++)
+    {
+        if (_page_watch_counts[page] != 0)
+        {
+            _protect_page(static_cast<int>(page) * _cells_per_page, false);
+        }
+    }
+}
+
+void PagedMemory::discard_private_pages(int first, int count)
+{
+    auto page_bytes {static_cast<std::size_t>(_cells_per_page) *
+                     sizeof(long long)};
+    auto first_page {static_cast<std::size_t>(first / _cells_per_page)};
+    auto end_page {static_cast<std::size_t>(
+        (first + count + _cells_per_page - 1) / _cells_per_page)};
+
+    madvise(reinterpret_cast<char*>(_cells) + first_page * page_bytes,
+            (end_page - first_page) * page_bytes, MADV_DONTNEED);
+}
+
+void PagedMemory::add_watchpoint(int address)
+{
+    if (!WATCHPOINTS_SUPPORTED)
+    {
+        throw WatchpointError(address, "cannot be watched on this platform");
+    }
+
+    if (address < 0 || address >= _cell_count)
+    {
+        throw WatchpointError(address, "is outside memory");
+    }
+
+    if (_watched_cells.contains(address))
+    {
+        return;
+    }
+
+    if (_watched_cells.empty())
+    {
+        std::call_once(handlers_installed, install_handlers);
+
+        if (!_hits)
+        {
+            _hits = std::make_unique<WatchpointHit[]>(MAX_WATCHPOINT_HITS);
+        }
+
+        auto free_slot {std::ranges::find_if(
+            watched_memories, [](const auto& slot)
+            { return slot.load(std::memory_order_relaxed) == nullptr; })};
+        if (free_slot == watched_memories.end())
+        {
+            throw WatchpointError(address, "exceeds the watched memory limit");
+        }
+        free_slot->store(this, std::memory_order_release);
+    }
+
+    _watched_cells.insert(address);
+
+    if (_page_watch_counts[address / _cells_per_page]++ == 0)
+    {
+        _protect_page(address, false);
+    }
+}
+
+void PagedMemory::remove_watchpoint(int address)
+{
+    if (_watched_cells.erase(address) == 0)
+    {
+        return;
+    }
+
+    if (--_page_watch_counts[address / _cells_per_page] == 0)
+    {
+        _protect_page(address, true);
+    }
+
+    if (_watched_cells.empty())
+    {
+        for (auto& slot : watched_memories)
+        {
+            PagedMemory* expected {this};
+            slot.compare_exchange_strong(expected, nullptr);
+        }
+    }
+}
+
+std::vector<WatchpointHit> PagedMemory::take_watchpoint_hits()
+{
+    std::vector<WatchpointHit> hits;
+    if (_hits)
+    {
+        hits.assign(_hits.get(), _hits.get() + _hit_count);
+    }
+
+    _hit_count = 0;
+    return hits;
+}
+
+bool PagedMemory::begin_write_fault(const void* fault_address)
+{
+    auto fault {reinterpret_cast<std::uintptr_t>(fault_address)};
+    auto begin {reinterpret_cast<std::uintptr_t>(_cells)};
+
+    if (fault < begin || fault >= begin + _mapping_bytes)
+    {
+        return false;
+    }
+
+    auto address {static_cast<int>((fault - begin) / sizeof(long long))};
+
+    if (address >= _cell_count ||
+        _page_watch_counts[address / _cells_per_page] == 0)
+    {
+        return false;
+    }
+
+    _fault_address = address;
+    _fault_location = *_location;
+    _fault_old_value = _cells[address];
+
+    _protect_page(address, true);
+    return true;
+}
+
+void PagedMemory::end_write_fault()
+{
+    if (_watched_cells.contains(_fault_address))
+    {
+        if (_hit_count < MAX_WATCHPOINT_HITS)
+        {
+            _hits[_hit_count++] = {_fault_location, _fault_address,
+                                   _fault_old_value, _cells[_fault_address]};
+        }
+        else
+        {
+            _dropped_hit_count++;
+        }
+    }
+
+    _protect_page(_fault_address, false);
+    _fault_address = -1;
+}
+
+void PagedMemory::_protect_page(int address, bool writable) const
+{
+    auto page_bytes {static_cast<std::size_t>(_cells_per_page) *
+                     sizeof(long long)};
+    auto page {static_cast<std::size_t>(address / _cells_per_page)};
+
+    mprotect(reinterpret_cast<char*>(_cells) + page * page_bytes, page_bytes,
+             writable ? PROT_READ | PROT_WRITE : PROT_READ);
+}
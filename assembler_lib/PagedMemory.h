@@ -0,0 +1,196 @@
+/**
+ * @file PagedMemory.h
+ * @brief Emulator memory placed in mmap'd pages.
+ * @details The cells of the simulated memory live in an anonymous mapping,
+ * so individual pages can be write-protected. Watchpoints use this: a page
+ * that holds a watched cell is made read-only, a write to it faults, and the
+ * fault handler lets the write complete before recording it. Writes to pages
+ * without watchpoints run at full speed.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <vector>
+
+class PagePool;
+
+/**
+ * @brief A write to a watched memory cell.
+ */
+struct WatchpointHit
+{
+    // Location of the instruction that wrote the cell.
+    int location {0};
+
+    int       address {0};
+    long long old_value {0};
+    long long new_value {0};
+};
+
+/**
+ * @brief Emulator memory placed in mmap'd pages.
+ */
+class PagedMemory
+{
+  public:
+    // Hits recorded between two calls to take_watchpoint_hits. Later hits
+    // are counted but not recorded.
+    const static int MAX_WATCHPOINT_HITS = 4096;
+
+    /**
+     * @brief Maps zero-filled memory for a number of cells.
+     * @param cell_count The number of cells.
+     * @param location The location of the executing instruction, as
+     * published by the emulator. It is reported with watchpoint hits.
+     */
+    PagedMemory(int cell_count, const int* location);
+
+    /**
+     * @brief Removes the watchpoints and unmaps the memory.
+     */
+    ~PagedMemory();
+
+    PagedMemory(const PagedMemory&) = delete;
+    PagedMemory& operator=(const PagedMemory&) = delete;
+
+    /**
+     * @brief Gets the cells.
+     * @return The first cell of the memory.
+     */
+    [[nodiscard]] long long* data() const { return _cells; }
+
+    /**
+     * @brief Gets the number of cells.
+     * @return The number of cells.
+     */
+    [[nodiscard]] int size() const { return _cell_count; }
+
+    /**
+     * @brief Gets the number of cells in a page.
+     * @return The number of cells in a page.
+     */
+    [[nodiscard]] int get_cells_per_page() const { return _cells_per_page; }
+
+    /**
+     * @brief Writes a cell without reporting it to watchpoints.
+     * @param address The cell to write.
+     * @param value The value to write.
+     */
+    void write_unwatched(int address, long long value);
+
+    /**
+     * @brief Copies a range of cells without reporting it to watchpoints.
+     * @param first The first cell to write.
+     * @param source The values to copy.
+     * @param count The number of cells to write.
+     */
+    void copy_unwatched(int first, const long long* source, int count);
+
+    /**
+     * @brief Maps the cells onto pages of a pool.
+     * @details A writable mapping is copy-on-write, so a page stays shared
+     * until it is written. Watched pages stay write-protected.
+     * @param pool The pool.
+     * @param pages The pool index of each page of the mapping, or
+     * PagePool::ZERO_PAGE.
+     * @param writable False to map the pages read-only.
+     * @throws PagePoolError
+     */
+    void map_pool_pages(const PagePool&               pool,
+                        const std::vector<long long>& pages, bool writable);
+
+    /**
+     * @brief Drops the private copies of the pages holding a range of cells.
+     * @details Pages mapped from a pool read as the pool page again, and
+     * others as zeros. The whole of each page holding the range is dropped.
+     * @param first The first cell of the range.
+     * @param count The number of cells in the range.
+     */
+    void discard_private_pages(int first, int count);
+
+    /**
+     * @brief Reports every write to a cell.
+     * @param address The cell to watch.
+     * @throws WatchpointError
+     */
+    void add_watchpoint(int address);
+
+    /**
+     * @brief Stops reporting writes to a cell.
+     * @param address The watched cell.
+     */
+    void remove_watchpoint(int address);
+
+    /**
+     * @brief Checks if any cell is watched.
+     * @return True if at least one cell is watched.
+     */
+    [[nodiscard]] bool has_watchpoints() const
+    {
+        return !_watched_cells.empty();
+    }
+
+    /**
+     * @brief Gets the writes to watched cells since the last call.
+     * @return The writes, in the order they happened.
+     */
+    std::vector<WatchpointHit> take_watchpoint_hits();
+
+    /**
+     * @brief Gets the number of hits that did not fit in the hit buffer.
+     * @return The number of hits that were dropped.
+     */
+    [[nodiscard]] long long get_dropped_hit_count() const
+    {
+        return _dropped_hit_count;
+    }
+
+    /**
+     * @brief Starts handling a write fault.
+     * @details Called from the SIGSEGV handler. Saves the old value and makes
+     * the page writable so the faulting write can complete.
+     * @param fault_address The address that was written.
+     * @return False if the address does not belong to a watched page.
+     */
+    bool begin_write_fault(const void* fault_address);
+
+    /**
+     * @brief Finishes handling a write fault.
+     * @details Called from the SIGTRAP handler once the faulting write has
+     * completed. Records the hit if the exact cell is watched, and protects
+     * the page again.
+     */
+    void end_write_fault();
+
+  private:
+    long long*  _cells {nullptr};
+    int         _cell_count {0};
+    std::size_t _mapping_bytes {0};
+    int         _cells_per_page {0};
+
+    const int* _location {nullptr};
+
+    std::set<int> _watched_cells;
+
+    // Number of watched cells in each page.
+    std::vector<int> _page_watch_counts;
+
+    // Fault being handled. Only touched by the signal handlers.
+    int       _fault_address {-1};
+    int       _fault_location {0};
+    long long _fault_old_value {0};
+
+    std::unique_ptr<WatchpointHit[]> _hits;
+    int                              _hit_count {0};
+    long long                        _dropped_hit_count {0};
+
+    /**
+     * @brief Changes the protection of the page that holds a cell.
+     * @param address A cell in the page.
+     * @param writable True to allow writes to the page.
+     */
+    void _protect_page(int address, bool writable) const;
+};
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "Exceptions.h"
+#include "InputLog.h"
+#include "ResultCache.h"
+#include "Varint.h"
+
+namespace
+{
+const char RESULT_MAGIC[] {"VCRESLT1"};
+const int  MAGIC_SIZE {8};
+
+const char ENTRY_EXTENSION[] {".vcres"};
+const char LOCK_FILE_NAME[] {".lock"};
+
+/**
+ * @brief Mixes the bits of a word.
+ * @param value The word.
+ * @return The mixed word.
+ */
+std::uint64_t mix(std::uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCD;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53;
+    value ^= value >> 33;
+    return value;
+}
+
+/**
+ * @brief Hashes a sequence of values, including its length.
+ * @param values The values.
+ * @return The hash.
+ */
+std::uint64_t hash_values(std::span<const long long> values)
+{
+    std::uint64_t hash {mix(values.size() + 1)};
+
+    for (long long value : values)
+    {
+        hash = mix(hash ^ mix(static_cast<std::uint64_t>(value)));
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Parses an entry.
+ * @param contents The contents of the entry file.
+ * @param result Receives the result.
+ * @return False if the entry is malformed.
+ */
+bool parse_entry(const std::string& contents, CachedResult& result)
+{
+    if (contents.size() < MAGIC_SIZE ||
+        std::memcmp(contents.data(), RESULT_MAGIC, MAGIC_SIZE) != 0)
+    {
+        return false;
+    }
+
+    std::size_t   position {MAGIC_SIZE};
+    std::uint64_t value;
+
+    if (!get_varint(contents, position, value))
+        return false;
+    result.instruction_count = static_cast<long long>(value);
+
+    if (!get_varint(contents, position, value))
+        return false;
+    result.halt_location = static_cast<int>(value);
+
+    if (contents.size() - position < sizeof(result.memory_digest))
+        return false;
+    std::memcpy(&result.memory_digest, contents.data() + position,
+                sizeof(result.memory_digest));
+    position += sizeof(result.memory_digest);
+
+    std::uint64_t output_count;
+    if (!get_varint(contents, position, output_count) ||
+        output_count > contents.size())
+        return false;
+    for (std::uint64_t i = 0; i < output_count; i++)
+    {
+        if (!get_varint(contents, position, value))
+            return false;
+        result.output.push_back(zigzag_decode(value));
+    }
+
+    std::uint64_t delta_count;
+    if (!get_varint(contents, position, delta_count) ||
+        delta_count > contents.size())
+        return false;
+    int address {0};
+    for (std::uint64_t i = 0; i < delta_count; i++)
+    {
+        if (!get_varint(contents, position, value))
+            return false;
+        address += static_cast<int>(value);
+
+        if (address >= Emulator::MEMORY_SIZE ||
+            !get_varint(contents, position, value))
+            return false;
+        result.memory_delta.push_back({address, 0, zigzag_decode(value)});
+    }
+
+    return position == contents.size();
+}
+
+/**
+ * @brief Serialises a result.
+ * @param result The result.
+ * @return The contents of the entry file.
+ */
+std::string format_entry(const CachedResult& result)
+{
+    std::string contents {RESULT_MAGIC, MAGIC_SIZE};
+
+    put_varint(contents, static_cast<std::uint64_t>(result.instruction_count));
+    put_varint(contents, static_cast<std::uint64_t>(result.halt_location));
+    contents.append(reinterpret_cast<const char*>(&result.memory_digest),
+                    sizeof(result.memory_digest));
+
+    put_varint(contents, result.output.size());
+    for (long long value : result.output)
+    {
+        put_varint(contents, zigzag_encode(value));
+    }
+
+    // Deltas are in address order, so addresses are stored as differences.
+    put_varint(contents, result.memory_delta.size());
+    int previous_address {0};
+    for (const auto& [address, old_value, new_value] : result.memory_delta)
+    {
+        put_varint(contents,
+                   static_cast<std::uint64_t>(address - previous_address));
+        put_varint(contents, zigzag_encode(new_value));
+        previous_address = address;
+    }
+
+    return contents;
+}
+} // namespace
+
+ResultCache::ResultCache(std::string directory, std::uintmax_t max_bytes)
+    : _directory(std::move(directory)), _max_bytes(max_bytes)
+{
+    std::error_code error;
+    std::filesystem::create_directories(_directory, error);
+
+    if (!std::filesystem::is_directory(_directory))
+    {
+        throw ResultCacheError(_directory, "is not a directory");
+    }
+}
+
+CacheKey ResultCache::make_key(std::span<const long long>    image,
+                               const std::vector<long long>& input,
+                               long long                     final_count)
+{
+    return {hash_values(image), hash_values(input), final_count};
+}
+
+std::optional<CachedResult> ResultCache::find(const CacheKey& key) const
+{
+    std::string   entry_path {_get_entry_path(key)};
+    std::ifstream entry {entry_path, std::ios::in | std::ios::binary};
+    if (!entry.is_open())
+    {
+        return std::nullopt;
+    }
+
+    std::string contents {std::istreambuf_iterator<char>(entry),
+                          std::istreambuf_iterator<char>()};
+
+    CachedResult result;
+    if (!parse_entry(contents, result))
+    {
+        return std::nullopt;
+    }
+
+    // Marks the entry as recently used, for eviction.
+    utimensat(AT_FDCWD, entry_path.c_str(), nullptr, 0);
+
+    result.from_cache = true;
+    return result;
+}
+
+void ResultCache::store(const CacheKey& key, const CachedResult& result)
+{
+    std::string contents {format_entry(result)};
+
+    std::string temporary_path {_directory + "/tmp-XXXXXX"};
+    int         descriptor {mkstemp(temporary_path.data())};
+    if (descriptor < 0)
+    {
+        throw ResultCacheError(_directory, "cannot hold a new entry");
+    }
+
+    bool written {write(descriptor, contents.data(), contents.size()) ==
+                  static_cast<ssize_t>(contents.size())};
+    close(descriptor);
+
+    // Renaming is atomic, so readers never see a partial entry.
+    if (!written ||
+        std::rename(temporary_path.c_str(), _get_entry_path(key).c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw ResultCacheError(_directory, "cannot hold a new entry");
+    }
+
+    _evict();
+}
+
+std::string ResultCache::_get_entry_path(const CacheKey& key) const
+{
+    return fmt::format("{}/{:016x}-{:016x}-{:016x}{}", _directory,
+                       key.image_hash, key.input_hash,
+                       static_cast<std::uint64_t>(key.final_count),
+                       ENTRY_EXTENSION);
+}
+
+void ResultCache::_evict()
+{
+    std::string lock_path {_directory + "/" + LOCK_FILE_NAME};
+    int         lock {open(lock_path.c_str(), O_RDWR | O_CREAT, 0644)};
+    if (lock < 0)
+    {
+        return;
+    }
+    flock(lock, LOCK_EX);
+
+    struct Entry
+    {
+        std::filesystem::path           path;
+        std::uintmax_t                  size {0};
+        std::filesystem::file_time_type used_time;
+    };
+
+    std::vector<Entry> entries;
+    std::uintmax_t     total_size {0};
+    std::error_code    error;
+
+    for (const auto& file :
+         std::filesystem::directory_iterator(_directory, error))
+    {
+        if (file.path().extension() != ENTRY_EXTENSION)
+            continue;
+
+        // Another process may evict the file at any moment.
+        std::uintmax_t size {file.file_size(error)};
+        if (error)
+            continue;
+        auto used_time {file.last_write_time(error)};
+        if (error)
+            continue;
+
+        entries.push_back({file.path(), size, used_time});
+        total_size += size;
+    }
+
+    if (total_size > _max_bytes)
+    {
+        std::ranges::sort(entries, {}, &Entry::used_time);
+
+        for (const auto& entry : entries)
+        {
+            if (total_size <= _max_bytes)
+                break;
+
+            std::filesystem::remove(entry.path, error);
+            total_size -= entry.size;
+        }
+    }
+
+    flock(lock, LOCK_UN);
+    close(lock);
+}
+
+CachedResult run_cached(Emulator& emulator, ReplayInput& replay_input,
+                        ResultCache& cache)
+{
+    CacheKey key {ResultCache::make_key(emulator.get_image(),
+                                        replay_input.get_values(),
+                                        replay_input.get_final_count())};
+
+    emulator.reset();
+
+    if (auto cached {cache.find(key)})
+    {
+        for (const auto& [address, old_value, new_value] :
+             cached->memory_delta)
+        {
+            emulator.insert(address, new_value);
+        }
+
+        // Entries do not hold the old values; the image does.
+        cached->memory_delta = emulator.get_memory_delta();
+        return *cached;
+    }
+
+    // The recorded input checks every READ, so a run that strays from the
+    // recording fails rather than being stored.
+    CollectingOutput collecting_output;
+    emulator.set_input_source(&replay_input);
+    emulator.set_output_sink(&collecting_output);
+
+    StopReason stop_reason;
+    try
+    {
+        stop_reason = emulator.run_program();
+    }
+    catch (...)
+    {
+        emulator.set_input_source(nullptr);
+        emulator.set_output_sink(nullptr);
+        throw;
+    }
+    emulator.set_input_source(nullptr);
+    emulator.set_output_sink(nullptr);
+
+    CachedResult result;
+    result.output = collecting_output.get_values();
+    result.instruction_count = emulator.get_instruction_count();
+    result.halt_location = emulator.get_location();
+    result.memory_digest = emulator.get_memory_digest();
+    result.memory_delta = emulator.get_memory_delta();
+
+    if (stop_reason == StopReason::Halt)
+    {
+        replay_input.check_finished(result.instruction_count);
+        cache.store(key, result);
+    }
+
+    return result;
+}
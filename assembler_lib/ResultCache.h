@@ -0,0 +1,140 @@
+/**
+ * @file ResultCache.h
+ * @brief A persistent cache of whole-run results.
+ * @details A replayed run of a program is fully determined by the loaded
+ * image, the values READ consumes and the instruction count the recorded run
+ * halted at, so its result can be looked up instead of emulated. Each result
+ * is a file in the cache directory named after the hashes of the image and
+ * the input and the final count. Files are written under a temporary
+ * name and renamed into place, so concurrent readers in other processes see
+ * either no entry or a complete one. A hit refreshes the file's modification
+ * time; when the directory grows past its size bound, the entries modified
+ * least recently are removed, under an exclusive flock on the directory's
+ * lock file so that only one process evicts at a time.
+ *
+ * Entry format: the magic "VCRESLT1", the instruction count and halt location
+ * as varints, the memory digest as 8 bytes, the output count followed by the
+ * output values as zigzag varints, then the count of changed cells followed
+ * by each cell as an address delta varint and a zigzag value.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Emulator.h"
+
+class ReplayInput;
+
+/**
+ * @brief Identifies a run by what determines it.
+ */
+struct CacheKey
+{
+    std::uint64_t image_hash {0};
+    std::uint64_t input_hash {0};
+
+    // The instruction count the recorded run halted at, or -1 if unknown.
+    long long final_count {-1};
+};
+
+/**
+ * @brief The result of a run that halted.
+ */
+struct CachedResult
+{
+    std::vector<long long>   output;
+    long long                instruction_count {0};
+    int                      halt_location {0};
+    std::uint64_t            memory_digest {0};
+    std::vector<MemoryDelta> memory_delta;
+
+    // True if the result was read from the cache rather than emulated.
+    bool from_cache {false};
+};
+
+/**
+ * @brief A directory of cached run results, shared between processes.
+ */
+class ResultCache
+{
+  public:
+    const static std::uintmax_t DEFAULT_MAX_BYTES = 64 << 20;
+
+    /**
+     * @brief Opens a cache directory, creating it if needed.
+     * @param directory The path to the directory.
+     * @param max_bytes The size the entries are evicted down to.
+     * @throws ResultCacheError
+     */
+    explicit ResultCache(std::string    directory,
+                         std::uintmax_t max_bytes = DEFAULT_MAX_BYTES);
+
+    /**
+     * @brief Computes the key of a run.
+     * @param image The loaded image, see Emulator::get_image.
+     * @param input The values READ consumes.
+     * @param final_count The instruction count the recorded run halted at,
+     * or -1 if unknown.
+     * @return The key.
+     */
+    [[nodiscard]] static CacheKey make_key(std::span<const long long> image,
+                                           const std::vector<long long>& input,
+                                           long long final_count);
+
+    /**
+     * @brief Looks up a result.
+     * @details Unreadable entries are treated as missing.
+     * @param key The key of the run.
+     * @return The result, or nothing if it is not cached.
+     */
+    [[nodiscard]] std::optional<CachedResult> find(const CacheKey& key) const;
+
+    /**
+     * @brief Adds a result, then evicts entries if the cache is too big.
+     * @param key The key of the run.
+     * @param result The result.
+     * @throws ResultCacheError
+     */
+    void store(const CacheKey& key, const CachedResult& result);
+
+  private:
+    std::string    _directory;
+    std::uintmax_t _max_bytes {DEFAULT_MAX_BYTES};
+
+    /**
+     * @brief Gets the path of the entry for a key.
+     * @param key The key.
+     * @return The path.
+     */
+    [[nodiscard]] std::string _get_entry_path(const CacheKey& key) const;
+
+    /**
+     * @brief Removes the least recently used entries until the cache fits.
+     */
+    void _evict();
+};
+
+/**
+ * @brief Replays the loaded program on recorded input, or looks up the
+ * result.
+ * @details The emulator is reset first. On a hit, the changed cells are
+ * written back to memory, so the emulator's memory ends as if the program
+ * had run. On a miss, the program runs on the recorded input with its output
+ * collected, and the result is stored if the program halted where the
+ * recorded run did. Either way the emulator's input and output are set back
+ * to the console.
+ * @param emulator The emulator holding the program and its saved image.
+ * @param replay_input The recorded input, not yet read from.
+ * @param cache The cache.
+ * @return The result of the run.
+ * @throws DivisionByZeroError
+ * @throws ReplayDivergenceError
+ * @throws ResultCacheError
+ */
+CachedResult run_cached(Emulator& emulator, ReplayInput& replay_input,
+                        ResultCache& cache);
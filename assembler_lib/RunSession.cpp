@@ -0,0 +1,574 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "Exceptions.h"
+#include "RunSession.h"
+#include "Varint.h"
+
+namespace
+{
+const char SESSION_MAGIC[] {"VCSESSN2"};
+const int  MAGIC_SIZE {8};
+
+/**
+ * @brief Gets the contents of a cell in an image.
+ * @param image The image, or an empty span for all zeros.
+ * @param address The cell.
+ * @return The contents of the cell.
+ */
+long long get_image_cell(std::span<const long long> image, int address)
+{
+    return image.empty() ? 0 : image[address];
+}
+
+/**
+ * @brief Checks if an address is inside memory.
+ * @param address The address, taken from an operand.
+ * @return True if the address names a cell.
+ */
+bool is_cell(int address)
+{
+    return address >= 0 && address < Emulator::MEMORY_SIZE;
+}
+
+/**
+ * @brief Serialises a list of values.
+ * @param contents The buffer to append to.
+ * @param values The values.
+ */
+void put_values(std::string& contents, const std::vector<long long>& values)
+{
+    put_varint(contents, values.size());
+    for (long long value : values)
+    {
+        put_varint(contents, zigzag_encode(value));
+    }
+}
+
+/**
+ * @brief Parses a list of values.
+ * @param contents The contents of the session file.
+ * @param position The position of the list, moved past it.
+ * @param values Receives the values.
+ * @return False if the list is malformed.
+ */
+bool get_values(const std::string& contents, std::size_t& position,
+                std::vector<long long>& values)
+{
+    std::uint64_t count;
+    if (!get_varint(contents, position, count) || count > contents.size())
+    {
+        return false;
+    }
+
+    std::uint64_t value;
+    for (std::uint64_t i = 0; i < count; i++)
+    {
+        if (!get_varint(contents, position, value))
+        {
+            return false;
+        }
+        values.push_back(zigzag_decode(value));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Serialises a list of cells.
+ * @param contents The buffer to append to.
+ * @param cells The cells, in address order.
+ */
+void put_cells(std::string& contents, const std::vector<MemoryDelta>& cells)
+{
+    put_varint(contents, cells.size());
+
+    int previous_address {0};
+    for (const auto& [address, old_value, new_value] : cells)
+    {
+        put_varint(contents,
+                   static_cast<std::uint64_t>(address - previous_address));
+        put_varint(contents, zigzag_encode(new_value));
+        previous_address = address;
+    }
+}
+
+/**
+ * @brief Parses a list of cells.
+ * @param contents The contents of the session file.
+ * @param position The position of the list, moved past it.
+ * @param image The image the cells differ from, or an empty vector.
+ * @param cells Receives the cells.
+ * @return False if the list is malformed.
+ */
+bool get_cells(const std::string& contents, std::size_t& position,
+               const std::vector<long long>& image,
+               std::vector<MemoryDelta>&     cells)
+{
+    std::uint64_t count;
+    if (!get_varint(contents, position, count) || count > contents.size())
+    {
+        return false;
+    }
+
+    int           address {0};
+    std::uint64_t value;
+    for (std::uint64_t i = 0; i < count; i++)
+    {
+        // Checked before it is added, so a corrupt delta cannot wrap.
+        if (!get_varint(contents, position, value) ||
+            value > static_cast<std::uint64_t>(Emulator::MEMORY_SIZE))
+        {
+            return false;
+        }
+        address += static_cast<int>(value);
+
+        if (!is_cell(address) || !get_varint(contents, position, value))
+        {
+            return false;
+        }
+        cells.push_back({address, get_image_cell(image, address),
+                         zigzag_decode(value)});
+    }
+
+    return true;
+}
+
+/**
+ * @brief Moves a checkpoint of the old run onto the new image.
+ * @param checkpoint The checkpoint, relative to the old image.
+ * @param previous The session of the old run.
+ * @param image The new image.
+ * @param changed_cells The cells whose contents the edit changed.
+ * @return The checkpoint, relative to the new image.
+ */
+SessionCheckpoint rebase_checkpoint(const SessionCheckpoint&   checkpoint,
+                                    const RunSession&          previous,
+                                    std::span<const long long> image,
+                                    const std::vector<int>&    changed_cells)
+{
+    long long instruction_count {checkpoint.position.instruction_count};
+
+    std::vector<long long> cells(Emulator::MEMORY_SIZE);
+    std::vector<bool>      differs(Emulator::MEMORY_SIZE, false);
+    for (const auto& [address, old_value, new_value] : checkpoint.delta)
+    {
+        cells[address] = new_value;
+        differs[address] = true;
+    }
+
+    // A changed cell the run had written holds what the run wrote, even if
+    // that equals the old image and so is missing from the delta.
+    for (int address : changed_cells)
+    {
+        long long first_write {previous.first_writes[address]};
+        if (first_write >= 0 && first_write < instruction_count &&
+            !differs[address])
+        {
+            cells[address] = get_image_cell(previous.image, address);
+            differs[address] = true;
+        }
+    }
+
+    SessionCheckpoint rebased {checkpoint.position, {}};
+    for (int address = 0; address < Emulator::MEMORY_SIZE; address++)
+    {
+        long long image_value {get_image_cell(image, address)};
+        if (differs[address] && cells[address] != image_value)
+        {
+            rebased.delta.push_back({address, image_value, cells[address]});
+        }
+    }
+
+    return rebased;
+}
+} // namespace
+
+SessionRecorder::SessionRecorder(RunSession& session) : _session(session)
+{
+    _session.first_reads.resize(Emulator::MEMORY_SIZE, -1);
+    _session.first_writes.resize(Emulator::MEMORY_SIZE, -1);
+}
+
+void SessionRecorder::record(const TraceRecord& record)
+{
+    using enum NumericOpcode;
+
+    _note_read(record.location, record.index);
+
+    switch (record.opcode)
+    {
+    case ADD:
+    case SUB:
+    case MULT:
+    case DIV:
+        _note_read(record.operand1, record.index);
+        _note_read(record.operand2, record.index);
+        break;
+    case COPY:
+    case BM:
+    case BZ:
+    case BP:
+        _note_read(record.operand2, record.index);
+        break;
+    case READ:
+        _session.input.push_back(record.value);
+        break;
+    case WRITE:
+        _note_read(record.operand1, record.index);
+        _session.output.push_back(record.value);
+        break;
+    case BCOPY:
+    case BADD:
+    case BFILL:
+    case BSUM:
+        _note_block(record);
+        return;
+    default:
+        break;
+    }
+
+    bool stores {record.opcode == ADD || record.opcode == SUB ||
+                 record.opcode == MULT || record.opcode == DIV ||
+                 record.opcode == COPY || record.opcode == READ};
+
+    if (stores)
+    {
+        _note_write(record.operand1, record.index);
+    }
+}
+
+void SessionRecorder::_note_block(const TraceRecord& record)
+{
+    using enum NumericOpcode;
+
+    // The word after the instruction holds the block length.
+    _note_read(record.location + 1, record.index);
+
+    auto length {static_cast<int>(record.value)};
+    int  source_length {record.opcode == BFILL ? 1 : length};
+    int  destination_length {record.opcode == BSUM ? 1 : length};
+
+    for (int i = 0; i < source_length; i++)
+    {
+        _note_read(record.operand2 + i, record.index);
+    }
+
+    if (record.opcode == BADD)
+    {
+        for (int i = 0; i < length; i++)
+        {
+            _note_read(record.operand1 + i, record.index);
+        }
+    }
+
+    for (int i = 0; i < destination_length; i++)
+    {
+        _note_write(record.operand1 + i, record.index);
+    }
+}
+
+void SessionRecorder::_note_read(int address, long long instruction_count)
+{
+    if (is_cell(address) && _session.first_reads[address] < 0 &&
+        _session.first_writes[address] < 0)
+    {
+        _session.first_reads[address] = instruction_count;
+    }
+}
+
+void SessionRecorder::_note_write(int address, long long instruction_count)
+{
+    if (is_cell(address) && _session.first_writes[address] < 0)
+    {
+        _session.first_writes[address] = instruction_count;
+    }
+}
+
+void save_session(const RunSession&  session,
+                  const std::string& session_file_path)
+{
+    std::string contents {SESSION_MAGIC, MAGIC_SIZE};
+    put_varint(contents,
+               static_cast<std::uint64_t>(session.checkpoint_interval));
+
+    std::vector<MemoryDelta> image_cells;
+    for (int address = 0; address < static_cast<int>(session.image.size());
+         address++)
+    {
+        if (session.image[address] != 0)
+        {
+            image_cells.push_back({address, 0, session.image[address]});
+        }
+    }
+    put_cells(contents, image_cells);
+
+    put_values(contents, session.input);
+    put_values(contents, session.output);
+
+    std::string accesses;
+    std::size_t access_count {0};
+    int         previous_address {0};
+    for (int address = 0;
+         address < static_cast<int>(session.first_reads.size()); address++)
+    {
+        long long first_read {session.first_reads[address]};
+        long long first_write {session.first_writes[address]};
+        if (first_read < 0 && first_write < 0)
+        {
+            continue;
+        }
+
+        put_varint(accesses,
+                   static_cast<std::uint64_t>(address - previous_address));
+        put_varint(accesses, static_cast<std::uint64_t>(first_read + 1));
+        put_varint(accesses, static_cast<std::uint64_t>(first_write + 1));
+        previous_address = address;
+        access_count++;
+    }
+    put_varint(contents, access_count);
+    contents += accesses;
+
+    put_varint(contents, session.checkpoints.size());
+    for (const auto& [position, delta] : session.checkpoints)
+    {
+        put_varint(contents, static_cast<std::uint64_t>(position.location));
+        put_varint(contents,
+                   static_cast<std::uint64_t>(position.instruction_count));
+        put_varint(contents, static_cast<std::uint64_t>(position.read_count));
+        put_varint(contents, static_cast<std::uint64_t>(position.write_count));
+        put_cells(contents, delta);
+    }
+
+    std::string temporary_path {session_file_path + ".tmp"};
+    {
+        std::ofstream session_file {temporary_path,
+                                    std::ios::out | std::ios::binary};
+        session_file.write(contents.data(),
+                           static_cast<std::streamsize>(contents.size()));
+        if (!session_file.good())
+        {
+            throw SessionError(session_file_path, "cannot be written");
+        }
+    }
+
+    if (std::rename(temporary_path.c_str(), session_file_path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw SessionError(session_file_path, "cannot be written");
+    }
+}
+
+std::optional<RunSession> load_session(const std::string& session_file_path)
+{
+    std::ifstream session_file {session_file_path,
+                                std::ios::in | std::ios::binary};
+    if (!session_file.is_open())
+    {
+        return std::nullopt;
+    }
+
+    std::string contents {std::istreambuf_iterator<char>(session_file),
+                          std::istreambuf_iterator<char>()};
+
+    if (contents.size() < MAGIC_SIZE ||
+        std::memcmp(contents.data(), SESSION_MAGIC, MAGIC_SIZE) != 0)
+    {
+        return std::nullopt;
+    }
+
+    RunSession    session;
+    std::size_t   position {MAGIC_SIZE};
+    std::uint64_t value;
+
+    if (!get_varint(contents, position, value) || value == 0)
+    {
+        return std::nullopt;
+    }
+    session.checkpoint_interval = static_cast<long long>(value);
+
+    std::vector<MemoryDelta> image_cells;
+    if (!get_cells(contents, position, {}, image_cells))
+    {
+        return std::nullopt;
+    }
+    session.image.assign(Emulator::MEMORY_SIZE, 0);
+    for (const auto& [address, old_value, new_value] : image_cells)
+    {
+        session.image[address] = new_value;
+    }
+
+    if (!get_values(contents, position, session.input) ||
+        !get_values(contents, position, session.output))
+    {
+        return std::nullopt;
+    }
+
+    session.first_reads.assign(Emulator::MEMORY_SIZE, -1);
+    session.first_writes.assign(Emulator::MEMORY_SIZE, -1);
+
+    std::uint64_t access_count;
+    if (!get_varint(contents, position, access_count) ||
+        access_count > contents.size())
+    {
+        return std::nullopt;
+    }
+
+    int address {0};
+    for (std::uint64_t i = 0; i < access_count; i++)
+    {
+        std::uint64_t first_read;
+        std::uint64_t first_write;
+        if (!get_varint(contents, position, value) ||
+            value > static_cast<std::uint64_t>(Emulator::MEMORY_SIZE) ||
+            !get_varint(contents, position, first_read) ||
+            !get_varint(contents, position, first_write))
+        {
+            return std::nullopt;
+        }
+
+        address += static_cast<int>(value);
+        if (!is_cell(address))
+        {
+            return std::nullopt;
+        }
+
+        session.first_reads[address] = static_cast<long long>(first_read) - 1;
+        session.first_writes[address] =
+            static_cast<long long>(first_write) - 1;
+    }
+
+    std::uint64_t checkpoint_count;
+    if (!get_varint(contents, position, checkpoint_count) ||
+        checkpoint_count > contents.size())
+    {
+        return std::nullopt;
+    }
+
+    for (std::uint64_t i = 0; i < checkpoint_count; i++)
+    {
+        SessionCheckpoint checkpoint;
+        std::uint64_t     fields[4];
+
+        for (auto& field : fields)
+        {
+            if (!get_varint(contents, position, field))
+            {
+                return std::nullopt;
+            }
+        }
+        checkpoint.position = {static_cast<int>(fields[0]),
+                               static_cast<long long>(fields[1]),
+                               static_cast<long long>(fields[2]),
+                               static_cast<long long>(fields[3])};
+
+        if (checkpoint.position.read_count >
+                static_cast<long long>(session.input.size()) ||
+            checkpoint.position.write_count >
+                static_cast<long long>(session.output.size()) ||
+            !get_cells(contents, position, session.image, checkpoint.delta))
+        {
+            return std::nullopt;
+        }
+
+        session.checkpoints.push_back(std::move(checkpoint));
+    }
+
+    if (position != contents.size() || session.checkpoints.empty())
+    {
+        return std::nullopt;
+    }
+
+    return session;
+}
+
+void add_checkpoint(RunSession& session, const Emulator& emulator)
+{
+    session.checkpoints.push_back(
+        {emulator.get_position(), emulator.get_memory_delta()});
+}
+
+ResumePlan plan_resume(const RunSession&          previous,
+                       std::span<const long long> image)
+{
+    ResumePlan plan;
+
+    std::vector<int> changed_cells;
+    for (int address = 0; address < Emulator::MEMORY_SIZE; address++)
+    {
+        if (get_image_cell(previous.image, address) !=
+            get_image_cell(image, address))
+        {
+            changed_cells.push_back(address);
+        }
+    }
+
+    // Only a changed cell read before the run wrote it can make the new
+    // program behave differently.
+    for (int address : changed_cells)
+    {
+        long long first_read {previous.first_reads[address]};
+        if (first_read >= 0 && (plan.first_affected_count < 0 ||
+                                first_read < plan.first_affected_count))
+        {
+            plan.first_affected_count = first_read;
+        }
+    }
+
+    RunSession& session {plan.session};
+    session.image.assign(image.begin(), image.end());
+    session.checkpoint_interval = previous.checkpoint_interval;
+
+    for (const auto& checkpoint : previous.checkpoints)
+    {
+        if (plan.first_affected_count >= 0 &&
+            checkpoint.position.instruction_count > plan.first_affected_count)
+        {
+            break;
+        }
+
+        session.checkpoints.push_back(
+            rebase_checkpoint(checkpoint, previous, image, changed_cells));
+    }
+
+    // The log after the resume point belongs to the new run.
+    const RunPosition& resumed {session.checkpoints.back().position};
+
+    session.input.assign(previous.input.begin(),
+                         previous.input.begin() + resumed.read_count);
+    plan.later_input.assign(previous.input.begin() + resumed.read_count,
+                            previous.input.end());
+    session.output.assign(previous.output.begin(),
+                          previous.output.begin() + resumed.write_count);
+
+    session.first_reads.assign(Emulator::MEMORY_SIZE, -1);
+    session.first_writes.assign(Emulator::MEMORY_SIZE, -1);
+    for (int address = 0; address < Emulator::MEMORY_SIZE; address++)
+    {
+        if (previous.first_reads[address] < resumed.instruction_count)
+        {
+            session.first_reads[address] = previous.first_reads[address];
+        }
+        if (previous.first_writes[address] < resumed.instruction_count)
+        {
+            session.first_writes[address] = previous.first_writes[address];
+        }
+    }
+
+    return plan;
+}
+
+void restore_checkpoint(Emulator&                emulator,
+                        const SessionCheckpoint& checkpoint)
+{
+    emulator.reset();
+
+    for (const auto& [address, old_value, new_value] : checkpoint.delta)
+    {
+        emulator.insert(address, new_value);
+    }
+
+    emulator.set_position(checkpoint.position);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file RunSession.h
+ * @brief A log of a run, for re-running an edited program.
+ * @details A session records, for every memory cell, the first instruction
+ * that read or executed it before any instruction wrote it, and the first
+ * instruction that wrote it. It also keeps the values READ and WRITE
+ * moved and the state of memory every checkpoint interval.
+ *
+ * When the program is edited and assembled again, only the cells whose
+ * contents changed matter. The first instruction the edit affects is the
+ * earliest first read among them. Up to that instruction the new program
+ * runs exactly like the old one, so the checkpoints before it hold for the
+ * new program too, once the changed cells the run had not yet written are
+ * given their new contents. The new run resumes from the last of them.
+ *
+ * Session file format: the magic "VCSESSN2", the checkpoint interval as a
+ * varint, then the non-zero cells of the image, the READ values and the
+ * WRITE values as zigzag varint lists. Next come the accessed cells as a
+ * count, then each cell as an address delta, the first read plus one and
+ * the first write plus one, as varints. Last come the checkpoint count, then
+ * each checkpoint as the location, instruction count, READ count and WRITE
+ * count as varints, followed by the cells that differ from the image. Cell
+ * lists are a count, then each cell as an address delta varint and a
+ * zigzag value.
+ */
+
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Emulator.h"
+#include "TraceFile.h"
+
+/**
+ * @brief The state of a run after some number of instructions.
+ */
+struct SessionCheckpoint
+{
+    RunPosition              position;
+    std::vector<MemoryDelta> delta;
+};
+
+/**
+ * @brief The log of a run.
+ */
+struct RunSession
+{
+    const static long long DEFAULT_CHECKPOINT_INTERVAL = 1 << 20;
+
+    std::vector<long long> image;
+    long long              checkpoint_interval {DEFAULT_CHECKPOINT_INTERVAL};
+
+    // Values READ consumed and WRITE produced, in run order.
+    std::vector<long long> input;
+    std::vector<long long> output;
+
+    // For each cell, the instruction count of the first instruction that
+    // read or executed it before any wrote it, or -1. Empty until recorded.
+    std::vector<long long> first_reads;
+
+    // For each cell, the instruction count of the first instruction that
+    // wrote it, or -1. Empty until recorded.
+    std::vector<long long> first_writes;
+
+    // In instruction count order; the first is where the run started.
+    std::vector<SessionCheckpoint> checkpoints;
+};
+
+/**
+ * @brief Where an edited program can pick up its previous run.
+ */
+struct ResumePlan
+{
+    // The instruction count of the first instruction the edit affects, or
+    // -1 if the previous run is not affected at all.
+    long long first_affected_count {-1};
+
+    // The previous session cut back to its last checkpoint before that
+    // instruction and rebased onto the new image; the new run resumes from
+    // its last checkpoint.
+    RunSession session;
+
+    // Values the previous run read after the resume point, for the new run
+    // to read first.
+    std::vector<long long> later_input;
+};
+
+/**
+ * @brief Logs the instructions an emulator executes into a session.
+ */
+class SessionRecorder : public TraceSink
+{
+  public:
+    /**
+     * @brief Starts logging, after whatever the session already holds.
+     * @param session The session.
+     */
+    explicit SessionRecorder(RunSession& session);
+
+    void record(const TraceRecord& record) override;
+
+  private:
+    RunSession& _session;
+
+    /**
+     * @brief Notes that an instruction reads a cell.
+     * @param address The cell, taken from an operand.
+     * @param instruction_count The instruction count of the instruction.
+     */
+    void _note_read(int address, long long instruction_count);
+
+    /**
+     * @brief Notes that an instruction writes a cell.
+     * @param address The cell, taken from an operand.
+     * @param instruction_count The instruction count of the instruction.
+     */
+    void _note_write(int address, long long instruction_count);
+
+    /**
+     * @brief Notes the cells a block instruction reads and writes.
+     * @param record The block instruction, with its block length as value.
+     */
+    void _note_block(const TraceRecord& record);
+};
+
+/**
+ * @brief Writes a session file.
+ * @details The file is written under a temporary name and renamed into
+ * place, so an interrupted write leaves the previous session intact.
+ * @param session The session.
+ * @param session_file_path The path to the session file.
+ * @throws SessionError
+ */
+void save_session(const RunSession&  session,
+                  const std::string& session_file_path);
+
+/**
+ * @brief Reads a session file.
+ * @param session_file_path The path to the session file.
+ * @return The session, or nothing if the file is missing or malformed.
+ */
+std::optional<RunSession> load_session(const std::string& session_file_path);
+
+/**
+ * @brief Records the current state of a run in a session.
+ * @param session The session.
+ * @param emulator The emulator running the program.
+ */
+void add_checkpoint(RunSession& session, const Emulator& emulator);
+
+/**
+ * @brief Finds where the previous run of a program stops holding for an
+ * edited version of it.
+ * @param previous The session of the previous run, as loaded or recorded.
+ * @param image The image of the edited program.
+ * @return The session to continue.
+ */
+ResumePlan plan_resume(const RunSession&          previous,
+                       std::span<const long long> image);
+
+/**
+ * @brief Puts an emulator in the state of a checkpoint.
+ * @details Memory is reset to the loaded image first, so the checkpoint must
+ * have been taken or rebased against it.
+ * @param emulator The emulator holding the program.
+ * @param checkpoint The checkpoint.
+ */
+void restore_checkpoint(Emulator&                emulator,
+                        const SessionCheckpoint& checkpoint);
@@ -0,0 +1,133 @@
+/**
+ * @file SpscQueue.h
+ * @brief A bounded queue between one producer thread and one consumer
+ * thread.
+ * @details The queue is a ring of slots indexed by two counters, the number
+ * of items pushed and the number popped, each written by one side only, so
+ * neither side takes a lock. A full queue makes the producer wait and an
+ * empty one makes the consumer wait; waiting sleeps on a third counter that
+ * every push, pop and close bumps, so a waiting thread costs no CPU.
+ *
+ * Either side may close the queue. The producer closes it after its last
+ * item; the consumer closes it to stop the producer early.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief A bounded single-producer single-consumer queue.
+ * @tparam T The type of the items; default constructible and movable.
+ */
+template <typename T>
+class SpscQueue
+{
+  public:
+    /**
+     * @brief Creates an empty queue.
+     * @param capacity The number of items the queue holds before the
+     * producer waits.
+     */
+    explicit SpscQueue(std::size_t capacity) : _slots(capacity) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Adds an item, waiting while the queue is full.
+     * @param item The item.
+     * @return False if the queue was closed; the item is dropped.
+     */
+    bool push(T&& item)
+    {
+        std::size_t pushed {_pushed.load(std::memory_order_relaxed)};
+
+        while (true)
+        {
+            unsigned signal {_signal.load(std::memory_order_acquire)};
+
+            if (_closed.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            if (pushed - _popped.load(std::memory_order_acquire) <
+                _slots.size())
+            {
+                break;
+            }
+            _signal.wait(signal, std::memory_order_acquire);
+        }
+
+        _slots[pushed % _slots.size()] = std::move(item);
+        _pushed.store(pushed + 1, std::memory_order_release);
+        _wake();
+
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest item, waiting while the queue is empty.
+     * @details Items pushed before the queue was closed are still taken.
+     * @return The item, or nothing once the queue is closed and empty.
+     */
+    std::optional<T> pop()
+    {
+        std::size_t popped {_popped.load(std::memory_order_relaxed)};
+
+        while (true)
+        {
+            unsigned signal {_signal.load(std::memory_order_acquire)};
+
+            if (_pushed.load(std::memory_order_acquire) != popped)
+            {
+                break;
+            }
+            // An item pushed just before closing is visible by now.
+            if (_closed.load(std::memory_order_acquire) &&
+                _pushed.load(std::memory_order_acquire) == popped)
+            {
+                return std::nullopt;
+            }
+            _signal.wait(signal, std::memory_order_acquire);
+        }
+
+        std::optional<T> item {std::move(_slots[popped % _slots.size()])};
+        _popped.store(popped + 1, std::memory_order_release);
+        _wake();
+
+        return item;
+    }
+
+    /**
+     * @brief Closes the queue, waking the other side.
+     */
+    void close()
+    {
+        _closed.store(true, std::memory_order_release);
+        _wake();
+    }
+
+  private:
+    std::vector<T> _slots;
+
+    // On separate cache lines, so the two sides do not invalidate each
+    // other's counter on every item.
+    alignas(64) std::atomic<std::size_t> _pushed {0};
+    alignas(64) std::atomic<std::size_t> _popped {0};
+
+    alignas(64) std::atomic<unsigned> _signal {0};
+    std::atomic<bool> _closed {false};
+
+    /**
+     * @brief Wakes the other side if it is waiting.
+     */
+    void _wake()
+    {
+        _signal.fetch_add(1, std::memory_order_release);
+        _signal.notify_all();
+    }
+};
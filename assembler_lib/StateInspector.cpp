@@ -0,0 +1,81 @@
+#include "Emulator.h"
+#include "Exceptions.h"
+#include "StateInspector.h"
+
+void StateInspector::add_range(int first, int count)
+{
+    // publish copies the range out of the emulator memory.
+    if (first < 0 || count < 0 || count > Emulator::MEMORY_SIZE - first)
+    {
+        throw InspectedRangeError(first, count);
+    }
+
+    _ranges.push_back({first, count});
+    _cell_count += count;
+
+    _cells = std::make_unique<std::atomic<long long>[]>(_cell_count);
+}
+
+void StateInspector::publish(int location, long long instruction_count,
+                             bool stopped, const Emulator& emulator)
+{
+    unsigned long long sequence {_sequence.load(std::memory_order_relaxed)};
+    _sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _valid.store(true, std::memory_order_relaxed);
+    _stopped.store(stopped, std::memory_order_relaxed);
+    _instruction_count.store(instruction_count, std::memory_order_relaxed);
+    _location.store(location, std::memory_order_relaxed);
+
+    int cell {0};
+    for (const auto& [first, count] : _ranges)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            // Through peek, so breakpoints do not show as trap words.
+            _cells[cell++].store(emulator.peek(first + i),
+                                 std::memory_order_relaxed);
+        }
+    }
+
+    _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+InspectedState StateInspector::read() const
+{
+    InspectedState state;
+    state.ranges.resize(_ranges.size());
+    for (std::size_t i = 0; i < _ranges.size(); i++)
+    {
+        state.ranges[i].resize(_ranges[i].count);
+    }
+
+    unsigned long long sequence;
+    do
+    {
+        do
+        {
+            sequence = _sequence.load(std::memory_order_acquire);
+        } while (sequence & 1);
+
+        state.valid = _valid.load(std::memory_order_relaxed);
+        state.stopped = _stopped.load(std::memory_order_relaxed);
+        state.instruction_count =
+            _instruction_count.load(std::memory_order_relaxed);
+        state.location = _location.load(std::memory_order_relaxed);
+
+        int cell {0};
+        for (auto& range : state.ranges)
+        {
+            for (auto& value : range)
+            {
+                value = _cells[cell++].load(std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (_sequence.load(std::memory_order_relaxed) != sequence);
+
+    return state;
+}
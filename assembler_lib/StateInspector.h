@@ -0,0 +1,91 @@
+/**
+ * @file StateInspector.h
+ * @brief Consistent views of a running emulator from other threads.
+ * @details The emulator publishes the location of the next instruction and
+ * the contents of selected memory ranges at the end of every slice and when
+ * the program stops. Publication is guarded by a sequence lock: the writer
+ * makes the sequence odd, copies the state and makes it even again, and a
+ * reader retries whenever the sequence was odd or changed while it copied.
+ * The emulator therefore never waits for readers, and readers always see
+ * the state of a single point in the run.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class Emulator;
+
+/**
+ * @brief The state of the emulator at one point in the run.
+ */
+struct InspectedState
+{
+    // False until the emulator has published for the first time.
+    bool valid {false};
+
+    // True if the program was halted or stopped at a breakpoint.
+    bool      stopped {false};
+    long long instruction_count {0};
+    int       location {0};
+
+    // The contents of each range, in the order the ranges were added.
+    std::vector<std::vector<long long>> ranges;
+};
+
+/**
+ * @brief Publishes snapshots of a running emulator to reader threads.
+ */
+class StateInspector
+{
+  public:
+    StateInspector() = default;
+
+    StateInspector(const StateInspector&) = delete;
+    StateInspector& operator=(const StateInspector&) = delete;
+
+    /**
+     * @brief Adds a memory range to the snapshots.
+     * @details Ranges must be added before the inspector is given to the
+     * emulator.
+     * @param first The first cell of the range.
+     * @param count The number of cells in the range.
+     * @throws InspectedRangeError
+     */
+    void add_range(int first, int count);
+
+    /**
+     * @brief Publishes a snapshot. Called by the emulator thread only.
+     * @param location The location of the next instruction.
+     * @param instruction_count The number of instructions executed.
+     * @param stopped True if the program has stopped.
+     * @param emulator The emulator, whose memory is read as peek sees it.
+     */
+    void publish(int location, long long instruction_count, bool stopped,
+                 const Emulator& emulator);
+
+    /**
+     * @brief Copies the most recent snapshot. Safe to call from any thread.
+     * @return The snapshot.
+     */
+    [[nodiscard]] InspectedState read() const;
+
+  private:
+    struct Range
+    {
+        int first {0};
+        int count {0};
+    };
+
+    std::vector<Range> _ranges;
+    int                _cell_count {0};
+
+    std::atomic<unsigned long long>           _sequence {0};
+    std::atomic<bool>                         _valid {false};
+    std::atomic<bool>                         _stopped {false};
+    std::atomic<long long>                    _instruction_count {0};
+    std::atomic<int>                          _location {0};
+    std::unique_ptr<std::atomic<long long>[]> _cells;
+};
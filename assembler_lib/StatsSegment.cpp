@@ -0,0 +1,189 @@
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Exceptions.h"
+#include "StatsSegment.h"
+
+namespace
+{
+const char STATS_MAGIC[] {"VCSTATS1"};
+
+/**
+ * @brief Gets the name shm_open expects.
+ * @param segment_name The name of the segment.
+ * @return The name with a leading '/'.
+ */
+std::string get_shm_name(const std::string& segment_name)
+{
+    return segment_name.starts_with('/') ? segment_name : '/' + segment_name;
+}
+
+long long get_monotonic_time_ns()
+{
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<long long>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+} // namespace
+
+StatsPublisher::StatsPublisher(const std::string& segment_name)
+    : _segment_name(get_shm_name(segment_name))
+{
+    shm_unlink(_segment_name.c_str());
+
+    int descriptor {
+        shm_open(_segment_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644)};
+    if (descriptor < 0)
+    {
+        throw StatsSegmentError(_segment_name, "could not be created");
+    }
+
+    void* mapping {MAP_FAILED};
+    if (ftruncate(descriptor, sizeof(StatsLayout)) == 0)
+    {
+        mapping = mmap(nullptr, sizeof(StatsLayout), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, descriptor, 0);
+    }
+    close(descriptor);
+
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(_segment_name.c_str());
+        throw StatsSegmentError(_segment_name, "could not be mapped");
+    }
+
+    // The segment is zero-filled, which is a valid state for every field.
+    _layout = new (mapping) StatsLayout;
+    _layout->pid.store(getpid(), std::memory_order_relaxed);
+    _previous_time_ns = get_monotonic_time_ns();
+
+    // Readers check the magic last, so it marks the segment as ready.
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(_layout->magic, STATS_MAGIC, sizeof(_layout->magic));
+}
+
+StatsPublisher::~StatsPublisher()
+{
+    munmap(_layout, sizeof(StatsLayout));
+    shm_unlink(_segment_name.c_str());
+}
+
+void StatsPublisher::publish(const StatsSnapshot& snapshot)
+{
+    long long now_ns {get_monotonic_time_ns()};
+
+    // A new run starts counting from zero.
+    if (snapshot.instruction_count < _previous_count)
+    {
+        _previous_count = 0;
+    }
+
+    long long elapsed_ns {now_ns - _previous_time_ns};
+    long long rate {
+        _layout->instructions_per_second.load(std::memory_order_relaxed)};
+    if (elapsed_ns > 0)
+    {
+        rate = static_cast<long long>(
+            static_cast<long double>(snapshot.instruction_count -
+                                     _previous_count) *
+            1e9L / static_cast<long double>(elapsed_ns));
+    }
+    _previous_time_ns = now_ns;
+    _previous_count = snapshot.instruction_count;
+
+    std::uint64_t sequence {
+        _layout->sequence.load(std::memory_order_relaxed)};
+    _layout->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _layout->state.store(static_cast<std::int64_t>(snapshot.state),
+                         std::memory_order_relaxed);
+    _layout->update_time_ns.store(now_ns, std::memory_order_relaxed);
+    _layout->instruction_count.store(snapshot.instruction_count,
+                                     std::memory_order_relaxed);
+    _layout->location.store(snapshot.location, std::memory_order_relaxed);
+    _layout->read_count.store(snapshot.read_count, std::memory_order_relaxed);
+    _layout->write_count.store(snapshot.write_count,
+                               std::memory_order_relaxed);
+    _layout->instructions_per_second.store(rate, std::memory_order_relaxed);
+
+    _layout->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+StatsReader::StatsReader(const std::string& segment_name)
+{
+    std::string shm_name {get_shm_name(segment_name)};
+
+    int descriptor {shm_open(shm_name.c_str(), O_RDONLY, 0)};
+    if (descriptor < 0)
+    {
+        throw StatsSegmentError(shm_name, "does not exist");
+    }
+
+    void* mapping {mmap(nullptr, sizeof(StatsLayout), PROT_READ, MAP_SHARED,
+                        descriptor, 0)};
+    close(descriptor);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw StatsSegmentError(shm_name, "could not be mapped");
+    }
+
+    _layout = static_cast<const StatsLayout*>(mapping);
+
+    if (std::memcmp(_layout->magic, STATS_MAGIC, sizeof(_layout->magic)) != 0)
+    {
+        munmap(const_cast<StatsLayout*>(_layout), sizeof(StatsLayout));
+        throw StatsSegmentError(shm_name, "is not an emulator stats segment");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+StatsReader::~StatsReader()
+{
+    munmap(const_cast<StatsLayout*>(_layout), sizeof(StatsLayout));
+}
+
+std::optional<StatsSnapshot> StatsReader::read() const
+{
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++)
+    {
+        std::uint64_t sequence {
+            _layout->sequence.load(std::memory_order_acquire)};
+        if (sequence & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        StatsSnapshot snapshot;
+        snapshot.pid = _layout->pid.load(std::memory_order_relaxed);
+        snapshot.state = static_cast<StatsState>(
+            _layout->state.load(std::memory_order_relaxed));
+        snapshot.update_time_ns =
+            _layout->update_time_ns.load(std::memory_order_relaxed);
+        snapshot.instruction_count =
+            _layout->instruction_count.load(std::memory_order_relaxed);
+        snapshot.location = _layout->location.load(std::memory_order_relaxed);
+        snapshot.read_count =
+            _layout->read_count.load(std::memory_order_relaxed);
+        snapshot.write_count =
+            _layout->write_count.load(std::memory_order_relaxed);
+        snapshot.instructions_per_second =
+            _layout->instructions_per_second.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_layout->sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            return snapshot;
+        }
+    }
+
+    return std::nullopt;
+}
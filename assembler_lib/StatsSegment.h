@@ -0,0 +1,153 @@
+/**
+ * @file StatsSegment.h
+ * @brief Live emulator metrics published through POSIX shared memory.
+ * @details A running emulator publishes its counters into a segment created
+ * with shm_open, so monitors can read them without touching the emulator.
+ * The counters are updated at the end of every slice of Emulator::SLICE_SIZE
+ * instructions and whenever the program stops, never per instruction.
+ *
+ * The segment holds one StatsLayout, native byte order, every field 8 bytes:
+ *
+ * | Offset | Field                   | Meaning                              |
+ * |--------|-------------------------|--------------------------------------|
+ * | 0      | magic                   | "VCSTATS1"                           |
+ * | 8      | sequence                | Odd while an update is in progress   |
+ * | 16     | pid                     | Process id of the emulator           |
+ * | 24     | state                   | StatsState of the program            |
+ * | 32     | update_time_ns          | CLOCK_MONOTONIC time of the update   |
+ * | 40     | instruction_count       | Instructions executed by the run     |
+ * | 48     | location                | Location of the next instruction     |
+ * | 56     | read_count              | READ instructions executed           |
+ * | 64     | write_count             | WRITE instructions executed          |
+ * | 72     | instructions_per_second | Rate over the last slice             |
+ *
+ * Readers copy the fields and retry while the sequence is odd or changed
+ * during the copy. The retries are bounded, since an emulator that dies
+ * during an update leaves the sequence odd for good.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * @brief The state of the program being emulated.
+ */
+enum class StatsState : std::int64_t
+{
+    Running = 0,
+    Breakpoint = 1,
+    Halted = 2,
+    InstructionLimit = 3
+};
+
+/**
+ * @brief A consistent copy of the published counters.
+ */
+struct StatsSnapshot
+{
+    long long  pid {0};
+    StatsState state {StatsState::Running};
+    long long  update_time_ns {0};
+    long long  instruction_count {0};
+    long long  location {0};
+    long long  read_count {0};
+    long long  write_count {0};
+    long long  instructions_per_second {0};
+};
+
+/**
+ * @brief The layout of the shared memory segment.
+ */
+struct StatsLayout
+{
+    char                       magic[8];
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::int64_t>  pid;
+    std::atomic<std::int64_t>  state;
+    std::atomic<std::int64_t>  update_time_ns;
+    std::atomic<std::int64_t>  instruction_count;
+    std::atomic<std::int64_t>  location;
+    std::atomic<std::int64_t>  read_count;
+    std::atomic<std::int64_t>  write_count;
+    std::atomic<std::int64_t>  instructions_per_second;
+};
+
+static_assert(sizeof(StatsLayout) == 80);
+static_assert(std::atomic<std::int64_t>::is_always_lock_free);
+
+/**
+ * @brief Creates a stats segment and publishes counters into it.
+ */
+class StatsPublisher
+{
+  public:
+    /**
+     * @brief Creates the segment, replacing any segment of the same name.
+     * @param segment_name The name of the segment. A leading '/' is added
+     * if it is missing.
+     * @throws StatsSegmentError
+     */
+    explicit StatsPublisher(const std::string& segment_name);
+
+    /**
+     * @brief Unmaps and removes the segment.
+     */
+    ~StatsPublisher();
+
+    StatsPublisher(const StatsPublisher&) = delete;
+    StatsPublisher& operator=(const StatsPublisher&) = delete;
+
+    /**
+     * @brief Publishes new counters.
+     * @details The pid, update time and rate are filled in here.
+     * @param snapshot The counters of the emulator.
+     */
+    void publish(const StatsSnapshot& snapshot);
+
+  private:
+    std::string  _segment_name;
+    StatsLayout* _layout {nullptr};
+
+    long long _previous_time_ns {0};
+    long long _previous_count {0};
+};
+
+/**
+ * @brief Reads the counters of a running emulator.
+ */
+class StatsReader
+{
+  public:
+    /**
+     * @brief Opens an existing segment.
+     * @param segment_name The name of the segment. A leading '/' is added
+     * if it is missing.
+     * @throws StatsSegmentError
+     */
+    explicit StatsReader(const std::string& segment_name);
+
+    /**
+     * @brief Unmaps the segment.
+     */
+    ~StatsReader();
+
+    StatsReader(const StatsReader&) = delete;
+    StatsReader& operator=(const StatsReader&) = delete;
+
+    // Copies attempted by read before it gives up.
+    static constexpr int MAX_READ_ATTEMPTS = 10'000;
+
+    /**
+     * @brief Copies the counters.
+     * @return The counters of the most recent update, or nothing if an
+     * update was still in progress after MAX_READ_ATTEMPTS attempts.
+     */
+    [[nodiscard]] std::optional<StatsSnapshot> read() const;
+
+  private:
+    const StatsLayout* _layout {nullptr};
+};
@@ -3,19 +3,37 @@
 // commenting functions.
 //
 
-#include <fmt/core.h>
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #include "Exceptions.h"
 #include "SymbolTable.h"
 
-void SymbolTable::add_symbol(const std::string& symbol, int location)
+namespace
 {
-    if (_in_table(symbol))
+// Slots the table starts with.
+const std::size_t INITIAL_SLOT_COUNT {1024};
+
+// Characters in a chunk of symbols.
+const std::size_t CHUNK_SIZE {64 * 1024};
+} // namespace
+
+void SymbolTable::add_symbol(std::string_view symbol, int location)
+{
+    // At most half the slots are in use, so probes stay short.
+    if (2 * (_symbol_count + 1) > _slots.size())
     {
-        int previous_location {_symbol_table.at(symbol)};
+        _grow();
+    }
+
+    std::uint32_t hash {_hash(symbol)};
+    Slot&         slot {_slots[_find_slot(symbol, hash)]};
 
-        _symbol_table[symbol] = MULTIPLEY_DEFINED_SYMBOL;
+    if (slot.symbol != nullptr)
+    {
+        int previous_location {slot.location};
+
+        slot.location = MULTIPLEY_DEFINED_SYMBOL;
 
         // If the symbol is defined more than twice, the exception won't specify
         // the location of the second definition because location is set to
@@ -24,46 +42,135 @@ void SymbolTable::add_symbol(const std::string& symbol, int location)
         throw MultiplyDefinedLabelError(symbol, previous_location, location);
     }
 
-    _symbol_table[symbol] = location;
+    slot = {_intern(symbol), static_cast<std::uint32_t>(symbol.size()), hash,
+            location};
+    _symbol_count++;
 }
 
 void SymbolTable::display_symbol_table() const
 {
-    std::cout << fmt::format("{:<10}{:<10}{:<10}\n", // Set format
-                             "Symbol #", "Symbol", "Location");
+    ConsoleListing listing;
+    display_symbol_table(listing);
+}
+
+void SymbolTable::display_symbol_table(ListingSink& listing) const
+{
+    listing.add_symbol_header();
 
     int counter {0};
-    for (const auto& [symbol, location] : _symbol_table)
+    for (const auto& [symbol, location] : get_symbols())
     {
-        std::cout << fmt::format("{:<10}{:<10}{:<10}\n", // Set format
-                                 counter, symbol, location);
+        listing.add_symbol(counter, symbol, location);
         ++counter;
     }
 }
 
-bool SymbolTable::_in_table(const std::string& symbol) const
+std::vector<std::pair<std::string_view, int>> SymbolTable::get_symbols() const
 {
-    auto symbol_pointer {_symbol_table.find(symbol)};
-    return symbol_pointer != _symbol_table.end();
+    std::vector<std::pair<std::string_view, int>> symbols;
+    symbols.reserve(_symbol_count);
+    for (const Slot& slot : _slots)
+    {
+        if (slot.symbol != nullptr)
+        {
+            symbols.emplace_back(slot.get_symbol(), slot.location);
+        }
+    }
+
+    // Only the users of the whole table need the symbols in order.
+    std::ranges::sort(symbols);
+    return symbols;
 }
 
-bool SymbolTable::lookup_symbol(const std::string& symbol, int& location)
+bool SymbolTable::lookup_symbol(std::string_view symbol, int& location) const
 {
-    if (!_in_table(symbol))
+    if (_slots.empty())
+    {
+        return false;
+    }
+
+    const Slot& slot {_slots[_find_slot(symbol, _hash(symbol))]};
+    if (slot.symbol == nullptr)
     {
         return false;
     }
 
-    location = _symbol_table.at(symbol);
+    location = slot.location;
     return true;
 }
 
-int SymbolTable::get_location(const std::string& symbol) const
+int SymbolTable::get_location(std::string_view symbol) const
 {
-    if (!_in_table(symbol))
+    int location {0};
+    if (!lookup_symbol(symbol, location))
     {
         throw UndefinedLabelError(symbol);
     }
 
-    return _symbol_table.at(symbol);
+    return location;
+}
+
+std::size_t SymbolTable::_find_slot(std::string_view symbol,
+                                    std::uint32_t    hash) const
+{
+    std::size_t mask {_slots.size() - 1};
+
+    // Linear probing: the next slot is usually in the same cache line.
+    for (std::size_t index {hash & mask};; index = (index + 1) & mask)
+    {
+        const Slot& slot {_slots[index]};
+        if (slot.symbol == nullptr ||
+            (slot.hash == hash && slot.get_symbol() == symbol))
+        {
+            return index;
+        }
+    }
+}
+
+void SymbolTable::_grow()
+{
+    std::vector<Slot> slots {std::move(_slots)};
+    _slots.assign(slots.empty() ? INITIAL_SLOT_COUNT : 2 * slots.size(), {});
+
+    for (const Slot& slot : slots)
+    {
+        if (slot.symbol != nullptr)
+        {
+            _slots[_find_slot(slot.get_symbol(), slot.hash)] = slot;
+        }
+    }
+}
+
+std::uint32_t SymbolTable::_hash(std::string_view symbol)
+{
+    // FNV-1a; labels are short, so a simple hash is the fastest.
+    std::uint32_t hash {0x811C9DC5};
+    for (char c : symbol)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x01000193;
+    }
+
+    // Multiplying only carries upwards; fold the high bits into the low
+    // ones the slot index is taken from.
+    return hash ^ (hash >> 16);
+}
+
+const char* SymbolTable::_intern(std::string_view symbol)
+{
+    // A copy is never null, even of an empty symbol, so it marks its slot
+    // as used.
+    if (_chunk_next == nullptr || symbol.size() > _chunk_free)
+    {
+        std::size_t size {std::max(CHUNK_SIZE, symbol.size())};
+        _chunks.push_back(std::make_unique<char[]>(size));
+        _chunk_next = _chunks.back().get();
+        _chunk_free = size;
+    }
+
+    const char* copy {_chunk_next};
+    std::memcpy(_chunk_next, symbol.data(), symbol.size());
+    _chunk_next += symbol.size();
+    _chunk_free -= symbol.size();
+
+    return copy;
 }
@@ -5,13 +5,23 @@
 
 #pragma once
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Listing.h"
 
 /**
  * @brief SymbolTable class.
  * @details This class represents a symbol table. It is used to store the
- * symbols and their locations.
+ * symbols and their locations. Symbols are kept in an open addressing hash
+ * table, so a lookup hashes the symbol once and probes a few adjacent slots.
+ * The characters of the symbols are copied into large chunks rather than
+ * allocated one by one.
  */
 class SymbolTable
 {
@@ -33,35 +43,92 @@ class SymbolTable
      * @param symbol The symbol to add.
      * @param location The location of the symbol.
      */
-    void add_symbol(const std::string& symbol, int location);
+    void add_symbol(std::string_view symbol, int location);
 
     /**
      * @brief Displays the symbol table.
      */
     void display_symbol_table() const;
 
+    /**
+     * @brief Adds the symbol table to a listing, in symbol order.
+     * @param listing The listing.
+     */
+    void display_symbol_table(ListingSink& listing) const;
+
+    /**
+     * @brief Gets the symbols and their locations.
+     * @return The symbols in order, as views into the table.
+     */
+    [[nodiscard]] std::vector<std::pair<std::string_view, int>>
+    get_symbols() const;
+
     /**
      * @brief Checks if a symbol is in the symbol table.
      * @param symbol The symbol to check.
      * @return True if the symbol is in the symbol table, false otherwise.
      */
-    [[nodiscard]] bool lookup_symbol(const std::string& symbol, int& location);
+    [[nodiscard]] bool lookup_symbol(std::string_view symbol,
+                                     int&             location) const;
 
     /**
      * @brief Gets the location of a symbol.
      * @param symbol The symbol to get the location of.
      * @return The location of the symbol.
      */
-    [[nodiscard]] int get_location(const std::string& symbol) const;
+    [[nodiscard]] int get_location(std::string_view symbol) const;
 
   private:
-    // Maps symbols to location
-    std::map<std::string, int, std::less<>> _symbol_table;
+    // A symbol and its location; the slot is empty while the symbol is null.
+    // Kept small, so more slots share a cache line.
+    struct Slot
+    {
+        const char*   symbol {nullptr};
+        std::uint32_t size {0};
+        std::uint32_t hash {0};
+        int           location {0};
+
+        [[nodiscard]] std::string_view get_symbol() const
+        {
+            return {symbol, size};
+        }
+    };
+
+    // Slots of the hash table, a power of two of them.
+    std::vector<Slot> _slots;
+    std::size_t       _symbol_count {0};
+
+    // Chunks holding the characters of the symbols; they never move.
+    std::vector<std::unique_ptr<char[]>> _chunks;
+    char*                                _chunk_next {nullptr};
+    std::size_t                          _chunk_free {0};
 
     /**
-     * @brief Checks if a symbol is in the symbol table.
-     * @param symbol The symbol to check.
-     * @return True if the symbol is in the symbol table, false otherwise.
+     * @brief Finds the slot of a symbol.
+     * @param symbol The symbol.
+     * @param hash The hash of the symbol.
+     * @return The slot holding the symbol, or the empty slot where it would
+     * go.
+     */
+    [[nodiscard]] std::size_t _find_slot(std::string_view symbol,
+                                         std::uint32_t    hash) const;
+
+    /**
+     * @brief Hashes a symbol.
+     * @param symbol The symbol.
+     * @return The hash.
+     */
+    [[nodiscard]] static std::uint32_t _hash(std::string_view symbol);
+
+    /**
+     * @brief Doubles the number of slots.
+     */
+    void _grow();
+
+    /**
+     * @brief Copies a symbol into the chunks.
+     * @param symbol The symbol.
+     * @return The copy.
      */
-    [[nodiscard]] bool _in_table(const std::string& symbol) const;
+    const char* _intern(std::string_view symbol);
 };
@@ -1,27 +1,49 @@
 #include <iostream>
-#include <sstream>
 
 #include "Exceptions.h"
 #include "HelperFunctions.h"
 #include "InstructionDefinitions.h"
+#include "LineScanner.h"
 #include "SymbolicInstruction.h"
 
-SymbolicInstruction::SymbolicInstruction(const std::string& line)
+SymbolicInstruction::SymbolicInstruction(std::string_view line)
     : _original_instruction(line)
 {
     if (is_comment_or_empty(line))
         return;
 
-    std::string processed_line {remove_comments_and_commas(line)};
-
-    std::istringstream iss {processed_line};
-
-    std::string extra; // Used to check if there is anything after instruction
+    // The fields are found in one pass over the line, then handed out in
+    // order; missing fields are empty.
+    LineFields fields {scan_line(line)};
+    int        next_field {0};
+    auto       take_field {[&]
+                     {
+                         return next_field < fields.token_count
+                                    ? fields.tokens[next_field++]
+                                    : std::string_view {};
+                     }};
+
+    if (fields.has_label)
+        _label = take_field();
+
+    _opcode = take_field();
+    _operand_1 = take_field();
+    _operand_2 = take_field();
+
+    // The checks below and the users of the instruction work on what the
+    // opcode resolves to, not on its text.
+    if (auto numeric_opcode {find_numeric_opcode(_opcode)})
+    {
+        _numeric_opcode = *numeric_opcode;
+        _valid_opcode = true;
+    }
 
-    if (line_contains_label(processed_line))
-        iss >> _label;
+    // Only block instructions have a third operand.
+    if (_valid_opcode && is_block_opcode(_numeric_opcode))
+        _operand_3 = take_field();
 
-    iss >> _opcode >> _operand_1 >> _operand_2 >> extra;
+    // Used to check if there is anything after instruction
+    std::string_view extra {take_field()};
 
     _check_label();
     _check_operand_count();
@@ -30,7 +52,7 @@ SymbolicInstruction::SymbolicInstruction(const std::string& line)
     _check_constant_size();
 }
 
-void SymbolicInstruction::_check_extra_elements(const std::string& extra) const
+void SymbolicInstruction::_check_extra_elements(std::string_view extra) const
 {
     if (!extra.empty())
     {
@@ -44,7 +66,12 @@ void SymbolicInstruction::_check_extra_elements(const std::string& extra) const
  */
 void SymbolicInstruction::_check_operand_count() const
 {
-    int operand_count {get_instruction_operand_count(get_opcode())};
+    if (!_valid_opcode)
+    {
+        throw InvalidOpcodeError {get_opcode()};
+    }
+
+    int operand_count {get_operand_count(_numeric_opcode)};
 
     if (operand_count == 0 && !_operand_1.empty())
     {
@@ -75,6 +102,18 @@ void SymbolicInstruction::_check_operand_count() const
             throw UnmatchedOperandCountError(_original_instruction, 2, 0);
         }
     }
+
+    if (operand_count == 3 && _operand_3.empty())
+    {
+        if (_operand_1.empty())
+            throw UnmatchedOperandCountError(_original_instruction, 3, 0);
+        else if (_operand_2.empty())
+            throw UnmatchedOperandCountError(_original_instruction, 3, 1);
+        else
+        {
+            throw UnmatchedOperandCountError(_original_instruction, 3, 2);
+        }
+    }
 }
 
 bool SymbolicInstruction::contains_label() const { return !_label.empty(); }
@@ -86,17 +125,19 @@ InstructionType SymbolicInstruction::get_type() const
     if (is_comment_or_empty(_original_instruction))
         return Comment;
 
-    try
-    {
-        std::string opcode {get_opcode()};
-        return SymbolicOpcode_Type.at(opcode);
-    }
-    catch (const std::out_of_range&)
+    if (!_valid_opcode)
     {
         std::cerr << "Error: Invalid instruction: " << _original_instruction
                   << '\n';
         exit(1);
     }
+
+    return get_instruction_type(_numeric_opcode);
+}
+
+NumericOpcode SymbolicInstruction::get_numeric_opcode() const
+{
+    return _numeric_opcode;
 }
 
 std::string SymbolicInstruction::get_opcode() const
@@ -104,13 +145,24 @@ std::string SymbolicInstruction::get_opcode() const
     return get_upper_case(_opcode);
 }
 
-std::string SymbolicInstruction::get_operand_1() const { return _operand_1; }
+std::string_view SymbolicInstruction::get_operand_1() const
+{
+    return _operand_1;
+}
+
+std::string_view SymbolicInstruction::get_operand_2() const
+{
+    return _operand_2;
+}
 
-std::string SymbolicInstruction::get_operand_2() const { return _operand_2; }
+std::string_view SymbolicInstruction::get_operand_3() const
+{
+    return _operand_3;
+}
 
-std::string SymbolicInstruction::get_label() const { return _label; }
+std::string_view SymbolicInstruction::get_label() const { return _label; }
 
-std::string SymbolicInstruction::get_original_instruction() const
+std::string_view SymbolicInstruction::get_original_instruction() const
 {
     return _original_instruction;
 }
@@ -119,9 +171,8 @@ void SymbolicInstruction::_check_operand_type() const
 {
     using enum OperandType;
 
-    std::string opcode {get_opcode()};
-    int         operand_count {get_instruction_operand_count(opcode)};
-    OperandType expected_type {SymbolicOpcode_OperandType.at(opcode)};
+    int         operand_count {get_operand_count(_numeric_opcode)};
+    OperandType expected_type {get_expected_operand_type(_numeric_opcode)};
     OperandType actual_type_1 {get_operand_type(_operand_1)};
     OperandType actual_type_2 {get_operand_type(_operand_2)};
 
@@ -130,28 +181,42 @@ void SymbolicInstruction::_check_operand_type() const
     case 0:
         break;
     case 1:
-        if (SymbolicOpcode_OperandType.at(opcode) !=
-            get_operand_type(_operand_1))
+        if (expected_type != actual_type_1)
         {
             throw InvalidOperandTypeError(_operand_1, expected_type,
                                           actual_type_1);
         }
         break;
     case 2:
-        if (SymbolicOpcode_OperandType.at(opcode) !=
-            get_operand_type(_operand_1))
+        if (expected_type != actual_type_1)
         {
             throw InvalidOperandTypeError(_operand_1, expected_type,
                                           actual_type_1);
         }
 
-        if (SymbolicOpcode_OperandType.at(opcode) !=
-            get_operand_type(_operand_2))
+        if (expected_type != actual_type_2)
         {
             throw InvalidOperandTypeError(_operand_2, expected_type,
                                           actual_type_2);
         }
         break;
+    case 3:
+        for (const std::string_view* operand : {&_operand_1, &_operand_2})
+        {
+            if (get_operand_type(*operand) != expected_type)
+            {
+                throw InvalidOperandTypeError(*operand, expected_type,
+                                              get_operand_type(*operand));
+            }
+        }
+
+        // The block length is a number, not the label of a cell.
+        if (get_operand_type(_operand_3) != Numeric)
+        {
+            throw InvalidOperandTypeError(_operand_3, Numeric,
+                                          get_operand_type(_operand_3));
+        }
+        break;
     default:
         break;
     }
@@ -159,17 +224,28 @@ void SymbolicInstruction::_check_operand_type() const
 
 void SymbolicInstruction::_check_constant_size() const
 {
-    std::string opcode {get_upper_case(_opcode)};
+    if (_numeric_opcode == NumericOpcode::DC)
+    {
+        int constant {parse_number(_operand_1)};
+        if (constant > 99'999 || constant < 0)
+        {
+            throw InvalidConstantSizeError(_original_instruction, constant);
+        }
+    }
 
-    if (opcode == "DC" && (stoi(_operand_1) > 99'999 || stoi(_operand_1) < 0))
+    if (!_operand_3.empty())
     {
-        throw InvalidConstantSizeError(_original_instruction, stoi(_operand_1));
+        int block_length {parse_number(_operand_3)};
+        if (block_length > 99'999 || block_length < 0)
+        {
+            throw InvalidConstantSizeError(_original_instruction,
+                                           block_length);
+        }
     }
 }
 
 void SymbolicInstruction::_check_label() const
 {
-    std::string label = get_upper_case(_label);
-    if (SymbolicOpcode_Type.contains(label))
+    if (find_numeric_opcode(_label))
         throw SymbolicOpcodeInLabelError(_label);
 }
@@ -9,6 +9,7 @@
 
 #include <map>
 #include <string>
+#include <string_view>
 
 #include "InstructionDefinitions.h"
 
@@ -16,13 +17,16 @@
  * @brief SymbolicInstruction class.
  * @details This class represents a symbolic instruction. It is used to
  * represent the symbolic instructions that are read from the source file.
+ * The instruction and its parts are views into the line it was constructed
+ * from, which must outlive it.
  */
 class SymbolicInstruction
 {
   public:
     /**
      * @brief Constructs a symbolic instruction object.
-     * @param line The line to construct the symbolic instruction from.
+     * @param line The line to construct the symbolic instruction from; it
+     * is not copied.
      * @throws InvalidOpcodeError
      * @throws MultiplyDefinedLabelError
      * @throws UnmatchedOperandCountError
@@ -34,7 +38,11 @@ class SymbolicInstruction
      * @throws InvalidConstantSizeError
      * @throws SymbolicOpcodeInLabelError
      */
-    explicit SymbolicInstruction(const std::string& line);
+    explicit SymbolicInstruction(std::string_view line);
+
+    // The views would outlive a temporary line.
+    explicit SymbolicInstruction(std::string&&) = delete;
+    explicit SymbolicInstruction(const std::string&&) = delete;
 
     /**
      * @brief Default destructor.
@@ -59,37 +67,56 @@ class SymbolicInstruction
      */
     [[nodiscard]] std::string get_opcode() const;
 
+    /**
+     * @brief Gets the numeric opcode the opcode resolved to when the
+     * instruction was constructed.
+     * @return The numeric opcode; meaningless for comments.
+     */
+    [[nodiscard]] NumericOpcode get_numeric_opcode() const;
+
     /**
      * @brief Gets the first operand of the instruction.
      * @return The first operand of the instruction.
      */
-    [[nodiscard]] std::string get_operand_1() const;
+    [[nodiscard]] std::string_view get_operand_1() const;
 
     /**
      * @brief Gets the second operand of the instruction.
      * @return The second operand of the instruction.
      */
-    [[nodiscard]] std::string get_operand_2() const;
+    [[nodiscard]] std::string_view get_operand_2() const;
+
+    /**
+     * @brief Gets the third operand of the instruction.
+     * @return The third operand of the instruction; only block instructions
+     * have one.
+     */
+    [[nodiscard]] std::string_view get_operand_3() const;
 
     /**
      * @brief Gets the label of the instruction.
      * @return The label of the instruction.
      */
-    [[nodiscard]] std::string get_label() const;
+    [[nodiscard]] std::string_view get_label() const;
 
     /**
      * @brief Gets the original instruction.
      * @return The original instruction.
      */
-    [[nodiscard]] std::string get_original_instruction() const;
+    [[nodiscard]] std::string_view get_original_instruction() const;
 
   private:
-    std::string _original_instruction;
+    std::string_view _original_instruction;
+
+    std::string_view _label;
+    std::string_view _opcode;
+    std::string_view _operand_1;
+    std::string_view _operand_2;
+    std::string_view _operand_3;
 
-    std::string _label;
-    std::string _opcode;
-    std::string _operand_1;
-    std::string _operand_2;
+    // What the opcode resolves to, looked up once.
+    NumericOpcode _numeric_opcode {NumericOpcode::END};
+    bool          _valid_opcode {false};
 
     /**
      * @brief Checks if the operand count matches the operand count for
@@ -111,11 +138,12 @@ class SymbolicInstruction
      * @param extra The extra elements in the instruction.
      * @throws ExtraStatementElementsError
      */
-    void _check_extra_elements(const std::string& extra) const;
+    void _check_extra_elements(std::string_view extra) const;
 
     /**
-     * @brief Checks if the current instruction is "DC." Then, checks if the
-     * constant size is valid. If not, throws InvalidConstantSizeError.
+     * @brief Checks if the current instruction is "DC" or a block
+     * instruction. Then, checks if the constant or block length is valid. If
+     * not, throws InvalidConstantSizeError.
      * @throws InvalidConstantSizeError
      */
     void _check_constant_size() const;
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <optional>
+
+#include "Exceptions.h"
+#include "TimeTravel.h"
+
+namespace
+{
+/**
+ * @brief Gets the number of cells in a page.
+ * @param page The index of the page.
+ * @return DIRTY_PAGE_SIZE, or less for the last page.
+ */
+int get_page_size(int page)
+{
+    return std::min(Emulator::DIRTY_PAGE_SIZE,
+                    Emulator::MEMORY_SIZE - page * Emulator::DIRTY_PAGE_SIZE);
+}
+} // namespace
+
+long long TimeTravelDebugger::LoggedInput::read_value(
+    long long instruction_count)
+{
+    if (!_values.empty() && instruction_count <= _values.back().first)
+    {
+        auto logged {std::ranges::lower_bound(
+            _values, instruction_count, {},
+            &std::pair<long long, long long>::first)};
+        return logged->second;
+    }
+
+    long long value {_source.read_value(instruction_count)};
+    _values.emplace_back(instruction_count, value);
+    return value;
+}
+
+void TimeTravelDebugger::ReplayedOutput::write_value(long long value)
+{
+    if (!_replaying)
+    {
+        _sink.write_value(value);
+    }
+}
+
+TimeTravelDebugger::TimeTravelDebugger(Emulator& emulator, InputSource& input,
+                                       OutputSink&       output,
+                                       TimeTravelOptions options)
+    : _emulator(emulator), _options(options),
+      _interval(std::max(1LL, options.checkpoint_interval)), _input(input),
+      _output(output), _page_versions(Emulator::DIRTY_PAGE_COUNT)
+{
+    _options.max_checkpoints = std::max(2, _options.max_checkpoints);
+
+    _emulator.reset();
+    _emulator.set_input_source(&_input);
+    _emulator.set_output_sink(&_output);
+
+    _checkpoints.push_back(_emulator.get_position());
+}
+
+TimeTravelDebugger::~TimeTravelDebugger()
+{
+    _emulator.set_input_source(nullptr);
+    _emulator.set_output_sink(nullptr);
+    _emulator.set_instruction_limit(0);
+}
+
+StopReason TimeTravelDebugger::continue_forward()
+{
+    return _advance(std::numeric_limits<long long>::max(), true);
+}
+
+bool TimeTravelDebugger::step()
+{
+    return _advance(_emulator.get_instruction_count() + 1, false) !=
+           StopReason::Halt;
+}
+
+bool TimeTravelDebugger::step_back()
+{
+    long long instruction_count {_emulator.get_instruction_count()};
+    if (instruction_count == 0)
+    {
+        return false;
+    }
+
+    go_to(instruction_count - 1);
+    return true;
+}
+
+bool TimeTravelDebugger::reverse_continue()
+{
+    long long end {_emulator.get_instruction_count()};
+    if (end == 0)
+    {
+        return false;
+    }
+
+    // Replays the interval before the current point, then the one before
+    // that, until one holds a breakpoint stop.
+    for (std::size_t index {_find_checkpoint(end - 1)};; index--)
+    {
+        _restore(index);
+
+        std::optional<long long> last_stop;
+        if (_emulator.has_breakpoint(_emulator.get_location()))
+        {
+            last_stop = _emulator.get_instruction_count();
+        }
+
+        while (_advance(end, true) == StopReason::Breakpoint)
+        {
+            last_stop = _emulator.get_instruction_count();
+        }
+
+        if (last_stop)
+        {
+            go_to(*last_stop);
+            return true;
+        }
+
+        if (index == 0)
+        {
+            break;
+        }
+    }
+
+    _restore(0);
+    return false;
+}
+
+bool TimeTravelDebugger::go_to(long long instruction_count)
+{
+    instruction_count = std::max(0LL, instruction_count);
+
+    if (instruction_count < _emulator.get_instruction_count())
+    {
+        _restore(_find_checkpoint(instruction_count));
+    }
+
+    _advance(instruction_count, false);
+    return _emulator.get_instruction_count() == instruction_count;
+}
+
+StopReason TimeTravelDebugger::_advance(long long target,
+                                        bool      stop_at_breakpoints)
+{
+    while (true)
+    {
+        long long instruction_count {_emulator.get_instruction_count()};
+
+        if (instruction_count >= target)
+        {
+            return StopReason::InstructionLimit;
+        }
+        if (instruction_count == _halt_count)
+        {
+            return StopReason::Halt;
+        }
+
+        // Runs up to the next checkpoint, or up to the frontier when
+        // replaying, so output is suppressed exactly for replayed WRITEs.
+        long long next_checkpoint {_checkpoints.back().instruction_count +
+                                   _interval};
+        bool      replaying {instruction_count < _frontier};
+        long long end {std::min(target,
+                                replaying ? _frontier : next_checkpoint)};
+
+        _output.set_replaying(replaying);
+        _emulator.set_instruction_limit(end - instruction_count);
+
+        StopReason stop_reason;
+        try
+        {
+            stop_reason = _emulator.resume();
+        }
+        catch (const DivisionByZeroError& error)
+        {
+            // The emulator is left mid-chunk, so rebuild the state before
+            // the DIV from the checkpoints.
+            _frontier = std::max(_frontier, error.get_instruction_count());
+            _restore(_find_checkpoint(error.get_instruction_count()));
+            _advance(error.get_instruction_count(), false);
+            throw;
+        }
+
+        instruction_count = _emulator.get_instruction_count();
+        _frontier = std::max(_frontier, instruction_count);
+
+        if (stop_reason == StopReason::Halt)
+        {
+            _halt_count = instruction_count;
+            return StopReason::Halt;
+        }
+
+        if (instruction_count == next_checkpoint)
+        {
+            _take_checkpoint();
+        }
+
+        if (!stop_at_breakpoints)
+        {
+            continue;
+        }
+
+        // A chunk may end just before a breakpoint, where resuming would
+        // step over it.
+        if (stop_reason == StopReason::Breakpoint ||
+            (instruction_count < target &&
+             _emulator.has_breakpoint(_emulator.get_location())))
+        {
+            return StopReason::Breakpoint;
+        }
+    }
+}
+
+void TimeTravelDebugger::_take_checkpoint()
+{
+    RunPosition            position {_emulator.get_position()};
+    std::vector<long long> cells;
+    std::vector<long long> image_cells;
+
+    for (int page = 0; page < Emulator::DIRTY_PAGE_COUNT; page++)
+    {
+        auto& versions {_page_versions[page]};
+        if (versions.empty() && !_emulator.is_page_dirty(page))
+        {
+            continue;
+        }
+
+        cells.resize(get_page_size(page));
+        _emulator.read_page(page, cells.data());
+
+        bool changed;
+        if (versions.empty())
+        {
+            _read_image_page(page, image_cells);
+            changed = cells != image_cells;
+        }
+        else
+        {
+            changed = cells != versions.back().cells;
+        }
+
+        if (changed)
+        {
+            versions.push_back({position.instruction_count, cells});
+        }
+    }
+
+    _checkpoints.push_back(position);
+
+    auto max_checkpoints {static_cast<std::size_t>(_options.max_checkpoints)};
+    if (_checkpoints.size() > max_checkpoints)
+    {
+        _thin_checkpoints();
+    }
+}
+
+void TimeTravelDebugger::_thin_checkpoints()
+{
+    std::vector<RunPosition> kept;
+    for (std::size_t i = 0; i < _checkpoints.size(); i += 2)
+    {
+        kept.push_back(_checkpoints[i]);
+    }
+    _checkpoints = std::move(kept);
+    _interval *= 2;
+
+    // A version is needed while some checkpoint falls between it and the
+    // next version of the page.
+    for (auto& versions : _page_versions)
+    {
+        std::vector<PageVersion> needed;
+
+        for (std::size_t i = 0; i < versions.size(); i++)
+        {
+            auto checkpoint {std::ranges::lower_bound(
+                _checkpoints, versions[i].instruction_count, {},
+                &RunPosition::instruction_count)};
+
+            if (i + 1 == versions.size() ||
+                (checkpoint != _checkpoints.end() &&
+                 checkpoint->instruction_count <
+                     versions[i + 1].instruction_count))
+            {
+                needed.push_back(std::move(versions[i]));
+            }
+        }
+
+        versions = std::move(needed);
+    }
+}
+
+void TimeTravelDebugger::_restore(std::size_t index)
+{
+    const RunPosition&     position {_checkpoints[index]};
+    std::vector<long long> image_cells;
+
+    for (int page = 0; page < Emulator::DIRTY_PAGE_COUNT; page++)
+    {
+        const auto& versions {_page_versions[page]};
+        if (versions.empty() && !_emulator.is_page_dirty(page))
+        {
+            continue;
+        }
+
+        auto next_version {std::ranges::upper_bound(
+            versions, position.instruction_count, {},
+            &PageVersion::instruction_count)};
+
+        if (next_version == versions.begin())
+        {
+            _read_image_page(page, image_cells);
+            _emulator.write_page(page, image_cells.data());
+        }
+        else
+        {
+            _emulator.write_page(page, std::prev(next_version)->cells.data());
+        }
+    }
+
+    _emulator.set_position(position);
+}
+
+std::size_t
+TimeTravelDebugger::_find_checkpoint(long long instruction_count) const
+{
+    auto next_checkpoint {std::ranges::upper_bound(
+        _checkpoints, instruction_count, {}, &RunPosition::instruction_count)};
+
+    return static_cast<std::size_t>(next_checkpoint - _checkpoints.begin()) -
+           1;
+}
+
+void TimeTravelDebugger::_read_image_page(int page,
+                                          std::vector<long long>& cells) const
+{
+    const auto& image {_emulator.get_image()};
+    int         first {page * Emulator::DIRTY_PAGE_SIZE};
+    int         count {get_page_size(page)};
+
+    if (image.empty())
+    {
+        cells.assign(count, 0);
+    }
+    else
+    {
+        cells.assign(image.begin() + first, image.begin() + first + count);
+    }
+}
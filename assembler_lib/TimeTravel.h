@@ -0,0 +1,226 @@
+/**
+ * @file TimeTravel.h
+ * @brief Reverse stepping and reverse continuing through a run.
+ * @details The debugger runs the program in chunks and takes a checkpoint
+ * at the end of every checkpoint interval. A checkpoint holds the run
+ * position and a copy of each page that changed since the previous
+ * checkpoint, so memory that a run leaves alone costs nothing. Every value
+ * READ consumes is logged. An earlier state is rebuilt by restoring the
+ * nearest checkpoint before it and running forward, with READ served from
+ * the log and WRITE suppressed, so going back costs at most one interval of
+ * emulation whatever the length of the run.
+ *
+ * When there are more checkpoints than allowed, every other one is dropped
+ * and the interval doubles, so memory stays bounded and going back slows
+ * down only in proportion to the length of the run.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "Emulator.h"
+#include "EmulatorIO.h"
+
+/**
+ * @brief Settings for a time travel debugger.
+ */
+struct TimeTravelOptions
+{
+    // Instructions between two checkpoints, at first.
+    long long checkpoint_interval {1'000'000};
+
+    // Checkpoints kept at most.
+    int max_checkpoints {256};
+};
+
+/**
+ * @brief Runs a program forwards and backwards.
+ * @details Breakpoints are set on the emulator as usual. While the debugger
+ * exists, it owns the emulator's input, output and instruction limit.
+ */
+class TimeTravelDebugger
+{
+  public:
+    /**
+     * @brief Resets the emulator to its saved image, ready to run.
+     * @param emulator The emulator holding the program.
+     * @param input Where READ takes its values from the first time.
+     * @param output Where WRITE sends its values the first time.
+     * @param options The checkpoint settings.
+     */
+    TimeTravelDebugger(Emulator& emulator, InputSource& input,
+                       OutputSink& output, TimeTravelOptions options = {});
+
+    /**
+     * @brief Gives the emulator back its console input and output.
+     */
+    ~TimeTravelDebugger();
+
+    TimeTravelDebugger(const TimeTravelDebugger&) = delete;
+    TimeTravelDebugger& operator=(const TimeTravelDebugger&) = delete;
+
+    /**
+     * @brief Runs until a breakpoint or the end of the program.
+     * @details A breakpoint at the current location is stepped over.
+     * @return Halt or Breakpoint.
+     * @throws DivisionByZeroError, with the run stopped before the DIV.
+     */
+    StopReason continue_forward();
+
+    /**
+     * @brief Executes one instruction.
+     * @return False if the program has halted.
+     * @throws DivisionByZeroError, with the run stopped before the DIV.
+     */
+    bool step();
+
+    /**
+     * @brief Undoes one instruction.
+     * @return False if no instruction has run.
+     */
+    bool step_back();
+
+    /**
+     * @brief Goes back to the most recent breakpoint the run stopped at, or
+     * would have stopped at with the current breakpoints.
+     * @return True if a breakpoint was found, false if the run went back to
+     * its start.
+     */
+    bool reverse_continue();
+
+    /**
+     * @brief Moves the run to the point where some number of instructions
+     * have executed, ignoring breakpoints.
+     * @param instruction_count The number of instructions.
+     * @return False if the program halted first.
+     * @throws DivisionByZeroError, with the run stopped before the DIV.
+     */
+    bool go_to(long long instruction_count);
+
+    /**
+     * @brief Gets the number of checkpoints held.
+     * @return The number of checkpoints, including the start of the run.
+     */
+    [[nodiscard]] std::size_t get_checkpoint_count() const
+    {
+        return _checkpoints.size();
+    }
+
+    /**
+     * @brief Gets the current checkpoint interval.
+     * @return The instructions between two checkpoints.
+     */
+    [[nodiscard]] long long get_checkpoint_interval() const
+    {
+        return _interval;
+    }
+
+  private:
+    /**
+     * @brief Logs the values READ consumes and serves them again when the
+     * same READ runs again.
+     */
+    class LoggedInput : public InputSource
+    {
+      public:
+        explicit LoggedInput(InputSource& source) : _source(source) {}
+
+        long long read_value(long long instruction_count) override;
+
+      private:
+        InputSource& _source;
+
+        // Instruction count of each READ and its value, in run order.
+        std::vector<std::pair<long long, long long>> _values;
+    };
+
+    /**
+     * @brief Passes WRITE on unless instructions are being run again.
+     */
+    class ReplayedOutput : public OutputSink
+    {
+      public:
+        explicit ReplayedOutput(OutputSink& sink) : _sink(sink) {}
+
+        void write_value(long long value) override;
+
+        void set_replaying(bool replaying) { _replaying = replaying; }
+
+      private:
+        OutputSink& _sink;
+        bool        _replaying {false};
+    };
+
+    /**
+     * @brief A page as of a checkpoint.
+     */
+    struct PageVersion
+    {
+        long long              instruction_count {0};
+        std::vector<long long> cells;
+    };
+
+    Emulator&         _emulator;
+    TimeTravelOptions _options;
+    long long         _interval {0};
+
+    LoggedInput    _input;
+    ReplayedOutput _output;
+
+    // In instruction count order; the first is the start of the run.
+    std::vector<RunPosition> _checkpoints;
+
+    // For each page, the checkpoints at which it changed, in order.
+    std::vector<std::vector<PageVersion>> _page_versions;
+
+    // The furthest the run has been; instructions before it are replayed.
+    long long _frontier {0};
+
+    // The instruction count at which the program halts, once known.
+    long long _halt_count {-1};
+
+    /**
+     * @brief Runs until an instruction count, taking checkpoints on the way.
+     * @param target The instruction count to stop at.
+     * @param stop_at_breakpoints False to run through breakpoints.
+     * @return InstructionLimit when the target is reached, otherwise Halt
+     * or Breakpoint.
+     * @throws DivisionByZeroError
+     */
+    StopReason _advance(long long target, bool stop_at_breakpoints);
+
+    /**
+     * @brief Records the current state as a checkpoint.
+     */
+    void _take_checkpoint();
+
+    /**
+     * @brief Drops every other checkpoint and the page versions only they
+     * needed, and doubles the interval.
+     */
+    void _thin_checkpoints();
+
+    /**
+     * @brief Restores the state of a checkpoint.
+     * @param index The index of the checkpoint.
+     */
+    void _restore(std::size_t index);
+
+    /**
+     * @brief Finds the last checkpoint at or before an instruction count.
+     * @param instruction_count The instruction count, at least 0.
+     * @return The index of the checkpoint.
+     */
+    [[nodiscard]] std::size_t
+    _find_checkpoint(long long instruction_count) const;
+
+    /**
+     * @brief Copies a page of the loaded image.
+     * @param page The index of the page.
+     * @param cells Receives the cells of the page.
+     */
+    void _read_image_page(int page, std::vector<long long>& cells) const;
+};
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Exceptions.h"
+#include "TraceFile.h"
+#include "Varint.h"
+
+namespace
+{
+const char TRACE_MAGIC[] {"VCTRACE1"};
+const char INDEX_MAGIC[] {"VCTRIDX1"};
+
+const int MAGIC_SIZE {8};
+const int CHUNK_HEADER_SIZE {8};
+const int INDEX_ENTRY_SIZE {20};
+const int FOOTER_SIZE {24 + MAGIC_SIZE};
+
+// Layout of the tag byte that starts every record.
+const unsigned OPCODE_MASK {0x1F};
+const unsigned OPCODE_ESCAPE {0x1F};
+const unsigned OPERAND_1_PRESENT {0x20};
+const unsigned OPERAND_2_PRESENT {0x40};
+const unsigned LOCATION_PRESENT {0x80};
+
+template <typename T>
+void put_fixed(std::vector<unsigned char>& buffer, T value)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T> T get_fixed(const unsigned char* bytes)
+{
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+} // namespace
+
+bool trace_records_value(NumericOpcode opcode)
+{
+    using enum NumericOpcode;
+
+    switch (opcode)
+    {
+    case ADD:
+    case SUB:
+    case MULT:
+    case DIV:
+    case COPY:
+    case READ:
+    case WRITE:
+    case BCOPY:
+    case BADD:
+    case BFILL:
+    case BSUM:
+        return true;
+    default:
+        return false;
+    }
+}
+
+TraceWriter::TraceWriter(const std::string& trace_file_path, int chunk_size)
+    : _trace_file_path(trace_file_path),
+      _trace_file(trace_file_path, std::ios::out | std::ios::binary),
+      _chunk_size(std::max(chunk_size, 1))
+{
+    if (!_trace_file.is_open())
+    {
+        throw TraceFileError(_trace_file_path, "could not be created");
+    }
+
+    _trace_file.write(TRACE_MAGIC, MAGIC_SIZE);
+    _offset = MAGIC_SIZE;
+}
+
+TraceWriter::~TraceWriter()
+{
+    if (_closed)
+    {
+        return;
+    }
+
+    try
+    {
+        close();
+    }
+    catch (const TraceFileError&)
+    {
+        // Nothing can be reported from a destructor.
+    }
+}
+
+void TraceWriter::record(const TraceRecord& record)
+{
+    auto     opcode {static_cast<long long>(record.opcode)};
+    unsigned tag {opcode >= 0 && opcode < OPCODE_ESCAPE
+                      ? static_cast<unsigned>(opcode)
+                      : OPCODE_ESCAPE};
+
+    if (record.operand1 != 0)
+        tag |= OPERAND_1_PRESENT;
+    if (record.operand2 != 0)
+        tag |= OPERAND_2_PRESENT;
+    if (record.location != _previous_location + 1)
+        tag |= LOCATION_PRESENT;
+
+    _chunk.push_back(static_cast<unsigned char>(tag));
+
+    if ((tag & OPCODE_MASK) == OPCODE_ESCAPE)
+        put_varint(_chunk, zigzag_encode(opcode));
+    if (tag & LOCATION_PRESENT)
+        put_varint(_chunk,
+                   zigzag_encode(record.location - (_previous_location + 1)));
+    if (tag & OPERAND_1_PRESENT)
+        put_varint(_chunk, zigzag_encode(record.operand1 - record.location));
+    if (tag & OPERAND_2_PRESENT)
+        put_varint(_chunk, zigzag_encode(record.operand2 - record.location));
+    if (trace_records_value(record.opcode))
+        put_varint(_chunk, zigzag_encode(record.value));
+
+    _previous_location = record.location;
+
+    if (++_chunk_records == _chunk_size)
+    {
+        _flush_chunk();
+    }
+}
+
+void TraceWriter::_flush_chunk()
+{
+    if (_chunk_records == 0)
+    {
+        return;
+    }
+
+    std::vector<unsigned char> header;
+    put_fixed<std::uint32_t>(header, _chunk_records);
+    put_fixed<std::uint32_t>(header, static_cast<std::uint32_t>(_chunk.size()));
+
+    _trace_file.write(reinterpret_cast<const char*>(header.data()),
+                      static_cast<std::streamsize>(header.size()));
+    _trace_file.write(reinterpret_cast<const char*>(_chunk.data()),
+                      static_cast<std::streamsize>(_chunk.size()));
+
+    _index.push_back({_record_count, _offset,
+                      static_cast<std::uint32_t>(_chunk_records)});
+
+    _offset += CHUNK_HEADER_SIZE + static_cast<long long>(_chunk.size());
+    _record_count += _chunk_records;
+
+    _chunk.clear();
+    _chunk_records = 0;
+    _previous_location = -1;
+}
+
+void TraceWriter::close()
+{
+    if (_closed)
+    {
+        return;
+    }
+    _closed = true;
+
+    _flush_chunk();
+
+    std::vector<unsigned char> tail;
+    for (const auto& [first_index, offset, record_count] : _index)
+    {
+        put_fixed<long long>(tail, first_index);
+        put_fixed<long long>(tail, offset);
+        put_fixed<std::uint32_t>(tail, record_count);
+    }
+
+    put_fixed<long long>(tail, _offset);
+    put_fixed<long long>(tail, static_cast<long long>(_index.size()));
+    put_fixed<long long>(tail, _record_count);
+    tail.insert(tail.end(), INDEX_MAGIC, INDEX_MAGIC + MAGIC_SIZE);
+
+    _trace_file.write(reinterpret_cast<const char*>(tail.data()),
+                      static_cast<std::streamsize>(tail.size()));
+    _trace_file.close();
+
+    if (_trace_file.fail())
+    {
+        throw TraceFileError(_trace_file_path, "could not be written");
+    }
+}
+
+TraceReader::TraceReader(const std::string& trace_file_path)
+    : _trace_file_path(trace_file_path),
+      _trace_file(trace_file_path, std::ios::in | std::ios::binary)
+{
+    if (!_trace_file.is_open())
+    {
+        throw TraceFileError(_trace_file_path, "could not be opened");
+    }
+
+    char magic[MAGIC_SIZE];
+    _trace_file.read(magic, MAGIC_SIZE);
+    if (!_trace_file || std::memcmp(magic, TRACE_MAGIC, MAGIC_SIZE) != 0)
+    {
+        throw TraceFileError(_trace_file_path, "is not a trace file");
+    }
+
+    unsigned char footer[FOOTER_SIZE];
+    _trace_file.seekg(-FOOTER_SIZE, std::ios::end);
+    _trace_file.read(reinterpret_cast<char*>(footer), FOOTER_SIZE);
+    if (!_trace_file ||
+        std::memcmp(footer + 24, INDEX_MAGIC, MAGIC_SIZE) != 0)
+    {
+        throw TraceFileError(_trace_file_path, "has no index");
+    }
+
+    auto index_offset {get_fixed<long long>(footer)};
+    auto chunk_count {get_fixed<long long>(footer + 8)};
+    _record_count = get_fixed<long long>(footer + 16);
+
+    // The index lies between the chunks and the footer. The counts are
+    // checked against the size of the file before the index is allocated,
+    // so they cannot overflow.
+    long long index_end {static_cast<long long>(_trace_file.tellg()) -
+                         FOOTER_SIZE};
+    if (index_offset < MAGIC_SIZE || index_offset > index_end ||
+        chunk_count < 0 ||
+        chunk_count > (index_end - index_offset) / INDEX_ENTRY_SIZE ||
+        index_offset + chunk_count * INDEX_ENTRY_SIZE != index_end ||
+        _record_count < 0)
+    {
+        throw TraceFileError(_trace_file_path, "has a malformed index");
+    }
+
+    std::vector<unsigned char> index(
+        static_cast<std::size_t>(chunk_count) * INDEX_ENTRY_SIZE);
+    _trace_file.seekg(index_offset, std::ios::beg);
+    _trace_file.read(reinterpret_cast<char*>(index.data()),
+                     static_cast<std::streamsize>(index.size()));
+    if (!_trace_file)
+    {
+        throw TraceFileError(_trace_file_path, "has a truncated index");
+    }
+
+    for (std::size_t i = 0; i < static_cast<std::size_t>(chunk_count); i++)
+    {
+        const unsigned char* entry {index.data() + i * INDEX_ENTRY_SIZE};
+        _index.push_back({get_fixed<long long>(entry),
+                          get_fixed<long long>(entry + 8),
+                          get_fixed<std::uint32_t>(entry + 16)});
+    }
+}
+
+void TraceReader::seek(long long index)
+{
+    _next_chunk = 0;
+    _remaining_in_chunk = 0;
+    _next_index = 0;
+
+    if (index <= 0 || _index.empty())
+    {
+        return;
+    }
+
+    if (index >= _record_count)
+    {
+        _next_chunk = _index.size();
+        _next_index = _record_count;
+        return;
+    }
+
+    // The last chunk that starts at or before the requested instruction.
+    auto chunk {std::ranges::upper_bound(_index, index, {},
+                                         &TraceChunk::first_index)};
+    --chunk;
+
+    _load_chunk(static_cast<std::size_t>(chunk - _index.begin()));
+
+    TraceRecord skipped;
+    while (_next_index < index)
+    {
+        next(skipped);
+    }
+}
+
+void TraceReader::_load_chunk(std::size_t chunk_number)
+{
+    const TraceChunk& chunk {_index[chunk_number]};
+
+    unsigned char header[CHUNK_HEADER_SIZE];
+    _trace_file.clear();
+    _trace_file.seekg(chunk.offset, std::ios::beg);
+    _trace_file.read(reinterpret_cast<char*>(header), CHUNK_HEADER_SIZE);
+
+    _chunk.resize(get_fixed<std::uint32_t>(header + 4));
+    _trace_file.read(reinterpret_cast<char*>(_chunk.data()),
+                     static_cast<std::streamsize>(_chunk.size()));
+    if (!_trace_file)
+    {
+        throw TraceFileError(_trace_file_path, "has a truncated chunk");
+    }
+
+    _position = 0;
+    _next_chunk = chunk_number + 1;
+    _remaining_in_chunk = chunk.record_count;
+    _next_index = chunk.first_index;
+    _previous_location = -1;
+}
+
+bool TraceReader::next(TraceRecord& record)
+{
+    if (_remaining_in_chunk == 0)
+    {
+        if (_next_chunk >= _index.size())
+        {
+            return false;
+        }
+        _load_chunk(_next_chunk);
+    }
+
+    auto get_varint {[this]()
+                     {
+                         std::uint64_t value;
+                         if (!::get_varint(_chunk, _position, value))
+                         {
+                             throw TraceFileError(_trace_file_path,
+                                                  "has a corrupt record");
+                         }
+                         return value;
+                     }};
+
+    if (_position >= _chunk.size())
+    {
+        throw TraceFileError(_trace_file_path, "has a corrupt record");
+    }
+    unsigned tag {_chunk[_position++]};
+
+    long long opcode {tag & OPCODE_MASK};
+    if (opcode == OPCODE_ESCAPE)
+        opcode = zigzag_decode(get_varint());
+
+    record.index = _next_index;
+    record.opcode = static_cast<NumericOpcode>(opcode);
+    record.location = _previous_location + 1;
+    if (tag & LOCATION_PRESENT)
+        record.location += static_cast<int>(zigzag_decode(get_varint()));
+
+    record.operand1 = 0;
+    if (tag & OPERAND_1_PRESENT)
+        record.operand1 =
+            record.location + static_cast<int>(zigzag_decode(get_varint()));
+
+    record.operand2 = 0;
+    if (tag & OPERAND_2_PRESENT)
+        record.operand2 =
+            record.location + static_cast<int>(zigzag_decode(get_varint()));
+
+    record.value = 0;
+    if (trace_records_value(record.opcode))
+        record.value = zigzag_decode(get_varint());
+
+    _previous_location = record.location;
+    _next_index++;
+    _remaining_in_chunk--;
+
+    return true;
+}
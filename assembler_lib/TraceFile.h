@@ -0,0 +1,188 @@
+/**
+ * @file TraceFile.h
+ * @brief Compact on-disk execution traces.
+ * @details A trace file records every instruction executed by the emulator.
+ * The file starts with the magic "VCTRACE1" and is followed by chunks of
+ * records. Each chunk is a 32-bit record count, a 32-bit payload size and the
+ * payload. Inside a payload each record is a tag byte followed by varints:
+ * the location is stored only when it is not the previous location plus one,
+ * operands are stored as deltas from the location and only when non-zero,
+ * and the value is stored for instructions that produce one. The first
+ * record of a chunk does not depend on the previous chunk, so a chunk can be
+ * decoded on its own. An index of the chunks and a footer ending in
+ * "VCTRIDX1" close the file. All fixed-width fields are little-endian.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "InstructionDefinitions.h"
+
+/**
+ * @brief A single executed instruction.
+ */
+struct TraceRecord
+{
+    // Position of the instruction in the run. Assigned by the reader; the
+    // writer numbers records in the order they are written.
+    long long index {0};
+
+    int           location {0};
+    NumericOpcode opcode {NumericOpcode::DC};
+    int           operand1 {0};
+    int           operand2 {0};
+
+    // The value stored, read or written by the instruction, if any. For
+    // block instructions, the block length.
+    long long value {0};
+};
+
+/**
+ * @brief Location of a chunk in a trace file.
+ */
+struct TraceChunk
+{
+    long long     first_index {0};
+    long long     offset {0};
+    std::uint32_t record_count {0};
+};
+
+/**
+ * @brief Checks if a traced instruction carries a value.
+ * @param opcode The opcode of the instruction.
+ * @return True for instructions that store, read or write a memory cell,
+ * and for block instructions.
+ */
+bool trace_records_value(NumericOpcode opcode);
+
+/**
+ * @brief Receives every instruction the emulator executes.
+ */
+class TraceSink
+{
+  public:
+    virtual ~TraceSink() = default;
+
+    /**
+     * @brief Receives an executed instruction.
+     * @param record The executed instruction.
+     */
+    virtual void record(const TraceRecord& record) = 0;
+};
+
+/**
+ * @brief Writes an execution trace to a file.
+ */
+class TraceWriter : public TraceSink
+{
+  public:
+    const static int DEFAULT_CHUNK_SIZE = 4096;
+
+    /**
+     * @brief Creates the trace file.
+     * @param trace_file_path The path to the trace file.
+     * @param chunk_size The number of records per chunk.
+     * @throws TraceFileError
+     */
+    explicit TraceWriter(const std::string& trace_file_path,
+                         int                chunk_size = DEFAULT_CHUNK_SIZE);
+
+    /**
+     * @brief Closes the trace file if it is still open.
+     */
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /**
+     * @brief Appends a record to the trace.
+     * @param record The executed instruction.
+     */
+    void record(const TraceRecord& record) override;
+
+    /**
+     * @brief Writes the last chunk, the index and the footer.
+     * @throws TraceFileError
+     */
+    void close();
+
+  private:
+    std::string   _trace_file_path;
+    std::ofstream _trace_file;
+
+    std::vector<unsigned char> _chunk;
+    std::vector<TraceChunk>    _index;
+
+    int       _chunk_size {DEFAULT_CHUNK_SIZE};
+    int       _chunk_records {0};
+    long long _record_count {0};
+    long long _offset {0};
+    int       _previous_location {-1};
+    bool      _closed {false};
+
+    /**
+     * @brief Writes the buffered chunk to the file and starts a new one.
+     */
+    void _flush_chunk();
+};
+
+/**
+ * @brief Reads an execution trace from a file.
+ */
+class TraceReader
+{
+  public:
+    /**
+     * @brief Opens the trace file and loads its chunk index.
+     * @param trace_file_path The path to the trace file.
+     * @throws TraceFileError
+     */
+    explicit TraceReader(const std::string& trace_file_path);
+
+    /**
+     * @brief Gets the number of records in the trace.
+     * @return The number of executed instructions recorded.
+     */
+    [[nodiscard]] long long size() const { return _record_count; }
+
+    /**
+     * @brief Positions the reader on a given instruction.
+     * @details Only the chunk that contains the instruction is decoded.
+     * @param index The instruction count to seek to.
+     * @throws TraceFileError
+     */
+    void seek(long long index);
+
+    /**
+     * @brief Reads the next record.
+     * @param record Receives the record.
+     * @return False when the end of the trace has been reached.
+     * @throws TraceFileError
+     */
+    bool next(TraceRecord& record);
+
+  private:
+    std::string   _trace_file_path;
+    std::ifstream _trace_file;
+
+    std::vector<TraceChunk> _index;
+    long long               _record_count {0};
+
+    std::vector<unsigned char> _chunk;
+    std::size_t                _position {0};
+    std::size_t                _next_chunk {0};
+    std::uint32_t              _remaining_in_chunk {0};
+    long long                  _next_index {0};
+    int                        _previous_location {-1};
+
+    /**
+     * @brief Reads a chunk into memory.
+     * @param chunk_number The position of the chunk in the index.
+     */
+    void _load_chunk(std::size_t chunk_number);
+};
@@ -0,0 +1,73 @@
+/**
+ * @file Varint.h
+ * @brief Variable-length integer encoding for the binary file formats.
+ * @details Unsigned values are stored 7 bits per byte, least significant
+ * group first, with the high bit set on every byte but the last. Signed
+ * values are zigzag encoded first, so small negative values stay short.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Maps a signed value to an unsigned one with small magnitudes first.
+ * @param value The signed value.
+ * @return The zigzag encoded value.
+ */
+inline std::uint64_t zigzag_encode(long long value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^
+           static_cast<std::uint64_t>(value >> 63);
+}
+
+/**
+ * @brief Reverses zigzag_encode.
+ * @param value The zigzag encoded value.
+ * @return The signed value.
+ */
+inline long long zigzag_decode(std::uint64_t value)
+{
+    return static_cast<long long>(value >> 1) ^
+           -static_cast<long long>(value & 1);
+}
+
+/**
+ * @brief Appends a varint to a byte buffer.
+ * @param buffer A container of bytes.
+ * @param value The value to append.
+ */
+template <typename Buffer> void put_varint(Buffer& buffer, std::uint64_t value)
+{
+    using Byte = typename Buffer::value_type;
+
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<Byte>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<Byte>(value));
+}
+
+/**
+ * @brief Reads a varint from a byte buffer.
+ * @param buffer A container of bytes.
+ * @param position The position of the varint; advanced past it.
+ * @param value Receives the value.
+ * @return False if the buffer ends inside the varint or it is too long.
+ */
+template <typename Buffer>
+bool get_varint(const Buffer& buffer, std::size_t& position,
+                std::uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; position < buffer.size() && shift <= 63; shift += 7)
+    {
+        auto byte {static_cast<unsigned char>(buffer[position++])};
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
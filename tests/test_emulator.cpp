@@ -0,0 +1,2106 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+#include <gtest/gtest.h>
+
+#include "Assembler.h"
+#include "Exceptions.h"
+#include "Fuzzer.h"
+#include "HelperFunctions.h"
+#include "InputLog.h"
+#include "LineScanner.h"
+#include "ObjectFile.h"
+#include "PagePool.h"
+#include "ResultCache.h"
+#include "RunSession.h"
+#include "StateInspector.h"
+#include "StatsSegment.h"
+#include "SymbolTable.h"
+#include "TimeTravel.h"
+#include "TraceFile.h"
+#include "Varint.h"
+
+// Counts down from five, adding the counter to a running total.
+const std::string COUNTDOWN_SOURCE {" org 100\n"
+                                    "loop add total count\n"
+                                    " sub count one\n"
+                                    " bp loop count\n"
+                                    " write total\n"
+                                    " halt\n"
+                                    "count dc 5\n"
+                                    "total dc 0\n"
+                                    "one dc 1\n"
+                                    " end\n"};
+
+TEST(TraceTest, RecordsEveryExecutedInstruction)
+{
+    std::string source_file_path {"trace_countdown.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+
+    std::string trace_file_path {"trace_countdown.trace"};
+    {
+        TraceWriter trace_writer {trace_file_path, 4};
+        assembler.run_program_in_emulator(trace_writer);
+        trace_writer.close();
+    }
+
+    TraceReader reader {trace_file_path};
+    ASSERT_EQ(reader.size(), 17);
+
+    std::vector<TraceRecord> records;
+    TraceRecord              record;
+    while (reader.next(record))
+        records.push_back(record);
+
+    ASSERT_EQ(records.size(), 17u);
+    EXPECT_EQ(records[0].location, 100);
+    EXPECT_EQ(records[0].opcode, NumericOpcode::ADD);
+    EXPECT_EQ(records[0].operand1, 106);
+    EXPECT_EQ(records[0].operand2, 105);
+    EXPECT_EQ(records[0].value, 5);
+    EXPECT_EQ(records[3].location, 100);
+    EXPECT_EQ(records[15].opcode, NumericOpcode::WRITE);
+    EXPECT_EQ(records[15].value, 15);
+    EXPECT_EQ(records[16].opcode, NumericOpcode::HALT);
+
+    for (long long index : {0, 5, 8, 13, 16})
+    {
+        reader.seek(index);
+        ASSERT_TRUE(reader.next(record));
+        EXPECT_EQ(record.index, index);
+        EXPECT_EQ(record.location, records[index].location);
+        EXPECT_EQ(record.value, records[index].value);
+    }
+
+    reader.seek(17);
+    EXPECT_FALSE(reader.next(record));
+}
+
+TEST(TraceTest, RejectsIndexLargerThanFile)
+{
+    std::string source_file_path {"trace_corrupt.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+
+    std::string trace_file_path {"trace_corrupt.trace"};
+    {
+        TraceWriter trace_writer {trace_file_path, 4};
+        assembler.run_program_in_emulator(trace_writer);
+        trace_writer.close();
+    }
+
+    // The chunk count sits 24 bytes before the end of the file.
+    {
+        std::fstream trace_file {trace_file_path, std::ios::in |
+                                                      std::ios::out |
+                                                      std::ios::binary};
+        trace_file.seekp(-24, std::ios::end);
+        long long chunk_count {1LL << 60};
+        trace_file.write(reinterpret_cast<const char*>(&chunk_count),
+                         sizeof(chunk_count));
+    }
+
+    EXPECT_THROW(TraceReader {trace_file_path}, TraceFileError);
+}
+
+// Reads its own first instruction into a data cell.
+const std::string SELF_READING_SOURCE {" org 100\n"
+                                       "loop add total count\n"
+                                       " sub count one\n"
+                                       " bp loop count\n"
+                                       " copy snapshot loop\n"
+                                       " write total\n"
+                                       " halt\n"
+                                       "count dc 5\n"
+                                       "total dc 0\n"
+                                       "one dc 1\n"
+                                       "snapshot dc 0\n"
+                                       " end\n"};
+
+TEST(BreakpointTest, StopsBeforeEachExecutionAndResumes)
+{
+    std::string source_file_path {"breakpoint_self_reading.txt"};
+    create_source_file(SELF_READING_SOURCE, source_file_path);
+
+    Assembler reference {source_file_path};
+    reference.pass_1();
+    reference.pass_2();
+    Emulator& plain {reference.get_emulator()};
+    ASSERT_EQ(plain.run_program(), StopReason::Halt);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+    emulator.add_breakpoint(100);
+
+    std::vector<long long> hits;
+    StopReason             stop_reason {emulator.run_program()};
+    while (stop_reason == StopReason::Breakpoint)
+    {
+        EXPECT_EQ(emulator.get_location(), 100);
+        hits.push_back(emulator.get_instruction_count());
+        stop_reason = emulator.resume();
+    }
+
+    EXPECT_EQ(hits, (std::vector<long long> {0, 3, 6, 9, 12}));
+    EXPECT_EQ(emulator.get_instruction_count(), plain.get_instruction_count());
+
+    // The program copied the patched cell but must see the original.
+    EXPECT_EQ(emulator.peek(109), plain.peek(100));
+    for (int location = 100; location < 110; location++)
+    {
+        EXPECT_EQ(emulator.peek(location), plain.peek(location));
+    }
+}
+
+TEST(BreakpointTest, RemovedBreakpointIsNotHit)
+{
+    std::string source_file_path {"breakpoint_removed.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    emulator.add_breakpoint(103);
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    EXPECT_EQ(emulator.get_instruction_count(), 15);
+
+    emulator.remove_breakpoint(103);
+    emulator.add_breakpoint(101);
+    ASSERT_EQ(emulator.resume(), StopReason::Halt);
+    EXPECT_EQ(emulator.get_instruction_count(), 17);
+    EXPECT_EQ(emulator.peek(106), 15);
+}
+
+TEST(BreakpointTest, SurvivesAnInstructionThatThrows)
+{
+    std::string source_file_path {"breakpoint_division.txt"};
+    create_source_file(" org 100\n div zero zero\n halt\nzero dc 0\n end\n",
+                       source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    emulator.add_breakpoint(100);
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    EXPECT_THROW(emulator.resume(), DivisionByZeroError);
+
+    // The trap word is back, so running again stops at the breakpoint.
+    EXPECT_EQ(emulator.run_program(), StopReason::Breakpoint);
+}
+
+TEST(WatchpointTest, ReportsEveryWriteToWatchedCell)
+{
+    std::string source_file_path {"watchpoint_countdown.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    emulator.add_watchpoint(106);
+    ASSERT_EQ(emulator.run_program(), StopReason::Halt);
+
+    std::vector<WatchpointHit> hits {emulator.take_watchpoint_hits()};
+    ASSERT_EQ(hits.size(), 5u);
+
+    std::vector<long long> totals {0, 5, 9, 12, 14, 15};
+    for (std::size_t i = 0; i < hits.size(); i++)
+    {
+        EXPECT_EQ(hits[i].location, 100);
+        EXPECT_EQ(hits[i].address, 106);
+        EXPECT_EQ(hits[i].old_value, totals[i]);
+        EXPECT_EQ(hits[i].new_value, totals[i + 1]);
+    }
+
+    // The counter shares the page but is not watched.
+    EXPECT_EQ(emulator.peek(105), 0);
+    EXPECT_EQ(emulator.peek(106), 15);
+
+    emulator.remove_watchpoint(106);
+    EXPECT_TRUE(emulator.take_watchpoint_hits().empty());
+}
+
+TEST(ResetTest, RestoresDirtyPagesAndReportsDelta)
+{
+    std::string source_file_path {"reset_countdown.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    EXPECT_TRUE(emulator.get_memory_delta().empty());
+
+    for (int run = 0; run < 3; run++)
+    {
+        ASSERT_EQ(emulator.run_program(), StopReason::Halt);
+        EXPECT_EQ(emulator.get_instruction_count(), 17);
+
+        std::vector<MemoryDelta> delta {emulator.get_memory_delta()};
+        ASSERT_EQ(delta.size(), 2u);
+        EXPECT_EQ(delta[0].address, 105);
+        EXPECT_EQ(delta[0].old_value, 5);
+        EXPECT_EQ(delta[0].new_value, 0);
+        EXPECT_EQ(delta[1].address, 106);
+        EXPECT_EQ(delta[1].old_value, 0);
+        EXPECT_EQ(delta[1].new_value, 15);
+
+        emulator.reset();
+        EXPECT_TRUE(emulator.get_memory_delta().empty());
+        EXPECT_EQ(emulator.peek(105), 5);
+        EXPECT_EQ(emulator.peek(106), 0);
+    }
+
+    // Breakpoints survive a reset.
+    emulator.add_breakpoint(103);
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    emulator.reset();
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    EXPECT_EQ(emulator.get_instruction_count(), 15);
+}
+
+TEST(StatsTest, PublishesCountersWhenProgramStops)
+{
+    std::string source_file_path {"stats_countdown.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    StatsPublisher stats_publisher {"vc1620_stats_test"};
+    StatsReader    reader {"/vc1620_stats_test"};
+    emulator.set_stats_publisher(&stats_publisher);
+
+    emulator.add_breakpoint(103);
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+
+    std::optional<StatsSnapshot> snapshot {reader.read()};
+    ASSERT_TRUE(snapshot.has_value());
+    EXPECT_EQ(snapshot->pid, getpid());
+    EXPECT_EQ(snapshot->state, StatsState::Breakpoint);
+    EXPECT_EQ(snapshot->instruction_count, 15);
+    EXPECT_EQ(snapshot->location, 103);
+    EXPECT_EQ(snapshot->write_count, 0);
+
+    emulator.remove_breakpoint(103);
+    ASSERT_EQ(emulator.resume(), StopReason::Halt);
+
+    snapshot = reader.read();
+    ASSERT_TRUE(snapshot.has_value());
+    EXPECT_EQ(snapshot->state, StatsState::Halted);
+    EXPECT_EQ(snapshot->instruction_count, 17);
+    EXPECT_EQ(snapshot->location, 104);
+    EXPECT_EQ(snapshot->read_count, 0);
+    EXPECT_EQ(snapshot->write_count, 1);
+}
+
+TEST(StatsTest, ReadGivesUpOnAnUnfinishedUpdate)
+{
+    StatsPublisher stats_publisher {"vc1620_stats_stuck"};
+    StatsReader    reader {"vc1620_stats_stuck"};
+    ASSERT_TRUE(reader.read().has_value());
+
+    // A publisher that dies during an update leaves the sequence odd.
+    int descriptor {shm_open("/vc1620_stats_stuck", O_RDWR, 0)};
+    ASSERT_GE(descriptor, 0);
+    void* mapping {mmap(nullptr, sizeof(StatsLayout), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, descriptor, 0)};
+    close(descriptor);
+    ASSERT_NE(mapping, MAP_FAILED);
+
+    static_cast<StatsLayout*>(mapping)->sequence.fetch_add(1);
+    EXPECT_FALSE(reader.read().has_value());
+
+    munmap(mapping, sizeof(StatsLayout));
+}
+
+// Counts up three million times; long enough to be inspected while running.
+const std::string LONG_COUNT_SOURCE {" org 100\n"
+                                     " mult remaining scale\n"
+                                     "loop add counter one\n"
+                                     " sub remaining one\n"
+                                     " bp loop remaining\n"
+                                     " halt\n"
+                                     "counter dc 0\n"
+                                     "remaining dc 3000\n"
+                                     "scale dc 1000\n"
+                                     "one dc 1\n"
+                                     " end\n"};
+
+TEST(InspectorTest, ReadersSeeConsistentStateWhileRunning)
+{
+    std::string source_file_path {"inspector_long_count.txt"};
+    create_source_file(LONG_COUNT_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    StateInspector inspector;
+    inspector.add_range(105, 2);
+    emulator.set_state_inspector(&inspector);
+
+    std::atomic<bool> finished {false};
+    int               inconsistent_reads {0};
+
+    std::thread reader {[&]()
+                        {
+                            while (!finished.load())
+                            {
+                                InspectedState state {inspector.read()};
+                                if (!state.valid || state.stopped ||
+                                    state.instruction_count == 0)
+                                    continue;
+
+                                // After the MULT, the loop runs ADD, SUB
+                                // and BP in turn.
+                                long long count {state.instruction_count};
+                                long long adds {(count + 1) / 3};
+                                long long subs {count / 3};
+
+                                if (state.ranges[0][0] != adds ||
+                                    state.ranges[0][1] != 3'000'000 - subs ||
+                                    state.location != 101 + (count - 1) % 3)
+                                    inconsistent_reads++;
+                            }
+                        }};
+
+    emulator.run_program();
+    finished.store(true);
+    reader.join();
+
+    EXPECT_EQ(inconsistent_reads, 0);
+
+    InspectedState state {inspector.read()};
+    EXPECT_TRUE(state.stopped);
+    EXPECT_EQ(state.instruction_count, 9'000'002);
+    EXPECT_EQ(state.location, 104);
+    EXPECT_EQ(state.ranges[0], (std::vector<long long> {3'000'000, 0}));
+}
+
+TEST(InspectorTest, BreakpointsDoNotShowAsTraps)
+{
+    std::string source_file_path {"inspector_breakpoint.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    StateInspector inspector;
+    inspector.add_range(100, 8);
+    emulator.set_state_inspector(&inspector);
+
+    emulator.add_breakpoint(103);
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+
+    InspectedState state {inspector.read()};
+    EXPECT_TRUE(state.stopped);
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_EQ(state.ranges[0][i], emulator.peek(100 + i));
+    }
+}
+
+TEST(InspectorTest, RejectsRangesOutsideMemory)
+{
+    StateInspector inspector;
+
+    EXPECT_THROW(inspector.add_range(99'990, 100), InspectedRangeError);
+    EXPECT_THROW(inspector.add_range(-1, 2), InspectedRangeError);
+    EXPECT_THROW(inspector.add_range(5, -1), InspectedRangeError);
+    EXPECT_THROW(inspector.add_range(1, Emulator::MEMORY_SIZE),
+                 InspectedRangeError);
+
+    inspector.add_range(Emulator::MEMORY_SIZE - 10, 10);
+    EXPECT_EQ(inspector.read().ranges.size(), 1);
+}
+
+// Reads values until a zero, then writes their sum.
+const std::string SUMMING_SOURCE {" org 100\n"
+                                  "loop read value\n"
+                                  " bz done value\n"
+                                  " add total value\n"
+                                  " b loop\n"
+                                  "done write total\n"
+                                  " halt\n"
+                                  "value ds 1\n"
+                                  "total dc 0\n"
+                                  " end\n"};
+
+/**
+ * @brief Supplies a fixed list of input values.
+ */
+class ScriptedInput : public InputSource
+{
+  public:
+    explicit ScriptedInput(std::deque<long long> values) : _values(values) {}
+
+    long long read_value(long long) override
+    {
+        long long value {_values.front()};
+        _values.pop_front();
+        return value;
+    }
+
+  private:
+    std::deque<long long> _values;
+};
+
+/**
+ * @brief Collects the output values.
+ */
+class CollectedOutput : public OutputSink
+{
+  public:
+    void write_value(long long value) override { values.push_back(value); }
+
+    std::vector<long long> values;
+};
+
+TEST(ReplayTest, ReplayReproducesRecordedRun)
+{
+    std::string source_file_path {"replay_summing.txt"};
+    create_source_file(SUMMING_SOURCE, source_file_path);
+
+    std::string input_log_path {"replay_summing.input"};
+
+    Assembler recorded {source_file_path};
+    recorded.pass_1();
+    recorded.pass_2();
+    Emulator& recorder {recorded.get_emulator()};
+
+    ScriptedInput   scripted_input {{7, -3, 11, 0}};
+    RecordingInput  recording_input {input_log_path, scripted_input};
+    CollectedOutput recorded_output;
+    recorder.set_input_source(&recording_input);
+    recorder.set_output_sink(&recorded_output);
+    ASSERT_EQ(recorder.run_program(), StopReason::Halt);
+    recording_input.close(recorder.get_instruction_count());
+
+    Assembler replayed {source_file_path};
+    replayed.pass_1();
+    replayed.pass_2();
+    Emulator& replayer {replayed.get_emulator()};
+
+    ReplayInput     replay_input {input_log_path};
+    CollectedOutput replayed_output;
+    replayer.set_input_source(&replay_input);
+    replayer.set_output_sink(&replayed_output);
+    ASSERT_EQ(replayer.run_program(), StopReason::Halt);
+    EXPECT_NO_THROW(replay_input.check_finished(
+        replayer.get_instruction_count()));
+
+    EXPECT_EQ(recorded_output.values, (std::vector<long long> {15}));
+    EXPECT_EQ(replayed_output.values, recorded_output.values);
+    EXPECT_EQ(replayer.get_instruction_count(),
+              recorder.get_instruction_count());
+    EXPECT_EQ(replayer.peek(107), recorder.peek(107));
+}
+
+TEST(ReplayTest, ReportsDivergentRun)
+{
+    std::string source_file_path {"replay_divergent.txt"};
+    create_source_file(SUMMING_SOURCE, source_file_path);
+
+    std::string input_log_path {"replay_divergent.input"};
+    {
+        Assembler assembler {source_file_path};
+        assembler.pass_1();
+        assembler.pass_2();
+        Emulator& emulator {assembler.get_emulator()};
+
+        ScriptedInput   scripted_input {{4, 0}};
+        RecordingInput  recording_input {input_log_path, scripted_input};
+        CollectedOutput output;
+        emulator.set_input_source(&recording_input);
+        emulator.set_output_sink(&output);
+        emulator.run_program();
+        recording_input.close(emulator.get_instruction_count());
+    }
+
+    // An extra instruction before the loop moves every READ.
+    create_source_file(" org 100\n b loop\n" + SUMMING_SOURCE.substr(9),
+                       source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    ReplayInput     replay_input {input_log_path};
+    CollectedOutput output;
+    emulator.set_input_source(&replay_input);
+    emulator.set_output_sink(&output);
+    EXPECT_THROW(emulator.run_program(), ReplayDivergenceError);
+}
+
+TEST(DigestTest, TracksMemoryIncrementally)
+{
+    std::string source_file_path {"digest_summing.txt"};
+    create_source_file(SUMMING_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    std::uint64_t loaded_digest {emulator.get_memory_digest()};
+    EXPECT_EQ(loaded_digest, emulator.compute_memory_digest());
+
+    CollectedOutput output;
+    emulator.set_output_sink(&output);
+
+    ScriptedInput first_input {{7, -3, 11, 0}};
+    emulator.set_input_source(&first_input);
+    emulator.run_program();
+    std::uint64_t first_digest {emulator.get_memory_digest()};
+    EXPECT_EQ(first_digest, emulator.compute_memory_digest());
+    EXPECT_NE(first_digest, loaded_digest);
+
+    emulator.reset();
+    EXPECT_EQ(emulator.get_memory_digest(), loaded_digest);
+
+    // Same final memory through different inputs.
+    ScriptedInput second_input {{11, 7, -3, 0}};
+    emulator.set_input_source(&second_input);
+    emulator.run_program();
+    EXPECT_EQ(emulator.get_memory_digest(), first_digest);
+
+    emulator.reset();
+
+    // Breakpoint patches are invisible to the digest.
+    ScriptedInput third_input {{7, -3, 12, 0}};
+    emulator.set_input_source(&third_input);
+    emulator.add_breakpoint(102);
+    StopReason stop_reason {emulator.run_program()};
+    while (stop_reason == StopReason::Breakpoint)
+        stop_reason = emulator.resume();
+    EXPECT_EQ(emulator.get_memory_digest(), emulator.compute_memory_digest());
+    EXPECT_NE(emulator.get_memory_digest(), first_digest);
+}
+
+// Hangs when the input is 7 and divides by zero when it is 3.
+const std::string FRAGILE_SOURCE {" org 100\n"
+                                  " read x\n"
+                                  " copy t x\n"
+                                  " sub t seven\n"
+                                  " bz hang t\n"
+                                  " copy d x\n"
+                                  " sub d three\n"
+                                  " div q d\n"
+                                  " halt\n"
+                                  "hang b hang\n"
+                                  "x ds 1\n"
+                                  "t ds 1\n"
+                                  "d ds 1\n"
+                                  "q dc 12\n"
+                                  "three dc 3\n"
+                                  "seven dc 7\n"
+                                  " end\n"};
+
+// Reads two instructions to execute, then computes a word with opcode 99.
+const std::string COMPUTED_SOURCE {" org 100\n"
+                                   " read code\n"
+                                   "code dc 0\n"
+                                   " read code2\n"
+                                   "code2 dc 0\n"
+                                   " mult word big\n"
+                                   " mult word big\n"
+                                   " mult word hundred\n"
+                                   "word dc 99\n"
+                                   " halt\n"
+                                   "out dc 0\n"
+                                   "flag dc 7\n"
+                                   "one dc 1\n"
+                                   "big dc 10000\n"
+                                   "hundred dc 100\n"
+                                   " end\n"};
+
+TEST(BreakpointTest, ComputedInstructionsSeeThroughPatches)
+{
+    std::string source_file_path {"breakpoint_computed.txt"};
+    create_source_file(COMPUTED_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    // copy out 108, then add flag one.
+    ScriptedInput input {{50'010'900'108, 10'011'000'111}};
+    emulator.set_input_source(&input);
+    emulator.add_breakpoint(108);
+    emulator.add_breakpoint(110);
+
+    // The computed trap at 107 is not a breakpoint and does nothing.
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    EXPECT_EQ(emulator.get_location(), 108);
+    EXPECT_EQ(emulator.peek(107), 990'000'000'000);
+
+    EXPECT_EQ(emulator.peek(109), emulator.peek(108));
+    EXPECT_EQ(emulator.peek(110), 8);
+    EXPECT_EQ(emulator.get_memory_digest(), emulator.compute_memory_digest());
+
+    EXPECT_EQ(emulator.resume(), StopReason::Halt);
+}
+
+TEST(DivisionTest, DivisionByZeroIsReported)
+{
+    std::string source_file_path {"division_fragile.txt"};
+    create_source_file(FRAGILE_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    ScriptedInput input {{3}};
+    emulator.set_input_source(&input);
+
+    try
+    {
+        emulator.run_program();
+        FAIL() << "Expected DivisionByZeroError";
+    }
+    catch (const DivisionByZeroError& error)
+    {
+        EXPECT_EQ(error.get_location(), 106);
+        EXPECT_EQ(error.get_instruction_count(), 6);
+    }
+}
+
+TEST(DivisionTest, InstructionLimitStopsEachCall)
+{
+    std::string source_file_path {"division_hang.txt"};
+    create_source_file(FRAGILE_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    ScriptedInput input {{7}};
+    emulator.set_input_source(&input);
+    emulator.set_instruction_limit(1000);
+
+    ASSERT_EQ(emulator.run_program(), StopReason::InstructionLimit);
+    EXPECT_EQ(emulator.get_instruction_count(), 1000);
+    EXPECT_EQ(emulator.get_location(), 108);
+
+    ASSERT_EQ(emulator.resume(), StopReason::InstructionLimit);
+    EXPECT_EQ(emulator.get_instruction_count(), 2000);
+}
+
+TEST(FuzzerTest, FindsHangAndDivisionByZero)
+{
+    std::string source_file_path {"fuzzer_fragile.txt"};
+    create_source_file(FRAGILE_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+
+    FuzzerOptions options;
+    options.execution_count = 20'000;
+    options.thread_count = 2;
+    options.instruction_limit = 10'000;
+
+    Fuzzer     fuzzer {assembler.get_emulator().get_image(), options};
+    FuzzReport report {fuzzer.run()};
+
+    ASSERT_EQ(report.findings.size(), 2u);
+    EXPECT_EQ(report.findings[0].kind, FuzzFindingKind::DivisionByZero);
+    EXPECT_EQ(report.findings[0].location, 106);
+    ASSERT_FALSE(report.findings[0].input.empty());
+    EXPECT_EQ(report.findings[0].input[0], 3);
+
+    EXPECT_EQ(report.findings[1].kind, FuzzFindingKind::Hang);
+    EXPECT_EQ(report.findings[1].location, 108);
+    ASSERT_FALSE(report.findings[1].input.empty());
+    EXPECT_EQ(report.findings[1].input[0], 7);
+
+    EXPECT_GT(report.covered_edge_count, 0);
+    EXPECT_GE(report.corpus.size(), 2u);
+}
+
+TEST(FuzzerTest, ReportsCrashesAndEachLoopOnce)
+{
+    // Reaches the loop by two paths of different lengths, so runs stop at
+    // different locations in it; an input of 5 fills past the end of memory.
+    std::string source_file_path {"fuzzer_crash.txt"};
+    create_source_file(" org 100\n"
+                       " read x\n"
+                       " bz skip x\n"
+                       " add c one\n"
+                       "skip copy t x\n"
+                       " sub t five\n"
+                       " bz boom t\n"
+                       "loop add c one\n"
+                       " sub c one\n"
+                       " b loop\n"
+                       "boom bfill c one 99999\n"
+                       " halt\n"
+                       "x ds 1\n"
+                       "t ds 1\n"
+                       "c dc 0\n"
+                       "one dc 1\n"
+                       "five dc 5\n"
+                       " end\n",
+                       source_file_path);
+
+    Assembler assembler {source_file_path, true};
+    assembler.pass_1();
+    assembler.pass_2();
+
+    FuzzerOptions options;
+    options.execution_count = 5'000;
+    options.thread_count = 2;
+    options.instruction_limit = 10'000;
+
+    Fuzzer     fuzzer {assembler.get_emulator().get_image(), options};
+    FuzzReport report {fuzzer.run()};
+
+    ASSERT_EQ(report.findings.size(), 2u);
+    EXPECT_EQ(report.findings[0].kind, FuzzFindingKind::Hang);
+
+    EXPECT_EQ(report.findings[1].kind, FuzzFindingKind::Crash);
+    EXPECT_EQ(report.findings[1].location, 109);
+    ASSERT_FALSE(report.findings[1].input.empty());
+    EXPECT_EQ(report.findings[1].input[0], 5);
+    EXPECT_NE(report.findings[1].message.find("past the end of memory"),
+              std::string::npos);
+}
+
+/**
+ * @brief Records a run of a program on scripted input.
+ * @param source_file_path The path to the source of the program.
+ * @param values The input values.
+ * @param input_log_path The path to the input log.
+ */
+void record_input_log(const std::string& source_file_path,
+                      std::deque<long long> values,
+                      const std::string& input_log_path)
+{
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    ScriptedInput   scripted_input {std::move(values)};
+    RecordingInput  recording_input {input_log_path, scripted_input};
+    CollectedOutput output;
+    emulator.set_input_source(&recording_input);
+    emulator.set_output_sink(&output);
+    emulator.run_program();
+    recording_input.close(emulator.get_instruction_count());
+}
+
+TEST(ResultCacheTest, SecondRunIsServedFromCache)
+{
+    std::string source_file_path {"cache_summing.txt"};
+    create_source_file(SUMMING_SOURCE, source_file_path);
+    record_input_log(source_file_path, {7, -3, 11, 0}, "cache_summing.input");
+    record_input_log(source_file_path, {1, 0}, "cache_other.input");
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    std::filesystem::remove_all("cache_summing");
+    ResultCache cache {"cache_summing"};
+
+    ReplayInput  input {"cache_summing.input"};
+    CachedResult emulated {run_cached(emulator, input, cache)};
+    EXPECT_FALSE(emulated.from_cache);
+    EXPECT_EQ(emulated.output, (std::vector<long long> {15}));
+
+    CachedResult cached {run_cached(emulator, input, cache)};
+    EXPECT_TRUE(cached.from_cache);
+    EXPECT_EQ(cached.output, emulated.output);
+    EXPECT_EQ(cached.instruction_count, emulated.instruction_count);
+    EXPECT_EQ(cached.halt_location, emulated.halt_location);
+    EXPECT_EQ(cached.memory_digest, emulated.memory_digest);
+    ASSERT_EQ(cached.memory_delta.size(), emulated.memory_delta.size());
+    for (std::size_t i = 0; i < cached.memory_delta.size(); i++)
+    {
+        EXPECT_EQ(cached.memory_delta[i].address,
+                  emulated.memory_delta[i].address);
+        EXPECT_EQ(cached.memory_delta[i].old_value,
+                  emulated.memory_delta[i].old_value);
+        EXPECT_EQ(cached.memory_delta[i].new_value,
+                  emulated.memory_delta[i].new_value);
+    }
+
+    // Memory is restored as if the program had run.
+    EXPECT_EQ(emulator.peek(107), 15);
+    EXPECT_EQ(emulator.get_memory_digest(), emulated.memory_digest);
+
+    ReplayInput  other_input {"cache_other.input"};
+    CachedResult other {run_cached(emulator, other_input, cache)};
+    EXPECT_FALSE(other.from_cache);
+    EXPECT_EQ(other.output, (std::vector<long long> {1}));
+}
+
+TEST(ResultCacheTest, DivergentRunIsNotStored)
+{
+    std::string source_file_path {"cache_divergent.txt"};
+    create_source_file(SUMMING_SOURCE, source_file_path);
+    record_input_log(source_file_path, {4, 0}, "cache_divergent.input");
+
+    // An extra instruction after the last READ moves only the halt.
+    std::string source {SUMMING_SOURCE};
+    source.replace(source.find(" halt\n"), 6, " b stop\nstop halt\n");
+    create_source_file(source, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    std::filesystem::remove_all("cache_divergent");
+    ResultCache cache {"cache_divergent"};
+
+    ReplayInput input {"cache_divergent.input"};
+    EXPECT_THROW(run_cached(emulator, input, cache), ReplayDivergenceError);
+
+    auto entries {std::filesystem::directory_iterator {"cache_divergent"}};
+    EXPECT_TRUE(std::ranges::none_of(
+        entries, [](const std::filesystem::directory_entry& entry)
+        { return entry.path().extension() == ".vcres"; }));
+}
+
+TEST(ResultCacheTest, EvictsLeastRecentlyUsedEntries)
+{
+    std::filesystem::remove_all("cache_eviction");
+
+    CachedResult result;
+    result.output.assign(100, 12345);
+
+    std::uintmax_t entry_size;
+    {
+        ResultCache probe {"cache_eviction"};
+        probe.store({1, 1}, result);
+        entry_size = std::filesystem::file_size(
+            "cache_eviction/0000000000000001-0000000000000001-"
+            "ffffffffffffffff.vcres");
+        std::filesystem::remove_all("cache_eviction");
+    }
+
+    ResultCache cache {"cache_eviction", 3 * entry_size};
+    auto        now {std::filesystem::file_time_type::clock::now()};
+
+    for (std::uint64_t i = 1; i <= 3; i++)
+    {
+        cache.store({1, i}, result);
+        std::filesystem::last_write_time(
+            fmt::format("cache_eviction/0000000000000001-{:016x}-"
+                        "ffffffffffffffff.vcres",
+                        i),
+            now - std::chrono::hours(4 - i));
+    }
+
+    // Using the oldest entry makes the second one the least recently used.
+    EXPECT_TRUE(cache.find({1, 1}).has_value());
+
+    cache.store({1, 4}, result);
+
+    EXPECT_TRUE(cache.find({1, 1}).has_value());
+    EXPECT_FALSE(cache.find({1, 2}).has_value());
+    EXPECT_TRUE(cache.find({1, 3}).has_value());
+    EXPECT_TRUE(cache.find({1, 4}).has_value());
+}
+
+// Reads and writes on every pass, so going back must replay both.
+const std::string RUNNING_TOTAL_SOURCE {" org 100\n"
+                                        "loop read value\n"
+                                        " add total value\n"
+                                        " write total\n"
+                                        " sub remaining one\n"
+                                        " bp loop remaining\n"
+                                        " halt\n"
+                                        "value ds 1\n"
+                                        "total dc 0\n"
+                                        "remaining dc 2000\n"
+                                        "one dc 1\n"
+                                        " end\n"};
+
+TEST(TimeTravelTest, GoingBackRebuildsEarlierStates)
+{
+    std::string source_file_path {"time_travel_total.txt"};
+    create_source_file(RUNNING_TOTAL_SOURCE, source_file_path);
+
+    std::vector<long long> input;
+    for (int i = 0; i < 2000; i++)
+    {
+        input.push_back(i % 7 - 3);
+    }
+
+    // Records the state after every instruction of a plain run.
+    Assembler reference {source_file_path};
+    reference.pass_1();
+    reference.pass_2();
+    Emulator& expected {reference.get_emulator()};
+
+    SequenceInput    expected_input;
+    CollectingOutput expected_output;
+    expected_input.set_values(input);
+    expected.set_input_source(&expected_input);
+    expected.set_output_sink(&expected_output);
+    expected.set_instruction_limit(1);
+
+    std::vector<std::pair<int, std::uint64_t>> states {
+        {Emulator::START_LOCATION, expected.get_memory_digest()}};
+    StopReason stop_reason {expected.run_program()};
+    states.emplace_back(expected.get_location(), expected.get_memory_digest());
+    while (stop_reason != StopReason::Halt)
+    {
+        stop_reason = expected.resume();
+        states.emplace_back(expected.get_location(),
+                            expected.get_memory_digest());
+    }
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    SequenceInput      sequence_input;
+    CollectingOutput   collecting_output;
+    TimeTravelDebugger debugger {emulator, sequence_input, collecting_output,
+                                {.checkpoint_interval = 100,
+                                 .max_checkpoints = 16}};
+    sequence_input.set_values(input);
+
+    ASSERT_EQ(debugger.continue_forward(), StopReason::Halt);
+    long long halt_count {emulator.get_instruction_count()};
+    ASSERT_EQ(halt_count + 1, static_cast<long long>(states.size()));
+    EXPECT_LE(debugger.get_checkpoint_count(), 16u);
+    EXPECT_GT(debugger.get_checkpoint_interval(), 100);
+
+    auto expect_state {[&](long long instruction_count)
+                       {
+                           ASSERT_EQ(emulator.get_instruction_count(),
+                                     instruction_count);
+                           EXPECT_EQ(emulator.get_location(),
+                                     states[instruction_count].first);
+                           EXPECT_EQ(emulator.get_memory_digest(),
+                                     states[instruction_count].second);
+                           EXPECT_EQ(emulator.get_memory_digest(),
+                                     emulator.compute_memory_digest());
+                       }};
+
+    for (long long target : {halt_count - 1, 5000LL, 1LL, 7777LL, 0LL})
+    {
+        EXPECT_TRUE(debugger.go_to(target));
+        expect_state(target);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_TRUE(debugger.step());
+    }
+    expect_state(3);
+    EXPECT_TRUE(debugger.step_back());
+    expect_state(2);
+
+    // Running again replays the logged input and writes nothing twice.
+    EXPECT_EQ(debugger.continue_forward(), StopReason::Halt);
+    expect_state(halt_count);
+    EXPECT_FALSE(debugger.step());
+    EXPECT_EQ(collecting_output.get_values(), expected_output.get_values());
+}
+
+TEST(TimeTravelTest, ReverseContinueFindsEarlierBreakpointStops)
+{
+    std::string source_file_path {"time_travel_breaks.txt"};
+    create_source_file(RUNNING_TOTAL_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    std::vector<long long> input(2000, 1);
+    SequenceInput          sequence_input;
+    CollectingOutput       collecting_output;
+    TimeTravelDebugger     debugger {emulator, sequence_input,
+                                 collecting_output,
+                                 {.checkpoint_interval = 64,
+                                  .max_checkpoints = 8}};
+    sequence_input.set_values(input);
+
+    EXPECT_FALSE(debugger.reverse_continue());
+
+    ASSERT_EQ(debugger.continue_forward(), StopReason::Halt);
+    long long halt_count {emulator.get_instruction_count()};
+
+    // The WRITE of the last pass is the fourth-to-last instruction.
+    emulator.add_breakpoint(102);
+    ASSERT_TRUE(debugger.reverse_continue());
+    EXPECT_EQ(emulator.get_location(), 102);
+    EXPECT_EQ(emulator.get_instruction_count(), halt_count - 4);
+    EXPECT_EQ(emulator.peek(107), 2000);
+
+    ASSERT_TRUE(debugger.reverse_continue());
+    EXPECT_EQ(emulator.get_instruction_count(), halt_count - 9);
+    EXPECT_EQ(emulator.peek(107), 1999);
+
+    // Continuing steps over the breakpoint it is stopped at.
+    ASSERT_EQ(debugger.continue_forward(), StopReason::Breakpoint);
+    EXPECT_EQ(emulator.get_instruction_count(), halt_count - 4);
+
+    emulator.remove_breakpoint(102);
+    EXPECT_FALSE(debugger.reverse_continue());
+    EXPECT_EQ(emulator.get_instruction_count(), 0);
+    EXPECT_EQ(emulator.peek(107), 0);
+    EXPECT_EQ(collecting_output.get_values().size(), 2000u);
+}
+
+/**
+ * @brief Builds a program that scales its total only after the loop, so
+ * editing the factor leaves most of the run intact.
+ * @param total The initial total, overwritten before it is read.
+ * @param step The amount added on each pass.
+ * @param factor The amount the total is multiplied by at the end.
+ * @return The source of the program.
+ */
+std::string make_scaled_total_source(int total, int step, int factor)
+{
+    return " org 100\n"
+           " copy total zero\n"
+           "loop add total step\n"
+           " sub remaining one\n"
+           " bp loop remaining\n"
+           " mult total factor\n"
+           " write total\n"
+           " halt\n"
+           "total dc " +
+           std::to_string(total) +
+           "\n"
+           "step dc " +
+           std::to_string(step) +
+           "\n"
+           "remaining dc 1000\n"
+           "one dc 1\n"
+           "factor dc " +
+           std::to_string(factor) +
+           "\n"
+           "zero dc 0\n"
+           " end\n";
+}
+
+TEST(RunSessionTest, EditedProgramResumesBeforeFirstAffectedInstruction)
+{
+    std::string session_file_path {"session_scaled.session"};
+
+    // The first run, logged with a checkpoint every 500 instructions.
+    {
+        std::string source_file_path {"session_scaled_1.txt"};
+        create_source_file(make_scaled_total_source(0, 3, 2),
+                           source_file_path);
+        Assembler assembler {source_file_path};
+        assembler.pass_1();
+        assembler.pass_2();
+        Emulator& emulator {assembler.get_emulator()};
+
+        RunSession session;
+        session.image.assign(emulator.get_image().begin(),
+                             emulator.get_image().end());
+        session.checkpoint_interval = 500;
+        add_checkpoint(session, emulator);
+
+        SessionRecorder  session_recorder {session};
+        CollectingOutput collecting_output;
+        emulator.set_trace_sink(&session_recorder);
+        emulator.set_output_sink(&collecting_output);
+        emulator.set_instruction_limit(session.checkpoint_interval);
+
+        StopReason stop_reason {emulator.run_program()};
+        while (stop_reason == StopReason::InstructionLimit)
+        {
+            add_checkpoint(session, emulator);
+            stop_reason = emulator.resume();
+        }
+        save_session(session, session_file_path);
+
+        EXPECT_EQ(collecting_output.get_values(),
+                  (std::vector<long long> {6000}));
+    }
+
+    std::optional<RunSession> previous {load_session(session_file_path)};
+    ASSERT_TRUE(previous.has_value());
+    EXPECT_EQ(previous->checkpoints.size(), 7u);
+    EXPECT_EQ(previous->output, (std::vector<long long> {6000}));
+
+    auto check_edit {[&](int initial_total, int step, int factor,
+                         long long first_affected_count,
+                         long long resume_count)
+                     {
+                         std::string source_file_path {"session_scaled_2.txt"};
+                         create_source_file(
+                             make_scaled_total_source(initial_total, step,
+                                                      factor),
+                             source_file_path);
+                         Assembler assembler {source_file_path};
+                         assembler.pass_1();
+                         assembler.pass_2();
+                         Emulator& emulator {assembler.get_emulator()};
+
+                         CollectingOutput fresh_output;
+                         emulator.set_output_sink(&fresh_output);
+                         ASSERT_EQ(emulator.run_program(), StopReason::Halt);
+                         std::uint64_t fresh_digest {
+                             emulator.get_memory_digest()};
+
+                         ResumePlan plan {
+                             plan_resume(*previous, emulator.get_image())};
+                         EXPECT_EQ(plan.first_affected_count,
+                                   first_affected_count);
+                         const auto& checkpoint {
+                             plan.session.checkpoints.back()};
+                         ASSERT_EQ(checkpoint.position.instruction_count,
+                                   resume_count);
+
+                         CollectingOutput resumed_output;
+                         emulator.set_output_sink(&resumed_output);
+                         restore_checkpoint(emulator, checkpoint);
+                         ASSERT_EQ(emulator.resume(), StopReason::Halt);
+
+                         EXPECT_EQ(emulator.get_memory_digest(),
+                                   fresh_digest);
+                         EXPECT_EQ(resumed_output.get_values(),
+                                   fresh_output.get_values());
+                     }};
+
+    // Only the MULT after the loop sees the new factor; the new initial total
+    // is overwritten before it is read.
+    check_edit(4, 3, 7, 3001, 3000);
+
+    // The first ADD reads the new step.
+    check_edit(0, 5, 2, 1, 0);
+
+    // Nothing changed, so the run resumes from its last checkpoint.
+    check_edit(0, 3, 2, -1, 3000);
+}
+
+TEST(RunSessionTest, RejectsCellDeltaPastMemory)
+{
+    std::string source_file_path {"session_corrupt.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    RunSession session;
+    session.image.assign(emulator.get_image().begin(),
+                         emulator.get_image().end());
+    session.checkpoint_interval = 500;
+    add_checkpoint(session, emulator);
+
+    std::string session_file_path {"session_corrupt.session"};
+    save_session(session, session_file_path);
+    ASSERT_TRUE(load_session(session_file_path).has_value());
+
+    std::string contents;
+    {
+        std::ifstream session_file {session_file_path, std::ios::binary};
+        contents.assign(std::istreambuf_iterator<char>(session_file),
+                        std::istreambuf_iterator<char>());
+    }
+
+    // The first image cell is stored as its distance from address 0. Adding
+    // 2^32 to it would lead back to the same cell if it were truncated.
+    std::size_t   position {8};
+    std::uint64_t value;
+    ASSERT_TRUE(get_varint(contents, position, value)); // Interval
+    ASSERT_TRUE(get_varint(contents, position, value)); // Cell count
+    std::size_t delta_position {position};
+    ASSERT_TRUE(get_varint(contents, position, value));
+
+    std::string delta;
+    put_varint(delta, value + (1ULL << 32));
+    contents.replace(delta_position, position - delta_position, delta);
+    {
+        std::ofstream session_file {session_file_path, std::ios::binary};
+        session_file << contents;
+    }
+
+    EXPECT_FALSE(load_session(session_file_path).has_value());
+}
+
+// Sums, shifts and spreads a small array with block instructions.
+const std::string BLOCK_SOURCE {" org 100\n"
+                                " bsum sum a 6\n"
+                                " badd a2 a 5\n"
+                                " bcopy a a2 5\n"
+                                " bfill spread a 3\n"
+                                " write sum\n"
+                                " halt\n"
+                                "a dc 1\n"
+                                "a2 dc 2\n"
+                                " dc 3\n"
+                                " dc 4\n"
+                                " dc 5\n"
+                                " dc 6\n"
+                                "sum dc 0\n"
+                                "spread ds 3\n"
+                                " end\n"};
+
+TEST(BlockTest, BlockInstructionsRunOverRanges)
+{
+    std::string source_file_path {"block_array.txt"};
+    create_source_file(BLOCK_SOURCE, source_file_path);
+
+    // Block instructions are an extension that programs opt in to.
+    Assembler plain {source_file_path};
+    ASSERT_THROW(plain.pass_1(), InvalidOpcodeError);
+
+    Assembler assembler {source_file_path, true};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& emulator {assembler.get_emulator()};
+
+    // Each block instruction is followed by its block length.
+    EXPECT_EQ(emulator.peek(100), 17'00116'00110);
+    EXPECT_EQ(emulator.peek(101), 6);
+
+    // Overlapping blocks behave as if the source were read first.
+    std::vector<long long> expected {3, 5, 7, 9, 11, 11, 21, 3, 3, 3};
+
+    auto check_memory {[&]
+                       {
+                           for (int i = 0; i < 10; i++)
+                           {
+                               EXPECT_EQ(emulator.peek(110 + i), expected[i])
+                                   << "at " << 110 + i;
+                           }
+                           EXPECT_EQ(emulator.get_memory_digest(),
+                                     emulator.compute_memory_digest());
+                       }};
+
+    CollectingOutput output;
+    emulator.set_output_sink(&output);
+    ASSERT_EQ(emulator.run_program(), StopReason::Halt);
+    EXPECT_EQ(emulator.get_instruction_count(), 6);
+    EXPECT_EQ(output.get_values(), std::vector<long long> {21});
+    check_memory();
+
+    // Blocks see through the trap words of breakpoints inside them.
+    emulator.reset();
+    emulator.add_breakpoint(102);
+    emulator.add_breakpoint(112);
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    EXPECT_EQ(emulator.get_location(), 102);
+    ASSERT_EQ(emulator.resume(), StopReason::Halt);
+    check_memory();
+    emulator.remove_breakpoint(102);
+    emulator.remove_breakpoint(112);
+
+    // Every store to a watched cell is reported.
+    emulator.reset();
+    emulator.add_watchpoint(112);
+    ASSERT_EQ(emulator.run_program(), StopReason::Halt);
+    check_memory();
+
+    std::vector<WatchpointHit> hits {emulator.take_watchpoint_hits()};
+    ASSERT_EQ(hits.size(), 2u);
+    EXPECT_EQ(hits[0].location, 102);
+    EXPECT_EQ(hits[0].old_value, 3);
+    EXPECT_EQ(hits[0].new_value, 5);
+    EXPECT_EQ(hits[1].location, 104);
+    EXPECT_EQ(hits[1].new_value, 7);
+    emulator.remove_watchpoint(112);
+
+    // A block reaching past the end of memory stops the run.
+    emulator.reset();
+    emulator.insert(101, Emulator::MEMORY_SIZE);
+    try
+    {
+        emulator.run_program();
+        FAIL() << "Expected BlockRangeError";
+    }
+    catch (const BlockRangeError& error)
+    {
+        EXPECT_EQ(error.get_location(), 100);
+        EXPECT_EQ(error.get_instruction_count(), 0);
+    }
+}
+
+/**
+ * @brief Gets the resident set size of the process.
+ * @return The number of resident bytes.
+ */
+long long get_resident_bytes()
+{
+    std::ifstream statm {"/proc/self/statm"};
+    long long     size {0};
+    long long     resident {0};
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+TEST(PagePoolTest, EmulatorsShareIdenticalPages)
+{
+    std::string source_file_path {"page_pool_countdown.txt"};
+    create_source_file(COUNTDOWN_SOURCE, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.pass_1();
+    assembler.pass_2();
+    Emulator& reference {assembler.get_emulator()};
+    ASSERT_EQ(reference.run_program(), StopReason::Halt);
+
+    PagePool pool;
+    long long resident_before {get_resident_bytes()};
+
+    const int                              emulator_count {100};
+    std::vector<std::unique_ptr<Emulator>> emulators;
+    for (int i = 0; i < emulator_count; i++)
+    {
+        emulators.push_back(std::make_unique<Emulator>(&pool));
+        emulators.back()->load_image(reference.get_image());
+    }
+
+    // The program fits in one page; the rest of memory is zeros.
+    EXPECT_EQ(pool.get_page_count(), 1);
+
+    for (auto& emulator : emulators)
+    {
+        CollectingOutput output;
+        emulator->set_output_sink(&output);
+        ASSERT_EQ(emulator->run_program(), StopReason::Halt);
+        EXPECT_EQ(output.get_values(), std::vector<long long> {15});
+        EXPECT_EQ(emulator->get_memory_digest(),
+                  reference.get_memory_digest());
+        emulator->set_output_sink(nullptr);
+        emulator->reset();
+    }
+
+    // Each emulator holds well under one private copy of memory.
+    EXPECT_LT(get_resident_bytes() - resident_before,
+              emulator_count * 64 * 1024LL);
+
+    // Resetting drops the private copies, and patches and watchpoints
+    // survive remapping.
+    Emulator& emulator {*emulators.front()};
+    EXPECT_EQ(emulator.peek(105), 5);
+    EXPECT_EQ(emulator.get_memory_digest(), emulator.compute_memory_digest());
+
+    emulator.add_breakpoint(103);
+    emulator.add_watchpoint(106);
+    emulator.load_image(reference.get_image());
+
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    EXPECT_EQ(emulator.get_instruction_count(), 15);
+    ASSERT_EQ(emulator.resume(), StopReason::Halt);
+    EXPECT_EQ(emulator.take_watchpoint_hits().size(), 5u);
+
+    emulator.reset();
+    EXPECT_EQ(emulator.peek(106), 0);
+    EXPECT_EQ(emulator.peek(103), reference.peek(103));
+    ASSERT_EQ(emulator.run_program(), StopReason::Breakpoint);
+    emulator.remove_watchpoint(106);
+}
+
+TEST(SinglePassTest, MatchesTwoPassAssembly)
+{
+    // Forward references, comments, a block instruction and an ORG that
+    // moves back over earlier contents.
+    const std::string FORWARD_SOURCE {"; jumps ahead before anything exists\n"
+                                      " org 100\n"
+                                      " b start\n"
+                                      "\n"
+                                      "start bsum total data 2\n"
+                                      " write total\n"
+                                      " halt\n"
+                                      "data dc 20\n"
+                                      " dc 22\n"
+                                      "total ds 1\n"
+                                      " org 101\n"
+                                      " dc 7\n"
+                                      " end\n"};
+
+    auto check_source {[](const std::string& source)
+                       {
+                           std::string source_file_path {"single_pass.txt"};
+                           create_source_file(source, source_file_path);
+
+                           Assembler two_pass {source_file_path, true};
+                           two_pass.pass_1();
+                           testing::internal::CaptureStdout();
+                           two_pass.pass_2();
+                           std::string expected_listing {
+                               testing::internal::GetCapturedStdout()};
+
+                           Assembler single_pass {source_file_path, true};
+                           single_pass.assemble_single_pass();
+                           testing::internal::CaptureStdout();
+                           single_pass.display_listing();
+                           EXPECT_EQ(testing::internal::GetCapturedStdout(),
+                                     expected_listing);
+
+                           EXPECT_TRUE(std::ranges::equal(
+                               single_pass.get_emulator().get_image(),
+                               two_pass.get_emulator().get_image()));
+                       }};
+
+    check_source(COUNTDOWN_SOURCE);
+    check_source(BLOCK_SOURCE);
+    check_source(FORWARD_SOURCE);
+
+    // Errors surface where the two passes report them.
+    std::string source_file_path {"single_pass_errors.txt"};
+    create_source_file(" b later\n"
+                       " b nowhere\n"
+                       "later halt\n"
+                       " end\n",
+                       source_file_path);
+
+    Assembler undefined {source_file_path};
+    ASSERT_NO_THROW(undefined.assemble_single_pass());
+    testing::internal::CaptureStdout();
+    EXPECT_THROW(undefined.display_listing(), UndefinedLabelError);
+    std::string listing {testing::internal::GetCapturedStdout()};
+    EXPECT_NE(listing.find(" b later"), std::string::npos);
+    EXPECT_EQ(listing.find(" b nowhere"), std::string::npos);
+
+    create_source_file("one dc 1\n"
+                       "one dc 2\n"
+                       " end\n",
+                       source_file_path);
+    Assembler multiply_defined {source_file_path};
+    EXPECT_THROW(multiply_defined.assemble_single_pass(),
+                 MultiplyDefinedLabelError);
+
+    create_source_file(" halt\n", source_file_path);
+    Assembler missing_end {source_file_path};
+    EXPECT_THROW(missing_end.assemble_single_pass(), MissingEndStatementError);
+}
+
+/**
+ * @brief Takes the next token off the front of a line, the simple way.
+ * @details The reference the line scanner is checked against. Tokens are
+ * separated by whitespace and commas.
+ * @param rest The rest of the line; the token is removed from it.
+ * @return The token, or an empty view if the line holds no more tokens.
+ */
+std::string_view next_token(std::string_view& rest)
+{
+    auto is_separator {[](char c)
+                       {
+                           return c == ',' ||
+                                  std::isspace(static_cast<unsigned char>(c));
+                       }};
+
+    auto start {std::ranges::find_if_not(rest, is_separator)};
+    auto end {std::find_if(start, rest.end(), is_separator)};
+
+    std::string_view token {start, end};
+    rest = {end, rest.end()};
+
+    return token;
+}
+
+TEST(FileAccessTest, SplitsLinesLikeGetline)
+{
+    std::string source_file_path {"file_access.txt"};
+
+    auto read_lines {[&](const std::string& source)
+                     {
+                         create_source_file(source, source_file_path);
+                         FileAccess               file {source_file_path};
+                         std::vector<std::string> lines;
+                         while (!file.end_of_file())
+                         {
+                             lines.emplace_back(file.get_next_line());
+                         }
+                         return lines;
+                     }};
+
+    using Lines = std::vector<std::string>;
+    EXPECT_EQ(read_lines(""), Lines {""});
+    EXPECT_EQ(read_lines("a b, c"), Lines {"a b, c"});
+    EXPECT_EQ(read_lines("one\n\ntwo\n"), (Lines {"one", "", "two", ""}));
+
+    // Tokens are views into the line, split at whitespace and commas.
+    std::string_view rest {"loop\tadd  total,count ; comment"};
+    EXPECT_EQ(next_token(rest), "loop");
+    EXPECT_EQ(next_token(rest), "add");
+    EXPECT_EQ(next_token(rest), "total");
+    EXPECT_EQ(next_token(rest), "count");
+    EXPECT_EQ(next_token(rest), ";");
+}
+
+TEST(SymbolicInstructionTest, RefusesTemporaryLines)
+{
+    // The statement keeps views into its line, so the line must outlive it.
+    static_assert(
+        std::is_constructible_v<SymbolicInstruction, const std::string&>);
+    static_assert(
+        !std::is_constructible_v<SymbolicInstruction, std::string&&>);
+    static_assert(
+        !std::is_constructible_v<SymbolicInstruction, const std::string&&>);
+}
+
+TEST(LineScannerTest, MatchesNextToken)
+{
+    // What the scanner must find: the tokens next_token takes off the line
+    // up to its comment, and a label unless the line starts blank.
+    auto check_line {[](std::string_view line)
+                     {
+                         std::string_view rest {line.substr(0, line.find(';'))};
+                         bool has_label {!rest.empty() && rest[0] != ' ' &&
+                                         rest[0] != '\t' && rest[0] != ','};
+
+                         std::vector<std::string_view> tokens;
+                         for (std::string_view token {next_token(rest)};
+                              !token.empty() &&
+                              tokens.size() < LineFields::MAX_TOKENS;
+                              token = next_token(rest))
+                         {
+                             tokens.push_back(token);
+                         }
+
+                         LineFields fields {scan_line(line)};
+                         EXPECT_EQ(fields.has_label, has_label) << line;
+                         EXPECT_TRUE(std::ranges::equal(
+                             std::span {fields.tokens}.first(
+                                 fields.token_count),
+                             tokens))
+                             << line;
+                     }};
+
+    check_line("");
+    check_line("loop\tadd  total,count ; comment");
+    check_line(",,start,, b\tend");
+    check_line("\rlabel copy a b\r");
+    check_line("a_label_longer_than_a_block badd first second 16");
+    check_line("                exactly_at_16th_byte");
+    check_line("x y z w v u t s r q");
+    check_line("0123456789abcdef");
+    check_line("0123456789abcde;");
+
+    // Tokens, separators and comments across block boundaries.
+    std::mt19937                    random {1620};
+    const std::string               characters {"ab1 \t,;\r\v\x85"};
+    std::uniform_int_distribution<> length {0, 70};
+    std::uniform_int_distribution<> character {
+        0, static_cast<int>(characters.size()) - 1};
+
+    for (int i = 0; i < 20'000; i++)
+    {
+        std::string line(length(random), ' ');
+        for (char& c : line)
+        {
+            c = characters[character(random)];
+        }
+        check_line(line);
+    }
+}
+
+TEST(OpcodeTableTest, FindsEveryOpcodeInAnyCase)
+{
+    for (const OpcodeDescriptor& descriptor : OPCODE_DESCRIPTORS)
+    {
+        std::string lower {descriptor.symbolic_opcode};
+        std::ranges::transform(lower, lower.begin(),
+                               [](char c) { return std::tolower(c); });
+
+        EXPECT_EQ(find_numeric_opcode(descriptor.symbolic_opcode),
+                  descriptor.numeric_opcode);
+        EXPECT_EQ(find_numeric_opcode(lower), descriptor.numeric_opcode);
+        EXPECT_EQ(find_opcode_descriptor(descriptor.numeric_opcode),
+                  &descriptor);
+    }
+
+    // Names that hash to an opcode's slot must still match it exactly.
+    for (std::string_view name : {"", "A", "ADDS", "HALTS", "BCOPYX", "ORG "})
+    {
+        EXPECT_FALSE(find_numeric_opcode(name)) << name;
+    }
+    EXPECT_EQ(find_opcode_descriptor(NumericOpcode::TRAP), nullptr);
+}
+
+TEST(SymbolTableTest, GrowsAndDisplaysInOrder)
+{
+    SymbolTable symbol_table;
+    for (int i = 0; i < 5000; i++)
+    {
+        symbol_table.add_symbol(fmt::format("s{}", i), i);
+    }
+
+    for (int i = 0; i < 5000; i++)
+    {
+        EXPECT_EQ(symbol_table.get_location(fmt::format("s{}", i)), i);
+    }
+    EXPECT_THROW(symbol_table.add_symbol("s42", 7), MultiplyDefinedLabelError);
+    EXPECT_THROW((void)symbol_table.get_location("s5000"), UndefinedLabelError);
+
+    // Displayed sorted by symbol, as before the table was hashed.
+    testing::internal::CaptureStdout();
+    symbol_table.display_symbol_table();
+    std::string display {testing::internal::GetCapturedStdout()};
+
+    EXPECT_LT(display.find(" s0 "), display.find(" s1 "));
+    EXPECT_LT(display.find(" s1 "), display.find(" s10 "));
+    EXPECT_LT(display.find(" s4999 "), display.find(" s5 "));
+    EXPECT_NE(display.find(fmt::format("{:<10}{:<10}\n", "s42", -999)),
+              std::string::npos);
+}
+
+/**
+ * @brief Generates a program long enough to be assembled in several chunks.
+ * @param line_count The approximate number of lines.
+ * @return The source.
+ */
+std::string generate_long_source(int line_count)
+{
+    std::string source {" org 100\n b start\n"};
+
+    // Groups of five lines, restarting at location 1000 now and then.
+    for (int i = 0; i < line_count / 5; i++)
+    {
+        if (i % 1000 == 999)
+        {
+            source += " org 1000\n";
+        }
+        source += fmt::format("l{} add l{} l{} ; forward\n", i, i, i + 1);
+        source += fmt::format(" copy l{} x\n", i);
+        source += "; comment\n";
+        source += fmt::format("d{} ds 2\n", i);
+        source += fmt::format(" dc {}\n", i % 1000);
+    }
+    source += fmt::format("l{} dc 1\n", line_count / 5);
+    source += "x dc 0\nstart halt\n end\n";
+
+    return source;
+}
+
+TEST(ParallelAssemblyTest, Pass1MatchesSequentialPass)
+{
+    std::string source_file_path {"parallel_pass_1.txt"};
+    std::string source {generate_long_source(100'000)};
+    create_source_file(source, source_file_path);
+
+    auto display_symbols {[&](int thread_count)
+                          {
+                              Assembler assembler {source_file_path};
+                              assembler.set_thread_count(thread_count);
+                              assembler.pass_1();
+
+                              testing::internal::CaptureStdout();
+                              assembler.display_symbol_table();
+                              return testing::internal::GetCapturedStdout();
+                          }};
+
+    std::string sequential {display_symbols(1)};
+    EXPECT_EQ(display_symbols(4), sequential);
+    EXPECT_EQ(display_symbols(7), sequential);
+
+    // The first error in the source is reported, whichever chunk finds it.
+    auto first_error {[&](const std::string& errors, int thread_count)
+                      {
+                          create_source_file(errors, source_file_path);
+                          Assembler assembler {source_file_path};
+                          assembler.set_thread_count(thread_count);
+                          try
+                          {
+                              assembler.pass_1();
+                          }
+                          catch (const std::exception& error)
+                          {
+                              return std::string {error.what()};
+                          }
+                          return std::string {};
+                      }};
+
+    std::size_t late_line {source.find("\nl15000 ") + 1};
+    std::size_t early_line {source.find("\nl5000 ") + 1};
+    std::string duplicate {source};
+    duplicate.insert(late_line, " add l1 l2 l3\n");
+    duplicate.insert(early_line, "l1 dc 5\n");
+
+    std::string syntax_error {source};
+    syntax_error.insert(late_line, "l1 dc 5\n");
+    syntax_error.insert(early_line, " add l1 l2 l3\n");
+
+    std::string after_end {source + " halt\n"};
+
+    for (const std::string& errors : {duplicate, syntax_error, after_end})
+    {
+        std::string expected {first_error(errors, 1)};
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(first_error(errors, 4), expected);
+    }
+    EXPECT_EQ(first_error(duplicate, 4).find("Multiply defined label: 'l1'"),
+              0);
+    EXPECT_EQ(first_error(syntax_error, 4).find("Extra  element 'l3'"), 0);
+    EXPECT_EQ(first_error(after_end, 4), "Statement after END: 'halt'");
+}
+
+TEST(ParallelAssemblyTest, Pass2MatchesSequentialPass)
+{
+    std::string source_file_path {"parallel_pass_2.txt"};
+    std::string source {generate_long_source(100'000)};
+    create_source_file(source, source_file_path);
+
+    auto translate {[&](int thread_count, std::vector<long long>& memory)
+                    {
+                        Assembler assembler {source_file_path};
+                        assembler.set_thread_count(thread_count);
+                        assembler.pass_1();
+
+                        testing::internal::CaptureStdout();
+                        try
+                        {
+                            assembler.pass_2();
+                        }
+                        catch (const UndefinedLabelError& error)
+                        {
+                            std::cout << error.what();
+                        }
+
+                        // Memory as far as the translation got.
+                        memory.clear();
+                        for (int i = 0; i < Emulator::MEMORY_SIZE; i++)
+                        {
+                            memory.push_back(assembler.get_emulator().peek(i));
+                        }
+                        return testing::internal::GetCapturedStdout();
+                    }};
+
+    std::vector<long long> sequential_memory;
+    std::vector<long long> parallel_memory;
+    std::string            sequential {translate(1, sequential_memory)};
+
+    EXPECT_EQ(translate(4, parallel_memory), sequential);
+    EXPECT_EQ(parallel_memory, sequential_memory);
+
+    // The earliest undefined label is reported, after the lines before it.
+    std::size_t late_line {source.find("\nl15000 ") + 1};
+    std::size_t early_line {source.find("\nl5000 ") + 1};
+    source.insert(late_line, " b nowhere\n");
+    source.insert(early_line, " b missing\n");
+    create_source_file(source, source_file_path);
+
+    sequential = translate(1, sequential_memory);
+    EXPECT_TRUE(sequential.ends_with("Undefined label: 'missing'"));
+    EXPECT_EQ(translate(4, parallel_memory), sequential);
+    EXPECT_EQ(parallel_memory, sequential_memory);
+}
+
+TEST(ParallelAssemblyTest, Pass2TranslatesTheChunksOfPass1)
+{
+    // Blank lines after the END statement put it in a chunk before the last,
+    // so pass_1 places fewer chunks than it split the source into.
+    std::string source_file_path {"parallel_end.txt"};
+    std::string source {generate_long_source(50'000)};
+    source.append(40'000, '\n');
+    create_source_file(source, source_file_path);
+
+    auto translate {[&](int thread_count, std::vector<long long>& memory)
+                    {
+                        Assembler assembler {source_file_path};
+                        assembler.set_thread_count(thread_count);
+                        assembler.pass_1();
+
+                        testing::internal::CaptureStdout();
+                        assembler.pass_2();
+
+                        memory.clear();
+                        for (int i = 0; i < Emulator::MEMORY_SIZE; i++)
+                        {
+                            memory.push_back(assembler.get_emulator().peek(i));
+                        }
+                        return testing::internal::GetCapturedStdout();
+                    }};
+
+    std::vector<long long> sequential_memory;
+    std::vector<long long> parallel_memory;
+    std::string            sequential {translate(1, sequential_memory)};
+
+    EXPECT_EQ(translate(4, parallel_memory), sequential);
+    EXPECT_EQ(parallel_memory, sequential_memory);
+}
+
+TEST(ParallelAssemblyTest, PipelineMatchesSequentialSinglePass)
+{
+    std::string source_file_path {"pipeline.txt"};
+    std::string source {generate_long_source(100'000)};
+    create_source_file(source, source_file_path);
+    PipelineStats stats;
+
+    auto assemble {[&](int thread_count, std::vector<long long>& memory)
+                   {
+                       Assembler assembler {source_file_path};
+                       assembler.set_thread_count(thread_count);
+
+                       testing::internal::CaptureStdout();
+                       try
+                       {
+                           assembler.assemble_single_pass();
+                           assembler.display_symbol_table();
+                           assembler.display_listing();
+                       }
+                       catch (const std::exception& error)
+                       {
+                           std::cout << error.what();
+                       }
+
+                       memory.clear();
+                       for (int i = 0; i < Emulator::MEMORY_SIZE; i++)
+                       {
+                           memory.push_back(assembler.get_emulator().peek(i));
+                       }
+
+                       stats = assembler.get_pipeline_stats();
+                       return testing::internal::GetCapturedStdout();
+                   }};
+
+    std::vector<long long> sequential_memory;
+    std::vector<long long> pipelined_memory;
+    std::string            sequential {assemble(1, sequential_memory)};
+
+    EXPECT_NE(sequential.find("Location"), std::string::npos);
+    EXPECT_EQ(stats.read.lines, 0);
+    EXPECT_EQ(assemble(3, pipelined_memory), sequential);
+    EXPECT_EQ(pipelined_memory, sequential_memory);
+
+    // Every stage saw every line, in batches.
+    EXPECT_GT(stats.read.batches, 1);
+    EXPECT_EQ(stats.parse.lines, stats.read.lines);
+    EXPECT_EQ(stats.translate.lines, stats.read.lines);
+
+    // Errors found while parsing and while translating are reported in
+    // source order, whichever stage finds them.
+    std::size_t late_line {source.find("\nl15000 ") + 1};
+    std::size_t early_line {source.find("\nl5000 ") + 1};
+    std::string duplicate {source};
+    duplicate.insert(late_line, " add l1 l2 l3\n");
+    duplicate.insert(early_line, "l1 dc 5\n");
+
+    std::string syntax_error {source};
+    syntax_error.insert(late_line, "l1 dc 5\n");
+    syntax_error.insert(early_line, " add l1 l2 l3\n");
+
+    std::string after_end {source + " halt\n"};
+
+    for (const std::string& errors : {duplicate, syntax_error, after_end})
+    {
+        create_source_file(errors, source_file_path);
+        sequential = assemble(1, sequential_memory);
+
+        EXPECT_EQ(sequential.find("Location"), std::string::npos);
+        EXPECT_EQ(assemble(3, pipelined_memory), sequential);
+    }
+    EXPECT_EQ(sequential, "Statement after END: 'halt'");
+}
+
+TEST(ListingTest, WritesTheListingWhereItIsSent)
+{
+    std::string source_file_path {"listing.txt"};
+    create_source_file("; sums two cells\n"
+                       " org 100\n"
+                       "start bsum total data 2\n"
+                       " write total\n"
+                       " halt\n"
+                       "data dc 20\n"
+                       " dc 22\n"
+                       "total ds 1\n"
+                       " end\n",
+                       source_file_path);
+
+    auto assemble {[&](ListingSink* listing, bool single_pass)
+                   {
+                       auto assembler {std::make_unique<Assembler>(
+                           source_file_path, true)};
+                       assembler->set_listing_sink(listing);
+
+                       if (single_pass)
+                           assembler->assemble_single_pass();
+                       else
+                           assembler->pass_1();
+                       assembler->display_symbol_table();
+                       if (single_pass)
+                           assembler->display_listing();
+                       else
+                           assembler->pass_2();
+                       return assembler;
+                   }};
+
+    // The console listing, as it has always been displayed.
+    Assembler console {source_file_path, true};
+    console.pass_1();
+    testing::internal::CaptureStdout();
+    console.display_symbol_table();
+    console.pass_2();
+    std::string table {testing::internal::GetCapturedStdout()};
+    EXPECT_NE(table.find("100       170010600104"), std::string::npos);
+    EXPECT_NE(table.find("101       000000000002"), std::string::npos);
+
+    for (bool single_pass : {false, true})
+    {
+        MemoryListing memory_listing {ListingFormat::Table};
+        assemble(&memory_listing, single_pass);
+        EXPECT_EQ(memory_listing.get_text(), table);
+
+        MemoryListing compact {ListingFormat::Compact};
+        assemble(&compact, single_pass);
+        EXPECT_EQ(compact.get_text(),
+                  std::string_view {"S\tdata\t104\n"
+                                    "S\tstart\t100\n"
+                                    "S\ttotal\t106\n"
+                                    "W\t100\t170010600104\t"
+                                    "start bsum total data 2\n"
+                                    "W\t101\t2\t\n"
+                                    "W\t102\t80010600000\t write total\n"
+                                    "W\t103\t130000000000\t halt\n"
+                                    "W\t104\t20\tdata dc 20\n"
+                                    "W\t105\t22\t dc 22\n"});
+    }
+
+    // A listing file holds what the console would show.
+    {
+        FileListing file_listing {"listing.lst", ListingFormat::Table};
+        assemble(&file_listing, false);
+    }
+    std::ifstream listing_file {"listing.lst"};
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(listing_file), {}),
+              table);
+    EXPECT_THROW(FileListing("no_such_directory/listing.lst",
+                             ListingFormat::Table),
+                 ListingFileError);
+
+    // Without a listing nothing is shown, but the program is assembled.
+    testing::internal::CaptureStdout();
+    auto quiet {assemble(nullptr, false)};
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+    EXPECT_TRUE(std::ranges::equal(quiet->get_emulator().get_image(),
+                                   console.get_emulator().get_image()));
+
+    // Undefined labels are still reported.
+    create_source_file(" b nowhere\n end\n", source_file_path);
+    EXPECT_THROW(assemble(nullptr, false), UndefinedLabelError);
+    EXPECT_THROW(assemble(nullptr, true), UndefinedLabelError);
+}
+
+TEST(ObjectFileTest, RunsTheProgramWithoutAssemblingIt)
+{
+    // A long DS block, a run of equal constants and scattered cells.
+    std::string source {" org 100\n"
+                        "start add total one\n"
+                        " write total\n"
+                        " halt\n"
+                        "one dc 1\n"
+                        "total dc 41\n"
+                        "buffer ds 50000\n"};
+    for (int i = 0; i < 20; i++)
+    {
+        source += " dc 7\n";
+    }
+    source += "last dc 99999\n end\n";
+
+    std::string source_file_path {"object_source.txt"};
+    std::string object_file_path {"object.vco"};
+    create_source_file(source, source_file_path);
+
+    Assembler assembler {source_file_path};
+    assembler.set_listing_sink(nullptr);
+    assembler.pass_1();
+    assembler.pass_2();
+    assembler.write_object_file(object_file_path);
+
+    EXPECT_TRUE(is_object_file(object_file_path));
+    EXPECT_FALSE(is_object_file(source_file_path));
+    EXPECT_FALSE(is_object_file("no_such_file.vco"));
+
+    // Neither the reserved cells nor the run are stored cell by cell.
+    EXPECT_LT(std::filesystem::file_size(object_file_path), 400);
+
+    Emulator loaded;
+    {
+        ObjectFile object_file {object_file_path};
+        object_file.load_into(loaded);
+
+        MemoryListing symbols {ListingFormat::Table};
+        object_file.display_symbol_table(symbols);
+
+        MemoryListing assembled_symbols {ListingFormat::Table};
+        assembler.set_listing_sink(&assembled_symbols);
+        assembler.display_symbol_table();
+        EXPECT_EQ(symbols.get_text(), assembled_symbols.get_text());
+    }
+
+    EXPECT_TRUE(std::ranges::equal(loaded.get_image(),
+                                   assembler.get_emulator().get_image()));
+    EXPECT_EQ(loaded.get_memory_digest(),
+              assembler.get_emulator().get_memory_digest());
+    EXPECT_EQ(loaded.peek(50105), 7);
+    EXPECT_EQ(loaded.peek(50124), 7);
+    EXPECT_EQ(loaded.peek(50125), 99'999);
+
+    // Files that are not whole object files are rejected.
+    std::string contents;
+    {
+        std::ifstream object_file {object_file_path, std::ios::binary};
+        contents.assign(std::istreambuf_iterator<char>(object_file), {});
+    }
+    auto rejects {[&](const std::string& damaged)
+                  {
+                      create_source_file(damaged, "damaged.vco");
+                      EXPECT_THROW(ObjectFile {"damaged.vco"},
+                                   ObjectFileError);
+                  }};
+
+    rejects(contents.substr(0, contents.size() - 1));
+    rejects(contents.substr(0, 16));
+    rejects(source);
+
+    // The first segment starts beyond the end of memory.
+    std::string out_of_memory {contents};
+    std::int32_t address {Emulator::MEMORY_SIZE};
+    std::memcpy(out_of_memory.data() + 32, &address, sizeof(address));
+    rejects(out_of_memory);
+
+    EXPECT_THROW(ObjectFile {"no_such_file.vco"}, ObjectFileError);
+}